@@ -0,0 +1,156 @@
+// Encode, decode and merge throughput of partial aggregates in the JSON form
+// nodes used to exchange and in the binary wire format. Each part is the
+// aggregate of its own generated corpus; every stage handles all parts.
+
+#include <algorithm>
+#include <atomic>
+#include <boost/json.hpp>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <print>
+#include <string>
+#include <vector>
+
+#include "../lib/cluster/aggregate.hpp"
+#include "../lib/cluster/wire.hpp"
+#include "../lib/corpus/generator.hpp"
+#include "../lib/file/handler.hpp"
+#include "CLI/CLI.hpp"
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+
+std::atomic<std::size_t> sink{0};  // Keeps results observable so runs are not optimised away
+
+// Median seconds per run.
+double measure(int warmup, int repetitions, const std::function<std::size_t()>& run) {
+  for (int i = 0; i < warmup; ++i) sink.fetch_add(run(), std::memory_order_relaxed);
+  std::vector<double> seconds;
+  for (int i = 0; i < repetitions; ++i) {
+    auto const started = bench_clock::now();
+    sink.fetch_add(run(), std::memory_order_relaxed);
+    seconds.push_back(std::chrono::duration<double>(bench_clock::now() - started).count());
+  }
+  std::ranges::sort(seconds);
+  return seconds[seconds.size() / 2];
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::uint64_t records = 200'000;
+  std::vector<std::size_t> cardinalities{100, 10'000, 100'000};
+  std::size_t parts = 8;
+  int warmup = 1;
+  int repetitions = 5;
+  std::uint64_t seed = 1;
+
+  CLI::App app{"Partial aggregate encoding benchmark"};
+  app.add_option("--records", records, "records per part")->check(CLI::PositiveNumber);
+  app.add_option("--distinct", cardinalities, "distinct messages per corpus, comma separated")
+      ->delimiter(',')
+      ->check(CLI::PositiveNumber);
+  app.add_option("--parts", parts, "partial aggregates per merge")->check(CLI::PositiveNumber);
+  app.add_option("--warmup", warmup, "untimed runs per case")->check(CLI::NonNegativeNumber);
+  app.add_option("--repetitions", repetitions, "timed runs per case")->check(CLI::PositiveNumber);
+  app.add_option("--seed", seed, "corpus seed");
+  CLI11_PARSE(app, argc, argv);
+
+  for (auto const distinct : cardinalities) {
+    std::vector<boost::json::object> stats;
+    std::vector<cluster::partial> partials(parts);
+    std::uint64_t entries = 0;
+    for (std::size_t i = 0; i < parts; ++i) {
+      corpus_options options;
+      options.seed = seed + i;
+      options.records = records;
+      options.distinct_messages = distinct;
+      auto const computed =
+          process_json_request(corpus_generator(options).generate(corpus_format::json));
+      stats.push_back(computed.message_stats);
+      partials[i].merge(computed.message_stats, computed.total_fields, computed.invalid_fields);
+      for (auto const& [level, messages] : stats.back()) entries += messages.as_object().size();
+    }
+
+    // Inputs of the decode and merge stages, made once.
+    std::vector<std::string> json_texts, wire_texts;
+    std::uint64_t json_bytes = 0, wire_bytes = 0;
+    for (std::size_t i = 0; i < parts; ++i) {
+      json_texts.push_back(boost::json::serialize(stats[i]));
+      wire_texts.push_back(cluster::wire::encode(partials[i]));
+      json_bytes += json_texts.back().size();
+      wire_bytes += wire_texts.back().size();
+    }
+    std::vector<boost::json::value> json_values;
+    std::vector<cluster::wire::view> wire_views;
+    for (std::size_t i = 0; i < parts; ++i) {
+      json_values.push_back(boost::json::parse(json_texts[i]));
+      wire_views.push_back(*cluster::wire::view::parse(wire_texts[i]));
+    }
+
+    struct stage {
+      char const* name;
+      std::function<std::size_t()> json;
+      std::function<std::size_t()> wire;
+    };
+    std::vector<stage> const stages{
+        {"encode",
+            [&] {
+              std::size_t bytes = 0;
+              for (auto const& object : stats) bytes += boost::json::serialize(object).size();
+              return bytes;
+            },
+            [&] {
+              std::size_t bytes = 0;
+              for (auto const& p : partials) bytes += cluster::wire::encode(p).size();
+              return bytes;
+            }},
+        // Decoding ends with every count read: parsing alone leaves the wire
+        // format's entries untouched.
+        {"decode",
+            [&] {
+              std::size_t sum = 0;
+              for (auto const& text : json_texts) {
+                for (auto const& [level, messages] : boost::json::parse(text).as_object()) {
+                  for (auto const& [message, count] : messages.as_object()) {
+                    sum += static_cast<std::size_t>(count.as_int64());
+                  }
+                }
+              }
+              return sum;
+            },
+            [&] {
+              std::size_t sum = 0;
+              for (auto const& text : wire_texts) {
+                cluster::wire::view::parse(text)->for_each(
+                    [&](std::string_view, std::string_view, std::uint64_t count) { sum += count; });
+              }
+              return sum;
+            }},
+        {"merge",
+            [&] { return boost::json::serialize(merge_json_objects(json_values)).size(); },
+            [&] { return cluster::wire::merge(wire_views).size(); }},
+    };
+
+    std::println("{} parts x {} records, {} distinct: {} entries, JSON {} KB, wire {} KB",
+        parts,
+        records,
+        distinct,
+        entries,
+        json_bytes / 1024,
+        wire_bytes / 1024);
+    for (auto const& s : stages) {
+      double const json_seconds = measure(warmup, repetitions, s.json);
+      double const wire_seconds = measure(warmup, repetitions, s.wire);
+      std::println("  {:<7} JSON {:>12.0f} entries/s   wire {:>12.0f} entries/s   {:>5.1f}x",
+          s.name,
+          static_cast<double>(entries) / json_seconds,
+          static_cast<double>(entries) / wire_seconds,
+          json_seconds / wire_seconds);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,227 @@
+// Micro-benchmarks for the three log parsers and the merge step over
+// generated corpora of varying size and cardinality. Reports MB/s, records/s,
+// operator new calls per run and peak RSS, and can write the results as JSON
+// so runs before and after a change can be compared.
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <boost/json.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <print>
+#include <string>
+#include <vector>
+
+#include "../lib/corpus/generator.hpp"
+#include "../lib/file/handler.hpp"
+#include "CLI/CLI.hpp"
+
+// Counting allocator hook: every operator new in the process goes through
+// here. Allocations made with malloc directly (simdjson's document buffers,
+// for one) are not seen.
+namespace {
+std::atomic<std::uint64_t> allocation_count{0};
+std::atomic<std::uint64_t> allocated_bytes{0};
+
+void* counted_new(std::size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+}  // namespace
+
+void* operator new(std::size_t size) { return counted_new(size); }
+void* operator new[](std::size_t size) { return counted_new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+
+long peak_rss_kb() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+  return usage.ru_maxrss / 1024;  // Bytes on macOS
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+struct case_result {
+  std::string name;
+  std::uint64_t records = 0;
+  std::size_t distinct = 0;
+  std::uint64_t bytes = 0;
+  double seconds_min = 0;
+  double seconds_median = 0;
+  double allocations = 0;  // Per run
+  double allocated_bytes = 0;
+  long peak_rss_kb = 0;  // Process high-water mark after the case, not the case alone
+};
+
+std::atomic<std::size_t> sink{0};  // Keeps results observable so runs are not optimised away
+
+case_result measure(std::string name,
+    std::uint64_t records,
+    std::size_t distinct,
+    std::uint64_t bytes,
+    int warmup,
+    int repetitions,
+    const std::function<std::size_t()>& run) {
+  for (int i = 0; i < warmup; ++i) sink.fetch_add(run(), std::memory_order_relaxed);
+
+  std::vector<double> seconds;
+  auto const count_before = allocation_count.load();
+  auto const bytes_before = allocated_bytes.load();
+  for (int i = 0; i < repetitions; ++i) {
+    auto const started = bench_clock::now();
+    sink.fetch_add(run(), std::memory_order_relaxed);
+    seconds.push_back(std::chrono::duration<double>(bench_clock::now() - started).count());
+  }
+  auto const runs = static_cast<double>(repetitions);
+
+  std::ranges::sort(seconds);
+  case_result result;
+  result.name = std::move(name);
+  result.records = records;
+  result.distinct = distinct;
+  result.bytes = bytes;
+  result.seconds_min = seconds.front();
+  result.seconds_median = seconds[seconds.size() / 2];
+  result.allocations = static_cast<double>(allocation_count.load() - count_before) / runs;
+  result.allocated_bytes = static_cast<double>(allocated_bytes.load() - bytes_before) / runs;
+  result.peak_rss_kb = peak_rss_kb();
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::vector<std::uint64_t> sizes{10'000, 100'000, 1'000'000};
+  std::vector<std::size_t> cardinalities{10, 1'000, 100'000};
+  double zipf_skew = 1.0;
+  int warmup = 2;
+  int repetitions = 5;
+  std::uint64_t seed = 1;
+  std::string json_path;
+
+  CLI::App app{"Parser micro-benchmarks"};
+  app.add_option("--records", sizes, "records per corpus, comma separated")
+      ->delimiter(',')
+      ->check(CLI::PositiveNumber);
+  app.add_option("--distinct", cardinalities, "distinct messages per corpus, comma separated")
+      ->delimiter(',')
+      ->check(CLI::PositiveNumber);
+  app.add_option("--zipf", zipf_skew, "Zipf skew of message frequencies")
+      ->check(CLI::Range(0.0, 10.0));
+  app.add_option("--warmup", warmup, "untimed runs per case")->check(CLI::NonNegativeNumber);
+  app.add_option("--repetitions", repetitions, "timed runs per case")->check(CLI::PositiveNumber);
+  app.add_option("--seed", seed, "corpus seed");
+  app.add_option("--json", json_path, "write results as JSON to this path, - for stdout");
+  CLI11_PARSE(app, argc, argv);
+
+  std::vector<case_result> results;
+  auto report = [&](case_result result) {
+    double const mb = static_cast<double>(result.bytes) / (1024 * 1024);
+    // With --json - the table goes to stderr so stdout stays valid JSON.
+    std::println(json_path == "-" ? stderr : stdout,
+        "{:<6} {:>9} records {:>7} distinct {:>9.1f} MB/s {:>12.0f} records/s "
+        "{:>10.0f} allocs {:>8} KB peak RSS",
+        result.name,
+        result.records,
+        result.distinct,
+        mb / result.seconds_median,
+        static_cast<double>(result.records) / result.seconds_median,
+        result.allocations,
+        result.peak_rss_kb);
+    results.push_back(std::move(result));
+  };
+
+  for (auto const records : sizes) {
+    for (auto const distinct : cardinalities) {
+      corpus_options options;
+      options.seed = seed;
+      options.records = records;
+      options.distinct_messages = distinct;
+      options.zipf_skew = zipf_skew;
+      corpus_generator const generator(options);
+
+      std::string const json = generator.generate(corpus_format::json);
+      std::string const xml = generator.generate(corpus_format::xml);
+      std::string const text = generator.generate(corpus_format::text);
+
+      report(measure("json", records, distinct, json.size(), warmup, repetitions, [&] {
+        return process_json_request(json).total_fields;
+      }));
+      report(measure("xml", records, distinct, xml.size(), warmup, repetitions, [&] {
+        return parse_xml_file(xml).total_fields;
+      }));
+      report(measure("text", records, distinct, text.size(), warmup, repetitions, [&] {
+        return parse_text_file(text).total_fields;
+      }));
+
+      // Merge works on the three per-format aggregates, as handle_request does;
+      // its records are the (level, message) entries it folds together.
+      std::vector<boost::json::value> const stats{process_json_request(json).message_stats,
+          parse_xml_file(xml).message_stats,
+          parse_text_file(text).message_stats};
+      std::uint64_t entries = 0, stats_bytes = 0;
+      for (auto const& object : stats) {
+        stats_bytes += boost::json::serialize(object).size();
+        for (auto const& level : object.as_object()) entries += level.value().as_object().size();
+      }
+      report(measure("merge", entries, distinct, stats_bytes, warmup, repetitions, [&] {
+        return merge_json_objects(stats).size();
+      }));
+    }
+  }
+
+  if (!json_path.empty()) {
+    boost::json::array cases;
+    for (auto const& result : results) {
+      double const mb = static_cast<double>(result.bytes) / (1024 * 1024);
+      cases.push_back(boost::json::object{
+          {"name", result.name},
+          {"records", result.records},
+          {"distinct", result.distinct},
+          {"bytes", result.bytes},
+          {"seconds_min", result.seconds_min},
+          {"seconds_median", result.seconds_median},
+          {"mb_per_s", mb / result.seconds_median},
+          {"records_per_s", static_cast<double>(result.records) / result.seconds_median},
+          {"allocations_per_run", result.allocations},
+          {"allocated_bytes_per_run", result.allocated_bytes},
+          {"peak_rss_kb", result.peak_rss_kb},
+      });
+    }
+    boost::json::object const document{{"zipf", zipf_skew},
+        {"seed", seed},
+        {"warmup", warmup},
+        {"repetitions", repetitions},
+        {"cases", cases}};
+
+    if (json_path == "-") {
+      std::println("{}", boost::json::serialize(document));
+    } else {
+      std::ofstream out(json_path);
+      out << boost::json::serialize(document) << '\n';
+      if (!out) {
+        std::println(stderr, "[ERROR] Cannot write results to {}", json_path);
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
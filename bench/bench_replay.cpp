@@ -0,0 +1,397 @@
+// Replays multipart uploads through handle_request in-process, on several
+// threads and without any sockets, and reports where the time goes stage by
+// stage. With --over-tcp the uploads go over keep-alive loopback connections
+// through a listener and its sessions instead, and the report adds how many
+// handler allocations each request made and how many reached the heap. The
+// upload is either generated or loaded from a raw HTTP request recorded off the
+// wire (for example `nc -l 9000 > upload.http`, then point the client at port
+// 9000).
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/json.hpp>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <print>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../lib/corpus/generator.hpp"
+#include "../lib/http/handler.hpp"
+#include "../lib/metrics/histogram.hpp"
+#include "../lib/metrics/registry.hpp"
+#include "../lib/metrics/stage_timer.hpp"
+#include "../lib/network/listener.hpp"
+#include "CLI/CLI.hpp"
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+using replay_request = http::request<http::dynamic_body>;  // What the sessions hand over
+
+std::optional<replay_request> load_request(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    std::println(stderr, "[ERROR] Cannot open {}", path);
+    return std::nullopt;
+  }
+  std::string const raw{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+  http::request_parser<http::dynamic_body> parser;
+  parser.eager(true);
+  parser.body_limit(boost::none);
+  beast::error_code ec;
+  std::size_t offset = 0;
+  while (!parser.is_done() && !ec && offset < raw.size()) {
+    offset += parser.put(boost::asio::buffer(raw.data() + offset, raw.size() - offset), ec);
+  }
+  if (!parser.is_done() && !ec) parser.put_eof(ec);
+  if (ec || !parser.is_done()) {
+    std::println(stderr, "[ERROR] {} is not a complete HTTP request: {}", path, ec.message());
+    return std::nullopt;
+  }
+  return parser.release();
+}
+
+replay_request generate_request(std::uint64_t records, std::size_t distinct, std::uint64_t seed) {
+  corpus_options options;
+  options.records = records;
+  options.distinct_messages = distinct;
+  options.seed = seed;
+  corpus_generator const generator(options);
+
+  std::string const boundary = "----replay-boundary";
+  std::string body;
+  auto add_part = [&](const char* field, corpus_format format, const char* type) {
+    body += "--" + boundary + "\r\n";
+    body += std::string("Content-Disposition: form-data; name=\"") + field +
+            "\"; filename=\"replay." + std::string(corpus_generator::extension(format)) +
+            "\"\r\n";
+    body += std::string("Content-Type: ") + type + "\r\n\r\n";
+    body += generator.generate(format);
+    body += "\r\n";
+  };
+  add_part("file_json", corpus_format::json, "application/json");
+  add_part("file_xml", corpus_format::xml, "application/xml");
+  add_part("file_txt", corpus_format::text, "text/plain");
+  body += "--" + boundary + "--\r\n";
+
+  replay_request req{http::verb::post, "/", 11};
+  req.set(http::field::host, "localhost");
+  req.set(http::field::content_type, "multipart/form-data; boundary=" + boundary);
+  beast::ostream(req.body()) << body;
+  req.prepare_payload();
+  return req;
+}
+
+struct thread_result {
+  latency_histogram latency_ns;
+  stage_timings stages;
+  std::uint64_t completed = 0;
+  std::uint64_t failed = 0;
+  std::uint64_t response_bytes = 0;
+};
+
+// Runs one request end to end, draining the response as the session would.
+// Returns false unless the handler answered 200.
+bool replay_one(replay_request req, const client_address& client, std::uint64_t& response_bytes) {
+  http::message_generator response = handle_request(".", std::move(req), client);
+  beast::error_code ec;
+  bool first = true, ok = false;
+  while (!response.is_done()) {
+    auto const buffers = response.prepare(ec);
+    if (ec) return false;
+    if (first) {
+      ok = beast::buffers_to_string(beast::buffers_prefix(12, buffers)) == "HTTP/1.1 200";
+      first = false;
+    }
+    auto const size = beast::buffer_bytes(buffers);
+    response_bytes += size;
+    response.consume(size);
+  }
+  return ok;
+}
+
+// Sends one request over a keep-alive connection and reads its response.
+// Returns false unless the server answered 200.
+bool replay_over(beast::tcp_stream& stream,
+    beast::flat_buffer& buffer,
+    const replay_request& req,
+    std::uint64_t& response_bytes) {
+  beast::error_code ec;
+  http::write(stream, req, ec);
+  if (ec) return false;
+  http::response<http::string_body> res;
+  http::read(stream, buffer, res, ec);
+  if (ec) return false;
+  response_bytes += res.body().size();
+  return res.result() == http::status::ok;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string request_file;
+  std::uint64_t records = 10'000;
+  std::size_t distinct = 1000;
+  std::uint64_t seed = 1;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  std::uint64_t requests = 100;
+  std::uint64_t warmup = 5;
+  std::string workdir = (std::filesystem::temp_directory_path() / "bench_replay").string();
+  std::string json_path;
+  std::size_t analysis_cache = 0;
+  bool over_tcp = false;
+
+  CLI::App app{"In-process request replay through handle_request"};
+  app.add_option("--request",
+      request_file,
+      "raw HTTP request to replay instead of a generated upload");
+  app.add_option("--records", records, "records per format in the generated upload")
+      ->check(CLI::PositiveNumber);
+  app.add_option("--distinct", distinct, "distinct messages in the generated upload")
+      ->check(CLI::PositiveNumber);
+  app.add_option("--seed", seed, "seed of the generated upload");
+  app.add_option("-t,--threads", threads, "replay threads")->check(CLI::PositiveNumber);
+  app.add_option("-n,--requests", requests, "timed requests per thread")
+      ->check(CLI::PositiveNumber);
+  app.add_option("--warmup", warmup, "untimed requests per thread");
+  app.add_option("--workdir",
+      workdir,
+      "directory the handler saves uploads under; cleared afterwards");
+  app.add_option("--json", json_path, "write results as JSON to this path, - for stdout");
+  app.add_option("--analysis-cache",
+      analysis_cache,
+      "MiB of analyses kept for identical uploads; the default 0 parses every replay");
+  app.add_flag("--over-tcp",
+      over_tcp,
+      "replay over loopback connections through the sessions and count handler allocations");
+  CLI11_PARSE(app, argc, argv);
+
+  std::optional<replay_request> prototype =
+      request_file.empty() ? generate_request(records, distinct, seed) : load_request(request_file);
+  if (!prototype) return 1;
+  auto const request_bytes = prototype->body().size();
+
+  // Every replay is the same upload: by default it is parsed each time, as a
+  // stream of distinct uploads would be. Its bytes are stored only once per
+  // thread either way.
+  content_store::set_cache_capacity(analysis_cache << 20);
+
+  // Uploads are stored under ./storage, so the run happens in a scratch
+  // directory.
+  auto const original_dir = std::filesystem::current_path();
+  std::error_code fs_ec;
+  std::filesystem::create_directories(workdir, fs_ec);
+  std::filesystem::current_path(workdir, fs_ec);
+  if (fs_ec) {
+    std::println(stderr, "[ERROR] Cannot work in {}: {}", workdir, fs_ec.message());
+    return 1;
+  }
+
+  // The handler logs every request; keep that off the terminal during the run.
+  std::fflush(stdout);
+  int const saved_stdout = dup(STDOUT_FILENO);
+  if (std::FILE* devnull = std::fopen("/dev/null", "w")) {
+    dup2(fileno(devnull), STDOUT_FILENO);
+    std::fclose(devnull);
+  }
+
+  // The server side of --over-tcp: a listener on an ephemeral loopback port,
+  // its sessions run by as many threads as replay.
+  asio::io_context ioc;
+  std::vector<std::thread> io_threads;
+  tcp::endpoint server_endpoint;
+  if (over_tcp) {
+    auto const server = std::make_shared<listener>(ioc,
+        tcp::endpoint{asio::ip::make_address("127.0.0.1"), 0},
+        std::make_shared<std::string const>("."));
+    server_endpoint = server->local_endpoint();
+    server->run();
+    for (unsigned t = 0; t < threads; ++t) io_threads.emplace_back([&ioc] { ioc.run(); });
+  }
+
+  std::vector<thread_result> results(threads);
+  std::vector<std::thread> workers;
+  std::atomic<unsigned> ready{0};
+  std::atomic<bool> go{false};
+  for (unsigned t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      thread_result& result = results[t];
+      replay_request req = *prototype;
+      req.set("Client-Id", "replay-" + std::to_string(t));  // Keeps threads' saved files apart
+      client_address const client{"127.0.0.1", std::to_string(t)};
+
+      asio::io_context client_ioc;
+      std::optional<beast::tcp_stream> connection;
+      beast::flat_buffer buffer;
+      if (over_tcp) {
+        connection.emplace(client_ioc);
+        beast::error_code ec;
+        connection->connect(server_endpoint, ec);
+        if (ec) std::println(stderr, "[ERROR] Cannot connect to the listener: {}", ec.message());
+      }
+
+      std::uint64_t ignored = 0;
+      for (std::uint64_t i = 0; i < warmup; ++i) {
+        if (connection) {
+          replay_over(*connection, buffer, req, ignored);
+        } else {
+          replay_one(req, client, ignored);
+        }
+      }
+
+      ready.fetch_add(1);
+      while (!go.load()) std::this_thread::yield();
+
+      active_stage_timings = &result.stages;
+      for (std::uint64_t i = 0; i < requests; ++i) {
+        // Copied outside the clock; the session hands over a fresh request
+        std::optional<replay_request> copy;
+        if (!connection) copy = req;
+        auto const started = bench_clock::now();
+        bool const ok = connection ? replay_over(*connection, buffer, req, result.response_bytes)
+                                   : replay_one(std::move(*copy), client, result.response_bytes);
+        auto const elapsed = bench_clock::now() - started;
+        result.latency_ns.record(static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        ++(ok ? result.completed : result.failed);
+      }
+      active_stage_timings = nullptr;
+    });
+  }
+
+  // Warmup requests are done once every thread is ready; the pending reads
+  // of the idle connections were allocated then too.
+  while (ready.load() < threads) std::this_thread::yield();
+  auto const allocations_before = metrics::counter_total(metrics::counter::handler_allocations);
+  auto const heap_allocations_before =
+      metrics::counter_total(metrics::counter::handler_heap_allocations);
+  auto const started = bench_clock::now();
+  go.store(true);
+  for (auto& worker : workers) worker.join();
+  std::chrono::duration<double> const elapsed = bench_clock::now() - started;
+  auto const allocations =
+      metrics::counter_total(metrics::counter::handler_allocations) - allocations_before;
+  auto const heap_allocations =
+      metrics::counter_total(metrics::counter::handler_heap_allocations) -
+      heap_allocations_before;
+
+  ioc.stop();
+  for (auto& io_thread : io_threads) io_thread.join();
+
+  std::fflush(stdout);
+  dup2(saved_stdout, STDOUT_FILENO);
+  close(saved_stdout);
+  std::filesystem::remove_all("storage", fs_ec);
+  std::filesystem::current_path(original_dir, fs_ec);
+
+  thread_result total;
+  for (auto const& result : results) {
+    total.latency_ns.merge(result.latency_ns);
+    total.stages.add(result.stages);
+    total.completed += result.completed;
+    total.failed += result.failed;
+    total.response_bytes += result.response_bytes;
+  }
+
+  auto const handled = static_cast<double>(total.completed + total.failed);
+  auto const latency_sum = total.latency_ns.mean() * handled;
+  auto us = [](double ns) { return ns / 1000; };
+  double const throughput = handled / elapsed.count();
+  double const mb_per_s =
+      static_cast<double>(request_bytes) * handled / (1024 * 1024) / elapsed.count();
+
+  FILE* const out = json_path == "-" ? stderr : stdout;  // Keep stdout clean for JSON
+  std::println(out, "{} threads x {} requests of {:.2f} MB: {} ok, {} failed in {:.3f} s",
+      threads,
+      requests,
+      static_cast<double>(request_bytes) / (1024 * 1024),
+      total.completed,
+      total.failed,
+      elapsed.count());
+  std::println(out,
+      "throughput: {:.1f} req/s, {:.1f} MB/s of request bodies",
+      throughput,
+      mb_per_s);
+  std::println(out, "latency (us): p50 {:.1f}  p99 {:.1f}  max {:.1f}",
+      us(static_cast<double>(total.latency_ns.percentile(50))),
+      us(static_cast<double>(total.latency_ns.percentile(99))),
+      us(static_cast<double>(total.latency_ns.max())));
+  if (over_tcp) {
+    std::println(out,
+        "handler allocations per request: {:.2f}, of which {:.2f} from the heap",
+        static_cast<double>(allocations) / handled,
+        static_cast<double>(heap_allocations) / handled);
+  }
+  std::println(out, "{:<12} {:>14} {:>10}", "stage", "us/request", "share");
+
+  boost::json::object stages;
+  double staged_ns = 0;
+  for (std::size_t i = 0; i < request_stage_names.size(); ++i) {
+    if (total.stages.calls[i] == 0) continue;  // The socket read never runs here
+    auto const ns = static_cast<double>(total.stages.ns[i]);
+    staged_ns += ns;
+    std::println(out,
+        "{:<12} {:>14.1f} {:>9.1f}%",
+        request_stage_names[i],
+        us(ns / handled),
+        100 * ns / latency_sum);
+    stages[request_stage_names[i]] = {
+        {"us_per_request", us(ns / handled)}, {"calls", total.stages.calls[i]}};
+  }
+  // Whatever the stages do not cover: routing, logging, response assembly.
+  double const other_ns = latency_sum - staged_ns;
+  std::println(out,
+      "{:<12} {:>14.1f} {:>9.1f}%",
+      "other",
+      us(other_ns / handled),
+      100 * other_ns / latency_sum);
+
+  if (!json_path.empty()) {
+    boost::json::object document{
+        {"threads", threads},
+        {"requests_per_thread", requests},
+        {"request_bytes", request_bytes},
+        {"completed", total.completed},
+        {"failed", total.failed},
+        {"duration_s", elapsed.count()},
+        {"throughput_rps", throughput},
+        {"mb_per_s", mb_per_s},
+        {"latency_us",
+            {{"p50", us(static_cast<double>(total.latency_ns.percentile(50)))},
+                {"p99", us(static_cast<double>(total.latency_ns.percentile(99)))},
+                {"max", us(static_cast<double>(total.latency_ns.max()))},
+                {"mean", us(total.latency_ns.mean())}}},
+        {"stages", stages},
+        {"other_us_per_request", us(other_ns / handled)},
+    };
+    if (over_tcp) {
+      document["handler_allocations_per_request"] = static_cast<double>(allocations) / handled;
+      document["handler_heap_allocations_per_request"] =
+          static_cast<double>(heap_allocations) / handled;
+    }
+
+    if (json_path == "-") {
+      std::println("{}", boost::json::serialize(document));
+    } else {
+      std::ofstream file(json_path);
+      file << boost::json::serialize(document) << '\n';
+      if (!file) {
+        std::println(stderr, "[ERROR] Cannot write results to {}", json_path);
+        return 1;
+      }
+    }
+  }
+
+  return total.failed > 0 ? 1 : 0;
+}
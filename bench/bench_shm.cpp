@@ -0,0 +1,86 @@
+// Pushes synthetic pipe-delimited log lines through a running server's
+// shared-memory ring (server started with --shm-ring) and reports the
+// sustained ingest rate on a single host.
+
+#include <array>
+#include <boost/json.hpp>
+#include <chrono>
+#include <format>
+#include <print>
+#include <string>
+#include <vector>
+
+#include "../lib/shm/producer.hpp"
+#include "CLI/CLI.hpp"
+
+int main(int argc, char* argv[]) {
+  std::string ring_name = "/log-analysis";
+  std::size_t total_lines = 10'000'000;
+  std::size_t lines_per_record = 1000;
+  std::size_t distinct_messages = 1000;
+
+  CLI::App app{"Shared-memory ingestion benchmark"};
+  app.add_option("--ring", ring_name, "ring name passed to the server's --shm-ring");
+  app.add_option("--lines", total_lines, "log lines to push")->check(CLI::PositiveNumber);
+  app.add_option("--lines-per-record", lines_per_record, "log lines per ring record")
+      ->check(CLI::PositiveNumber);
+  app.add_option("--distinct", distinct_messages, "distinct messages")->check(CLI::PositiveNumber);
+  CLI11_PARSE(app, argc, argv);
+
+  auto producer = shm_producer::connect(ring_name);
+  if (!producer) return 1;
+
+  // Records are built up front so the measurement covers the ring and the
+  // server's parsing, not formatting.
+  static constexpr std::array levels{"INFO", "DEBUG", "WARN", "ERROR", "CRITICAL"};
+  std::vector<std::string> records(16);
+  std::size_t line = 0;
+  for (auto& record : records) {
+    for (std::size_t i = 0; i < lines_per_record; ++i, ++line) {
+      record += std::format("2026-01-01 00:00:00|{}|message {}|bench\n",
+          levels[line % levels.size()],
+          line % distinct_messages);
+    }
+    if (record.size() > producer->max_record()) {
+      std::println(stderr, "[ERROR] A record of {} lines does not fit the ring", lines_per_record);
+      return 1;
+    }
+  }
+
+  std::size_t pushed_lines = 0, pushed_records = 0, pushed_bytes = 0;
+  auto const started = std::chrono::steady_clock::now();
+
+  while (pushed_lines < total_lines) {
+    std::string const& record = records[pushed_records % records.size()];
+    if (!producer->push(shm::record_type::text, record)) {
+      std::println(stderr, "[ERROR] Timed out waiting for the server to drain the ring");
+      return 1;
+    }
+    pushed_lines += lines_per_record;
+    pushed_bytes += record.size();
+    ++pushed_records;
+  }
+
+  auto const result = producer->flush();
+  std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - started;
+  if (!result) {
+    std::println(stderr, "[ERROR] No analysis from the server");
+    return 1;
+  }
+
+  boost::json::value const analysis = boost::json::parse(*result);
+  if (analysis.at("status") != "success") {
+    std::println(stderr, "[ERROR] Server: {}", boost::json::serialize(analysis.at("status")));
+    return 1;
+  }
+
+  std::println("ring records:   {} ({} lines each)", pushed_records, lines_per_record);
+  std::println("log records:    {}", pushed_lines);
+  std::println("server counted: {}", analysis.at("total_entries").as_int64());
+  std::println("elapsed:        {:.3f} s", elapsed.count());
+  std::println("throughput:     {:.0f} log records/s, {:.0f} ring records/s, {:.1f} MB/s",
+      static_cast<double>(pushed_lines) / elapsed.count(),
+      static_cast<double>(pushed_records) / elapsed.count(),
+      static_cast<double>(pushed_bytes) / (1024 * 1024) / elapsed.count());
+  return 0;
+}
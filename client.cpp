@@ -1,21 +1,361 @@
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/beast/version.hpp>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
 #include <cstdlib>
+#include <format>
 #include <fstream>
 #include <print>
+#include <thread>
+#include <vector>
 
 #include "lib/cli/parse.hpp"
+#include "lib/codec/analysis.hpp"
+#include "lib/codec/gzip.hpp"
+#include "lib/client/bench.hpp"
+#include "lib/client/follow.hpp"
+#include "lib/client/summary.hpp"
+#include "lib/client/upload.hpp"
+#include "lib/cluster/wire.hpp"
 #include "lib/utils/utils.hpp"
-#include "simdjson.h"
 
 namespace beast = boost::beast;
 namespace http = beast::http;
 namespace asio = boost::asio;
 using tcp = asio::ip::tcp;
 
+// The path with the --top and --min-count query parameters.
+std::string analysis_target(const ClientConfig& config, std::string target) {
+  if (config.top > 0) target += std::format("?top={}", config.top);
+  if (config.minCount > 0) {
+    target += std::format("{}min_count={}", config.top > 0 ? '&' : '?', config.minCount);
+  }
+  return target;
+}
+
+// Decodes an analysis response and prints it. Returns the process exit code.
+int print_analysis(http::response<http::string_body>& res,
+    const std::string& server_ip,
+    const std::string& server_port) {
+  if (res.result() != http::status::ok) {
+    std::println(stderr, "[ERROR] Server answered {}: {}", res.result_int(), res.body());
+    return 1;
+  }
+  if (auto const coding = codec::parse_content_coding(res[http::field::content_encoding]);
+      coding != codec::content_coding::identity) {
+    auto decoded = codec::decompress(res.body(), coding);
+    if (!decoded) {
+      std::cerr << "[ERROR] Decoding response: corrupt or unsupported encoding" << std::endl;
+      return 1;
+    }
+    res.body() = std::move(*decoded);
+  }
+  boost::json::value data;
+  std::string_view const content_type = res[http::field::content_type];
+  if (content_type == codec::content_type(codec::response_format::msgpack)) {
+    auto decoded = codec::read_msgpack(res.body());
+    if (!decoded) {
+      std::cerr << "[ERROR] Decoding response: malformed MessagePack" << std::endl;
+      return 1;
+    }
+    data = std::move(*decoded);
+  } else {
+    data = boost::json::parse(res.body());
+  }
+
+  std::println("ANALYSIS: LOG LEVEL");
+  std::println("SERVER IP: {}", server_ip);
+  std::println("SERVER PORT: {}", server_port);
+  std::println("INVALID DATA: {}", static_cast<int>(data.at("invalid_data").as_int64()));
+  std::println("TOTAL ENTRIES: {}", static_cast<int>(data.at("total_entries").as_int64()));
+
+  print_response(data.at("message_stats"));
+  return 0;
+}
+
+// Uploads the log files over a connected stream (TCP or UNIX domain socket)
+// and prints the analysis returned by the server.
+template <class Stream>
+int upload_logs(Stream& stream,
+    const ClientConfig& config,
+    const std::string& host,
+    const std::string& server_ip,
+    const std::string& server_port) {
+  beast::error_code ec;
+
+  // Prepare file paths
+  std::string dir = "./logs";
+  std::string json_path = path_cat(dir, "/log_file.json");
+  std::string xml_path = path_cat(dir, "/log_file.xml");
+  std::string txt_path = path_cat(dir, "/log_file.txt");
+
+  auto get_file_name = [](const std::string& path) -> std::string {
+    std::filesystem::path p(path);
+    return p.filename().string();
+  };
+
+  // Files are streamed from disk as-is when the request is written; nothing
+  // is read into memory here.
+  multipart_upload upload("----boundary1234567890", config.compress);
+  std::cout << "[INFO] Processing JSON file: " << get_file_name(json_path) << std::endl;
+  bool const has_json = upload.add_file("file_json", json_path, "application/json");
+  std::cout << "[INFO] Processing XML file: " << get_file_name(xml_path) << std::endl;
+  bool const has_xml = upload.add_file("file_xml", xml_path, "application/xml");
+  std::cout << "[INFO] Processing Text file: " << get_file_name(txt_path) << std::endl;
+  bool const has_txt = upload.add_file("file_txt", txt_path, "text/plain");
+
+  if (!has_json || !has_xml || !has_txt) {
+    std::cerr << "[ERROR] One or more files are missing or empty." << std::endl;
+    return 1;
+  }
+
+  double size_mb = static_cast<double>(upload.content_length()) / (1024 * 1024);
+  std::cout << "[INFO] Total upload size: " << std::fixed << std::setprecision(2) << size_mb
+            << " MB\n"
+            << std::endl;
+  // Prepare HTTP request headers only; the body is written part by part
+  http::request<http::buffer_body> req{http::verb::post, analysis_target(config, "/"), 11};
+  req.set(http::field::host, host);
+  req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
+  req.set(http::field::connection, "keep-alive");
+  req.set("Client-Id", config.clientId);
+  if (config.compress) req.set(http::field::accept_encoding, "gzip");
+  req.set(http::field::accept,
+      config.format == "msgpack" ? "application/vnd.msgpack" : "application/json");
+  upload.prepare(req);
+
+  // Send to Server. Every upload reuses this connection; with a pipeline depth
+  // above one, later requests are written before earlier responses arrive.
+  std::println("[INFO] Uploading log files...\n");
+  std::size_t const total_requests = static_cast<std::size_t>(config.requests);
+  std::size_t const pipeline_depth = static_cast<std::size_t>(config.pipeline);
+  std::size_t sent = 0, received = 0;
+  beast::flat_buffer buffer;
+  http::response<http::string_body> res;
+  auto const started = std::chrono::steady_clock::now();
+
+  while (received < total_requests) {
+    while (sent < total_requests && sent - received < pipeline_depth) {
+      beast::error_code write_ec;
+      upload.write(stream, req, write_ec);
+      if (write_ec) {
+        std::cerr << "[ERROR] Sending to server: " << write_ec.message() << std::endl;
+        return 1;
+      }
+      ++sent;
+    }
+
+    if (received == 0) {
+      std::println("[INFO] Request sent successfully");
+      std::println("[INFO] Awaiting server response...\n");
+    }
+
+    res = {};
+    http::read(stream, buffer, res, ec);
+    if (ec) {
+      std::cerr << "[ERROR] Reading response: " << ec.message() << std::endl;
+      return 1;
+    }
+    ++received;
+  }
+
+  if (total_requests > 1) {
+    std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - started;
+    std::println("[INFO] {} uploads in {:.3f} s ({:.1f} req/s, {:.2f} MB/s, pipeline depth {})\n",
+        total_requests,
+        elapsed.count(),
+        static_cast<double>(total_requests) / elapsed.count(),
+        size_mb * static_cast<double>(total_requests) / elapsed.count(),
+        pipeline_depth);
+  }
+
+  if (print_analysis(res, server_ip, server_port) != 0) return 1;
+
+  if (res.need_eof() || res.find(http::field::connection) == res.end() ||
+      res[http::field::connection] != "keep-alive") {
+    std::println("[INFO] Connection closed by server");
+  }
+  auto shutdown_result = stream.socket().shutdown(asio::socket_base::shutdown_both, ec);
+  boost::ignore_unused(shutdown_result);
+  return 0;
+}
+
+// Parses the log files here and uploads only their merged counts, then the
+// raw files for archival if asked to.
+template <class Stream>
+int upload_summary(Stream& stream,
+    const ClientConfig& config,
+    const std::string& host,
+    const std::string& server_ip,
+    const std::string& server_port) {
+  std::string const dir = "./logs";
+  std::vector<summary_input> const files{{path_cat(dir, "/log_file.json"), "application/json"},
+      {path_cat(dir, "/log_file.xml"), "application/xml"},
+      {path_cat(dir, "/log_file.txt"), "text/plain"}};
+
+  auto const started = std::chrono::steady_clock::now();
+  auto const summary =
+      summarize_logs(files, std::max(1u, std::thread::hardware_concurrency()));
+  if (!summary) return 1;
+  std::string encoded = cluster::wire::encode(summary->aggregate);
+  std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - started;
+  std::println("[INFO] Summarized {:.2f} MB of logs into {} bytes in {:.3f} s\n",
+      static_cast<double>(summary->bytes_parsed) / (1024 * 1024),
+      encoded.size(),
+      elapsed.count());
+
+  beast::error_code ec;
+  beast::flat_buffer buffer;
+  auto const exchange = [&](http::request<http::string_body>& req,
+                            http::response<http::string_body>& res) {
+    req.set(http::field::host, host);
+    req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
+    req.set(http::field::connection, "keep-alive");
+    req.set("Client-Id", config.clientId);
+    req.prepare_payload();
+    http::write(stream, req, ec);
+    if (!ec) http::read(stream, buffer, res, ec);
+    if (ec) std::cerr << "[ERROR] Talking to server: " << ec.message() << std::endl;
+    return !ec;
+  };
+
+  http::request<http::string_body> req{http::verb::post, analysis_target(config, "/summary"), 11};
+  req.set(http::field::content_type, cluster::wire::content_type);
+  if (config.compress) req.set(http::field::accept_encoding, "gzip");
+  req.set(http::field::accept,
+      config.format == "msgpack" ? "application/vnd.msgpack" : "application/json");
+  req.body() = std::move(encoded);
+  http::response<http::string_body> res;
+  if (!exchange(req, res) || print_analysis(res, server_ip, server_port) != 0) return 1;
+
+  // Stored by the server as they are; it does not parse them again. Each file
+  // is streamed from disk, and gzipped on the fly with --compress, so neither
+  // it nor its compressed form is ever held in memory whole.
+  if (config.archive) {
+    for (auto const& file : files) {
+      auto const upload = file_upload::open(file.path, file.content_type, config.compress);
+      if (!upload) {
+        std::println(stderr, "[ERROR] Cannot read {}", file.path.string());
+        return 1;
+      }
+      http::request<http::buffer_body> archive{http::verb::post, "/archive", 11};
+      archive.set(http::field::host, host);
+      archive.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
+      archive.set(http::field::connection, "keep-alive");
+      archive.set("Client-Id", config.clientId);
+      upload->prepare(archive);
+      upload->write(stream, archive, ec);
+      http::response<http::string_body> archived;
+      if (!ec) http::read(stream, buffer, archived, ec);
+      if (ec) {
+        std::cerr << "[ERROR] Talking to server: " << ec.message() << std::endl;
+        return 1;
+      }
+      if (archived.result() != http::status::created) {
+        std::println(stderr, "[ERROR] Archiving {}: {}", file.path.string(), archived.body());
+        return 1;
+      }
+      std::println("[INFO] Archived {}", file.path.filename().string());
+    }
+  }
+
+  auto shutdown_result = stream.socket().shutdown(asio::socket_base::shutdown_both, ec);
+  boost::ignore_unused(shutdown_result);
+  return 0;
+}
+
+volatile std::sig_atomic_t stop_following = 0;
+
+// Tails the text log and uploads the lines added since the last run, in small
+// batches over one connection, until interrupted. `reconnect` opens `stream`
+// again after the server closes it; a batch that was cut off is sent again,
+// and the server drops it if it had already counted it.
+template <class Stream, class Reconnect>
+int follow_logs(Stream& stream,
+    Reconnect reconnect,
+    const ClientConfig& config,
+    const std::string& host) {
+  std::string const path = path_cat("./logs", "/log_file.txt");
+  log_follower follower({path}, config.stateFile);
+  if (!follower.start()) return 1;
+  std::signal(SIGINT, [](int) { stop_following = 1; });
+  std::signal(SIGTERM, [](int) { stop_following = 1; });
+  std::println("[INFO] Following {}; offsets are kept in {}\n", path, config.stateFile);
+
+  beast::flat_buffer buffer;
+  // Retries every 2 s until the server is back; false if interrupted first.
+  auto const reconnect_with_retry = [&] {
+    buffer.clear();
+    while (!reconnect(stream)) {
+      if (stop_following) return false;
+      std::this_thread::sleep_for(std::chrono::seconds(2));
+    }
+    return true;
+  };
+
+  while (!stop_following) {
+    while (auto batch = follower.next_batch()) {
+      http::request<http::string_body> req{http::verb::post, "/tail", 11};
+      req.set(http::field::host, host);
+      req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
+      req.set(http::field::connection, "keep-alive");
+      req.set(http::field::content_type, "text/plain");
+      req.set("Client-Id", config.clientId);
+      req.set("Tail-File", batch->name);
+      req.set("Tail-Inode", std::to_string(batch->inode));
+      req.set("Tail-Offset", std::to_string(batch->offset));
+      req.body() = batch->data;
+      req.prepare_payload();
+
+      http::response<http::string_body> res;
+      beast::error_code ec;
+      http::write(stream, req, ec);
+      if (!ec) http::read(stream, buffer, res, ec);
+      if (ec) {
+        std::println(stderr, "[WARN] Sending batch: {}; reconnecting", ec.message());
+        if (!reconnect_with_retry()) return 0;
+        continue;
+      }
+      if (res.result() != http::status::ok) {
+        std::println(stderr, "[ERROR] Server answered {}: {}", res.result_int(), res.body());
+        return 1;
+      }
+      if (!follower.commit(*batch)) return 1;
+
+      // The batch is counted either way; an odd acknowledgement is only reported.
+      boost::system::error_code parse_ec;
+      auto const ack = boost::json::parse(res.body(), parse_ec);
+      auto const* fields = parse_ec ? nullptr : ack.if_object();
+      auto const* status = fields ? fields->if_contains("status") : nullptr;
+      auto const* total = fields ? fields->if_contains("total_entries") : nullptr;
+      if (status && status->is_string() && total && total->is_int64()) {
+        std::println("[INFO] Sent {} bytes at offset {} ({}); {} entries so far",
+            batch->data.size(),
+            batch->offset,
+            status->get_string().c_str(),
+            total->get_int64());
+      } else {
+        std::println(stderr,
+            "[WARN] Sent {} bytes at offset {}; unexpected acknowledgement: {}",
+            batch->data.size(),
+            batch->offset,
+            res.body());
+      }
+      if (res.need_eof() && !reconnect_with_retry()) return 0;
+    }
+    follower.wait(std::chrono::seconds(1));
+  }
+  beast::error_code ec;
+  auto shutdown_result = stream.socket().shutdown(asio::socket_base::shutdown_both, ec);
+  boost::ignore_unused(shutdown_result);
+  return 0;
+}
+
 int main(int argc, char* argv[]) {
   auto cfg = parse_cli_args_client(argc, argv);
 
@@ -23,11 +363,43 @@ int main(int argc, char* argv[]) {
 
   const ClientConfig& config = *cfg;
 
+  if (config.bench) return run_bench(config);
+
   try {
     std::string host = "0.0.0.0";
     asio::io_context ioc;
-    tcp::resolver resolver(ioc);
     beast::error_code ec;
+
+    if (!config.unixSocket.empty()) {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+      beast::basic_stream<asio::local::stream_protocol> stream(ioc);
+      stream.connect(asio::local::stream_protocol::endpoint{config.unixSocket}, ec);
+      if (ec) {
+        std::cerr << "[ERROR] Connecting to Server: " << ec.message() << std::endl;
+        return 1;
+      }
+
+      std::cout << "[INFO] Connected to server on UNIX socket: " << config.unixSocket << std::endl;
+      if (config.follow) {
+        auto const reconnect = [&](auto& s) {
+          beast::error_code connect_ec;
+          s.close();
+          s.connect(asio::local::stream_protocol::endpoint{config.unixSocket}, connect_ec);
+          return !connect_ec;
+        };
+        return follow_logs(stream, reconnect, config, "localhost");
+      }
+      if (config.summarize) {
+        return upload_summary(stream, config, "localhost", config.unixSocket, "unix");
+      }
+      return upload_logs(stream, config, "localhost", config.unixSocket, "unix");
+#else
+      std::cerr << "[ERROR] UNIX domain sockets are not supported on this platform" << std::endl;
+      return 1;
+#endif
+    }
+
+    tcp::resolver resolver(ioc);
     beast::tcp_stream stream(ioc);
 
     auto const result = resolver.resolve(host, std::to_string(config.port), ec);
@@ -45,119 +417,20 @@ int main(int argc, char* argv[]) {
 
     std::cout << "[INFO] Connected to server on IP: " << server_ip << " , PORT: " << server_port
               << std::endl;
-    // Prepare file paths
-    std::string dir = "./logs";
-    std::string json_path = path_cat(dir, "/log_file.json");
-    std::string xml_path = path_cat(dir, "/log_file.xml");
-    std::string txt_path = path_cat(dir, "/log_file.txt");
-
-    // Read files into strings
-    auto read_file = [](const std::string& path) -> std::string {
-      std::ifstream file(path, std::ios::binary);
-      if (!file) return "";
-      std::ostringstream ss;
-      ss << file.rdbuf();
-      return ss.str();
-    };
-
-    auto get_file_name = [](const std::string& path) -> std::string {
-      std::filesystem::path p(path);
-      return p.filename().string();
-    };
-    // simdjson::dom::parser parser;
-    // simdjson::dom::element json_data = parser.load(json_path);
-
-    simdjson::ondemand::parser parser;
-    auto json_file = simdjson::padded_string::load(json_path);
-    simdjson::ondemand::document json_data = parser.iterate(json_file);
-    std::string xml_data = read_file(xml_path);
-    std::string txt_data = read_file(txt_path);
-
-    if (json_data.is_null() || xml_data.empty() || txt_data.empty()) {
-      std::cerr << "[ERROR] One or more files are missing or empty." << std::endl;
-      return 1;
-    }
-    // Create multipart/form-data body
-    std::string boundary = "----boundary1234567890";
-    std::ostringstream body_stream;
-    std::cout << "[INFO] Processing JSON file: " << get_file_name(json_path) << std::endl;
-    body_stream << "--" << boundary << "\r\n"
-                << "Content-Disposition: form-data; name=\"file_json\"; "
-                   "filename=\"log_file.json\"\r\n"
-                << "Content-Type: application/json\r\n\r\n"
-                << json_data << "\r\n";
-
-    std::cout << "[INFO] Processing XML file: " << get_file_name(xml_path) << std::endl;
-    body_stream << "--" << boundary << "\r\n"
-                << "Content-Disposition: form-data; name=\"file_xml\"; "
-                   "filename=\"log_file.xml\"\r\n"
-                << "Content-Type: application/xml\r\n\r\n"
-                << xml_data << "\r\n";
-
-    std::cout << "[INFO] Processing Text file: " << get_file_name(txt_path) << std::endl;
-    body_stream << "--" << boundary << "\r\n"
-                << "Content-Disposition: form-data; name=\"file_txt\"; "
-                   "filename=\"log_file.txt\"\r\n"
-                << "Content-Type: text/plain\r\n\r\n"
-                << txt_data << "\r\n"
-                << "--" << boundary << "--\r\n";
-
-    std::string body_str = body_stream.str();
-    size_t total_size = body_str.size();
-    double size_mb = static_cast<double>(total_size) / (1024 * 1024);
-    std::cout << "[INFO] Total upload size: " << std::fixed << std::setprecision(2) << size_mb
-              << " MB\n"
-              << std::endl;
-    // Prepare HTTP request headers only (no body yet)
-    http::request<http::dynamic_body> req{http::verb::post, "/", 11};
-    req.set(http::field::host, host);
-    req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
-    req.set(http::field::connection, "keep-alive");
-    req.set("Client-Id", config.clientId);
-    req.set(http::field::content_length, std::to_string(total_size));
-    req.set(http::field::content_type, "multipart/form-data; boundary=" + boundary);
-
-    auto body_buffer = req.body().prepare(total_size);
-    boost::ignore_unused(asio::buffer_copy(body_buffer, asio::buffer(body_str)));
-    req.body().commit(total_size);
-
-    // Send to Server
-    std::println("[INFO] Uploading log files...\n");
-    beast::error_code write_ec;
-    http::write(stream, req, write_ec);
-    if (write_ec) {
-      std::cerr << "[ERROR] Sending to server: " << write_ec.message() << std::endl;
-      return 1;
+    if (config.follow) {
+      auto const reconnect = [&](beast::tcp_stream& s) {
+        beast::error_code connect_ec;
+        s.close();
+        s.connect(result, connect_ec);
+        if (!connect_ec) s.socket().set_option(tcp::no_delay(true));
+        return !connect_ec;
+      };
+      return follow_logs(stream, reconnect, config, host);
     }
-
-    beast::flat_buffer buffer;
-    http::response<http::string_body> res;
-
-    std::println("[INFO] Request sent successfully");
-    std::println("[INFO] Awaiting server response...\n");
-
-    http::read(stream, buffer, res, ec);
-    if (ec) {
-      std::cerr << "[ERROR] Reading response: " << ec.message() << std::endl;
-      return 1;
-    }
-
-    boost::json::value data = boost::json::parse(res.body());
-
-    std::println("ANALYSIS: LOG LEVEL");
-    std::println("SERVER IP: {}", server_ip);
-    std::println("SERVER PORT: {}", server_port);
-    std::println("INVALID DATA: {}", static_cast<int>(data.at("invalid_data").as_int64()));
-    std::println("TOTAL ENTRIES: {}", static_cast<int>(data.at("total_entries").as_int64()));
-
-    print_response(data.at("message_stats"));
-
-    if (res.need_eof() || res.find(http::field::connection) == res.end() ||
-        res[http::field::connection] != "keep-alive") {
-      std::println("[INFO] Connection closed by server");
+    if (config.summarize) {
+      return upload_summary(stream, config, host, server_ip, std::to_string(server_port));
     }
-    auto shutdown_result = stream.socket().shutdown(tcp::socket::shutdown_both, ec);
-    boost::ignore_unused(shutdown_result);
+    return upload_logs(stream, config, host, server_ip, std::to_string(server_port));
   } catch (std::exception& error) {
     std::println(stderr, "[ERROR] Reason: {}", error.what());
   }
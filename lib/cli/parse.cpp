@@ -30,6 +30,58 @@ std::optional<ClientConfig> parse_cli_args_client(int argc, char** argv) {
         return "";
       });
 
+  app.add_option("-n,--requests", config.requests, "number of uploads sent over one connection")
+      ->check(CLI::PositiveNumber);
+
+  // The server reads at most 16 requests ahead of the response it is writing.
+  app.add_option("--pipeline",
+         config.pipeline,
+         "uploads in flight on the connection. range (1 to 16)")
+      ->check(CLI::Range(1, 16));
+
+  app.add_option("--unix-socket",
+      config.unixSocket,
+      "connect over a UNIX domain socket at this path instead of TCP");
+  app.add_flag("--compress",
+      config.compress,
+      "gzip uploads on the fly and accept gzipped responses");
+  app.add_option("--format", config.format, "analysis response encoding: json or msgpack")
+      ->check(CLI::IsMember({"json", "msgpack"}));
+  app.add_option("--top", config.top, "only the N most frequent messages per level")
+      ->check(CLI::PositiveNumber);
+  app.add_option("--min-count", config.minCount, "leave out messages seen fewer times than this")
+      ->check(CLI::NonNegativeNumber);
+  app.add_flag("--summarize",
+      config.summarize,
+      "parse the logs here and upload only their merged counts");
+  app.add_flag("--archive",
+      config.archive,
+      "with --summarize, also upload the raw files to be stored, not parsed");
+  app.add_flag("--follow",
+      config.follow,
+      "tail ./logs/log_file.txt and upload only lines added since the last upload");
+  app.add_option("--state-file", config.stateFile, "where --follow keeps the offsets it has sent");
+
+  app.add_flag("--bench",
+      config.bench,
+      "load-generator mode: synthetic uploads, -n requests per connection");
+  app.add_option("--connections", config.connections, "concurrent connections in bench mode")
+      ->check(CLI::PositiveNumber);
+  app.add_option("--rate",
+         config.rate,
+         "total requests/s in bench mode (open loop); 0 for closed loop")
+      ->check(CLI::NonNegativeNumber);
+  app.add_option("--bench-lines",
+         config.benchLines,
+         "log records per format in each synthetic upload")
+      ->check(CLI::PositiveNumber);
+  app.add_option("--bench-json",
+      config.benchJson,
+      "write the bench report as JSON to this path, - for stdout");
+  app.add_flag("--spread-clients",
+      config.spreadClients,
+      "give every bench connection its own Client-Id, to spread them over a sharded cluster");
+
   if (argc == 1) {
     std::cout << app.help() << std::endl;
     return std::nullopt;
@@ -47,7 +99,8 @@ std::optional<ClientConfig> parse_cli_args_client(int argc, char** argv) {
   return config;
 };
 
-unsigned short parse_cli_args_server(int argc, char** argv) {
+std::optional<ServerConfig> parse_cli_args_server(int argc, char** argv) {
+  ServerConfig config;
   int port = 9000;
 
   CLI::App app{"Distributed Log Analysis System Server"};
@@ -64,13 +117,87 @@ unsigned short parse_cli_args_server(int argc, char** argv) {
         return "";
       });
 
-  CLI11_PARSE(app, argc, argv);
+  app.add_option("--unix-socket",
+      config.unixSocket,
+      "also accept connections on a UNIX domain socket at this path");
+
+  app.add_option("--shm-ring",
+      config.shmRings,
+      "create a shared-memory ingestion ring with this name (e.g. /log-analysis); repeatable");
+  app.add_option("--shm-ring-size", config.shmRingMb, "request ring size in MiB")
+      ->check(CLI::Range(1, 4096));
+
+  app.add_option("--trace-file",
+      config.traceFile,
+      "write sampled request traces to this file (Chrome trace-event JSON)");
+  app.add_option("--trace-sample-rate",
+         config.traceSampleRate,
+         "fraction of uploads traced. range (0 to 1)")
+      ->check(CLI::Range(0.0, 1.0));
+
+  app.add_option("--log-level", config.logLevel, "lowest level logged")
+      ->check(CLI::IsMember({"trace", "debug", "info", "warn", "error", "off"}));
+  app.add_option("--log-rate-limit",
+      config.logRateLimit,
+      "most records per second from any one log statement; 0 for no limit");
+
+  app.add_option("--file-cache-size", config.fileCacheMb, "memory for cached static files in MiB")
+      ->check(CLI::Range(0, 4096));
+  app.add_option("--file-cache-max-file",
+      config.fileCacheMaxKb,
+      "largest static file kept in the cache, in KiB");
+
+  app.add_flag("--coordinator",
+      config.coordinator,
+      "accept partial aggregates from leaf servers and serve the merged view");
+  app.add_option("--upstream",
+      config.upstream,
+      "push partial aggregates to the coordinator at host:port");
+  app.add_option("--node-id",
+      config.nodeId,
+      "name of this node in pushes and in the ring file (default hostname:port)");
+  app.add_option("--push-interval", config.pushInterval, "seconds between pushes upstream")
+      ->check(CLI::Range(0.1, 3600.0));
+
+  app.add_option("--ring",
+      config.ringFile,
+      "shard uploads by Client-Id over the nodes in this file; reloaded when it changes");
+  app.add_option("--shard-mode",
+      config.shardMode,
+      "forward uploads another node owns to it, or redirect the client there")
+      ->check(CLI::IsMember({"forward", "redirect"}));
+
+  app.add_option("--live-interval",
+      config.liveInterval,
+      "seconds between frames of the /live dashboard feed, 0 to turn it off")
+      ->check(CLI::Range(0.0, 3600.0));
+  app.add_option("--live-top", config.liveTop, "most frequent messages in each live frame")
+      ->check(CLI::Range(1, 1000));
+
+  app.add_option("--limits",
+      config.limitsFile,
+      "per-client request and byte rates and queue weights; reloaded when it changes");
+
+  app.add_option("--analysis-cache",
+      config.analysisCacheMb,
+      "MiB of analyses of uploaded content kept for identical uploads; 0 to parse every upload");
+
+  try {
+    app.parse(argc, argv);
+  } catch (const CLI::ParseError& error) {
+    app.exit(error);
+    return std::nullopt;
+  }
 
   if (port == 9000) {
     std::println("[INFO] No port provided, Using default port: {}", port);
   }
 
   std::println("[INFO] Server running on port {}", port);
+  if (!config.unixSocket.empty()) {
+    std::println("[INFO] Server listening on UNIX socket {}", config.unixSocket);
+  }
 
-  return static_cast<unsigned short>(port);
-};
+  config.port = static_cast<unsigned short>(port);
+  return config;
+};
\ No newline at end of file
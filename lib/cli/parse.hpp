@@ -1,12 +1,55 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <optional>
 #include <string>
+#include <vector>
 
 struct ClientConfig {
   int port = 7654;
   std::string clientId{};
+  int requests = 1;  // Uploads sent over one connection
+  int pipeline = 1;  // Uploads allowed in flight before reading a response
+  std::string unixSocket{};  // Connect over this UNIX domain socket instead of TCP
+  bool compress = false;     // Gzip uploads and accept gzipped responses
+  std::string format = "json";  // Analysis encoding asked for: json or msgpack
+  std::size_t top = 0;          // Most frequent messages per level to ask for, 0 for all
+  std::int64_t minCount = 0;    // Leave out messages seen fewer times than this
+  bool summarize = false;       // Parse locally and upload only the merged counts
+  bool archive = false;         // With summarize, also upload the raw files for archival
+  bool follow = false;          // Tail the text log, uploading only new lines
+  std::string stateFile = "./logs/.follow_state";  // Offsets already sent by --follow
+  bool bench = false;        // Load-generator mode with synthetic payloads
+  int connections = 8;       // Concurrent connections in bench mode
+  double rate = 0;           // Total requests/s in bench mode; 0 runs closed-loop
+  int benchLines = 1000;     // Log records per format in each synthetic upload
+  std::string benchJson{};   // Write the bench report as JSON here ("-" for stdout)
+  bool spreadClients = false;  // Give every bench connection its own Client-Id
+};
+
+struct ServerConfig {
+  unsigned short port = 9000;
+  std::string unixSocket{};  // Also listen on this UNIX domain socket path when set
+  std::vector<std::string> shmRings{};  // Shared-memory ingestion regions to create
+  std::size_t shmRingMb = 64;           // Request ring size per region
+  std::string traceFile{};               // Chrome trace-event output for sampled requests
+  double traceSampleRate = 0.01;         // Fraction of POST requests traced
+  std::string logLevel = "info";         // Lowest level written by the logger
+  std::uint32_t logRateLimit = 0;        // Records per second per log statement, 0 for no limit
+  std::size_t fileCacheMb = 16;          // Memory for cached static files
+  std::size_t fileCacheMaxKb = 256;      // Larger static files are streamed from disk
+  bool coordinator = false;              // Accept partial aggregates from leaf servers
+  std::string upstream{};                // Coordinator (host:port) to push partials to
+  std::string nodeId{};                  // Name in pushes and the ring; defaults to hostname:port
+  double pushInterval = 5;               // Seconds between pushes
+  std::string ringFile{};                // Shard uploads by Client-Id over the nodes listed here
+  std::string shardMode = "forward";     // Other nodes' uploads: forward or redirect
+  double liveInterval = 1;               // Seconds between /live frames, 0 for no feed
+  std::size_t liveTop = 10;              // Messages in each live frame's top list
+  std::string limitsFile{};              // Per-client rate limits and weights; reloaded on change
+  std::size_t analysisCacheMb = 64;      // Analyses of stored content kept for duplicates
 };
 
 std::optional<ClientConfig> parse_cli_args_client(int, char**);
-unsigned short parse_cli_args_server(int, char**);
\ No newline at end of file
+std::optional<ServerConfig> parse_cli_args_server(int, char**);
\ No newline at end of file
@@ -0,0 +1,303 @@
+#include "bench.hpp"
+
+#include <array>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/version.hpp>
+#include <boost/json.hpp>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "histogram.hpp"
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace asio = boost::asio;
+using tcp = asio::ip::tcp;
+using bench_clock = std::chrono::steady_clock;
+
+namespace {
+
+struct connection_result {
+  latency_histogram latency_ns;
+  std::uint64_t completed = 0;
+  std::uint64_t errors = 0;
+  std::uint64_t bytes_sent = 0;
+  std::uint64_t bytes_received = 0;
+  std::string error_message;
+};
+
+// One upload with a JSON, an XML and a text part of `lines` records each, in
+// the formats the server parses.
+std::string synthetic_multipart(const std::string& boundary, std::size_t lines) {
+  static constexpr std::array levels{"INFO", "DEBUG", "WARN", "ERROR", "CRITICAL"};
+  std::string json = "[", xml = "<logs>", txt;
+  for (std::size_t i = 0; i < lines; ++i) {
+    auto const level = levels[i % levels.size()];
+    auto const message = std::format("synthetic message {}", i % 100);
+    json += std::format(R"({}{{"log_level":"{}","message":"{}"}})", i ? "," : "", level, message);
+    xml += std::format("<log><log_level>{}</log_level><message>{}</message></log>", level, message);
+    txt += std::format("2026-01-01 00:00:00|{}|{}|bench\n", level, message);
+  }
+  json += "]";
+  xml += "</logs>";
+
+  std::string body;
+  auto add_part = [&](const char* field,
+                      const char* filename,
+                      const char* type,
+                      const std::string& data) {
+    body += "--" + boundary + "\r\n";
+    body += std::format(
+        "Content-Disposition: form-data; name=\"{}\"; filename=\"{}\"\r\n", field, filename);
+    body += std::format("Content-Type: {}\r\n\r\n", type);
+    body += data;
+    body += "\r\n";
+  };
+  add_part("file_json", "bench.json", "application/json", json);
+  add_part("file_xml", "bench.xml", "application/xml", xml);
+  add_part("file_txt", "bench.txt", "text/plain", txt);
+  body += "--" + boundary + "--\r\n";
+  return body;
+}
+
+// A sharded server redirects a client it does not own; a connection follows
+// at most this many redirects.
+constexpr int max_redirects = 3;
+
+// Splits "http://host:port/..." into host and port.
+bool parse_location(std::string_view location, std::string& host, std::string& port) {
+  constexpr std::string_view scheme = "http://";
+  if (!location.starts_with(scheme)) return false;
+  location.remove_prefix(scheme.size());
+  location = location.substr(0, location.find('/'));
+  auto const colon = location.rfind(':');
+  if (colon == std::string_view::npos || colon == 0 || colon + 1 == location.size()) return false;
+  host = location.substr(0, colon);
+  port = location.substr(colon + 1);
+  return true;
+}
+
+// Sends requests [next, requests) on the stream. Returns the Location of a
+// redirect, with `next` left at the redirected request, or an empty string.
+template <class Stream>
+std::string drive_connection(Stream& stream,
+    const http::request<http::string_body>& req,
+    std::size_t& next,
+    std::size_t requests,
+    bench_clock::duration interval,
+    bench_clock::time_point start,
+    connection_result& result) {
+  beast::flat_buffer buffer;
+  for (; next < requests; ++next) {
+    std::size_t const i = next;
+    // In open loop the clock starts at the scheduled send time, not the actual
+    // one, so a stalled server shows up as latency instead of silently lowering
+    // the offered load (coordinated omission).
+    auto scheduled = bench_clock::now();
+    if (interval.count() > 0) {
+      scheduled = start + interval * i;
+      std::this_thread::sleep_until(scheduled);
+    }
+
+    beast::error_code ec;
+    result.bytes_sent += http::write(stream, req, ec);
+    http::response<http::string_body> res;
+    if (!ec) result.bytes_received += http::read(stream, buffer, res, ec);
+    if (ec) {
+      result.errors += requests - i;
+      result.error_message = ec.message();
+      return {};
+    }
+    if (res.result() == http::status::temporary_redirect) {
+      return std::string(res[http::field::location]);
+    }
+
+    auto const latency = bench_clock::now() - scheduled;
+    result.latency_ns.record(static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count()));
+    if (res.result() == http::status::ok) {
+      ++result.completed;
+    } else {
+      ++result.errors;
+      result.error_message = std::format("HTTP {}", res.result_int());
+    }
+  }
+  return {};
+}
+
+void run_connection(const ClientConfig& config,
+    const http::request<http::string_body>& req,
+    std::size_t requests,
+    bench_clock::duration interval,
+    bench_clock::time_point start,
+    connection_result& result) {
+  asio::io_context ioc;
+  beast::error_code ec;
+  std::size_t next = 0;
+  std::string location;
+
+  if (!config.unixSocket.empty()) {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    beast::basic_stream<asio::local::stream_protocol> stream(ioc);
+    stream.connect(asio::local::stream_protocol::endpoint{config.unixSocket}, ec);
+    if (!ec) location = drive_connection(stream, req, next, requests, interval, start, result);
+#else
+    ec = asio::error::operation_not_supported;
+#endif
+  } else {
+    std::string host = "0.0.0.0", port = std::to_string(config.port);
+    for (int redirects = 0; !ec; ++redirects) {
+      tcp::resolver resolver(ioc);
+      beast::tcp_stream stream(ioc);
+      auto const endpoints = resolver.resolve(host, port, ec);
+      if (!ec) stream.connect(endpoints, ec);
+      if (ec) break;
+      stream.socket().set_option(tcp::no_delay(true));
+      location = drive_connection(stream, req, next, requests, interval, start, result);
+      if (location.empty() || redirects == max_redirects) break;
+      if (!parse_location(location, host, port)) break;
+    }
+  }
+
+  if (!ec && location.empty()) return;
+  result.errors += requests - next;
+  result.error_message = ec ? ec.message() : "unfollowed redirect to " + location;
+}
+
+}  // namespace
+
+int run_bench(const ClientConfig& config) {
+  auto const connections = static_cast<std::size_t>(config.connections);
+  auto const requests = static_cast<std::size_t>(config.requests);
+  bool const open_loop = config.rate > 0;
+
+  // Payloads are built once up front; the run measures the server, not formatting.
+  std::string const boundary = "----bench-boundary";
+  http::request<http::string_body> req{http::verb::post, "/", 11};
+  req.set(http::field::host, "0.0.0.0");
+  req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
+  req.set(http::field::connection, "keep-alive");
+  req.set(http::field::content_type, "multipart/form-data; boundary=" + boundary);
+  req.set("Client-Id", config.clientId.empty() ? "bench" : config.clientId);
+  req.body() = synthetic_multipart(boundary, static_cast<std::size_t>(config.benchLines));
+  req.prepare_payload();
+
+  std::println("[INFO] Bench: {} connections x {} requests, {}, {:.1f} KiB per upload",
+      connections,
+      requests,
+      open_loop ? std::format("open loop at {} req/s", config.rate) : std::string("closed loop"),
+      static_cast<double>(req.body().size()) / 1024);
+
+  // Each connection gets an equal share of the target rate; their schedules
+  // are staggered so the fleet does not fire in lockstep.
+  bench_clock::duration interval{};
+  if (open_loop) {
+    interval = std::chrono::duration_cast<bench_clock::duration>(
+        std::chrono::duration<double>(static_cast<double>(connections) / config.rate));
+  }
+
+  // With --spread-clients, connection i sends as "<Client-Id>-i".
+  std::vector<http::request<http::string_body>> spread;
+  if (config.spreadClients) {
+    spread.reserve(connections);
+    for (std::size_t i = 0; i < connections; ++i) {
+      auto& copy = spread.emplace_back(req);
+      copy.set("Client-Id", std::format("{}-{}", std::string(req["Client-Id"]), i));
+    }
+  }
+
+  std::vector<connection_result> results(connections);
+  std::vector<std::thread> threads;
+  threads.reserve(connections);
+  auto const start = bench_clock::now();
+  for (std::size_t i = 0; i < connections; ++i) {
+    threads.emplace_back([&, i] {
+      auto const first = start + interval * i / connections;
+      run_connection(config,
+          config.spreadClients ? spread[i] : req,
+          requests,
+          interval,
+          first,
+          results[i]);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  std::chrono::duration<double> const elapsed = bench_clock::now() - start;
+
+  connection_result total;
+  for (auto const& result : results) {
+    total.latency_ns.merge(result.latency_ns);
+    total.completed += result.completed;
+    total.errors += result.errors;
+    total.bytes_sent += result.bytes_sent;
+    total.bytes_received += result.bytes_received;
+    if (!result.error_message.empty()) total.error_message = result.error_message;
+  }
+
+  auto const& latency = total.latency_ns;
+  auto us = [](std::uint64_t ns) { return static_cast<double>(ns) / 1000; };
+  double const throughput = static_cast<double>(total.completed) / elapsed.count();
+  double const bytes_per_s =
+      static_cast<double>(total.bytes_sent + total.bytes_received) / elapsed.count();
+
+  std::println("[INFO] {} ok, {} errors in {:.3f} s",
+      total.completed,
+      total.errors,
+      elapsed.count());
+  if (total.errors > 0) std::println(stderr, "[ERROR] Last error: {}", total.error_message);
+  std::println("throughput: {:.1f} req/s, {:.2f} MB/s", throughput, bytes_per_s / (1024 * 1024));
+  std::println(
+      "latency (us): p50 {:.1f}  p90 {:.1f}  p99 {:.1f}  p999 {:.1f}  max {:.1f}  mean {:.1f}",
+      us(latency.percentile(50)),
+      us(latency.percentile(90)),
+      us(latency.percentile(99)),
+      us(latency.percentile(99.9)),
+      us(latency.max()),
+      latency.mean() / 1000);
+
+  if (!config.benchJson.empty()) {
+    boost::json::object const report{
+        {"mode", open_loop ? "open" : "closed"},
+        {"connections", connections},
+        {"requests_per_connection", requests},
+        {"target_rate", config.rate},
+        {"request_bytes", req.body().size()},
+        {"completed", total.completed},
+        {"errors", total.errors},
+        {"duration_s", elapsed.count()},
+        {"throughput_rps", throughput},
+        {"bytes_per_s", bytes_per_s},
+        {"latency_us",
+            {{"p50", us(latency.percentile(50))},
+                {"p90", us(latency.percentile(90))},
+                {"p99", us(latency.percentile(99))},
+                {"p999", us(latency.percentile(99.9))},
+                {"min", us(latency.min())},
+                {"max", us(latency.max())},
+                {"mean", latency.mean() / 1000}}},
+    };
+
+    if (config.benchJson == "-") {
+      std::println("{}", boost::json::serialize(report));
+    } else {
+      std::ofstream out(config.benchJson);
+      out << boost::json::serialize(report) << '\n';
+      if (!out) {
+        std::println(stderr, "[ERROR] Cannot write bench report to {}", config.benchJson);
+        return 1;
+      }
+    }
+  }
+
+  return total.errors > 0 ? 1 : 0;
+}
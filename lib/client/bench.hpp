@@ -0,0 +1,11 @@
+#pragma once
+
+#include "../cli/parse.hpp"
+
+// Load generator behind the client's --bench flag. Opens config.connections
+// connections, sends config.requests synthetic uploads on each and reports
+// throughput and latency percentiles. With config.rate set, requests are sent
+// on a fixed schedule (open loop) and latency is measured from the scheduled
+// send time; otherwise each connection sends as soon as the previous response
+// arrives (closed loop). Returns the process exit code.
+int run_bench(const ClientConfig& config);
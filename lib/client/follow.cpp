@@ -0,0 +1,158 @@
+#include "follow.hpp"
+
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <print>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+namespace {
+
+// After a change, further writes this close behind go in the same batches.
+constexpr auto linger = std::chrono::milliseconds(100);
+
+}  // namespace
+
+log_follower::log_follower(std::vector<std::filesystem::path> files,
+    std::filesystem::path state_file,
+    std::size_t max_batch)
+    : state_file_(std::move(state_file)), max_batch_(max_batch) {
+  for (auto& path : files) files_.push_back({std::move(path)});
+}
+
+log_follower::~log_follower() {
+  if (inotify_fd_ >= 0) ::close(inotify_fd_);
+}
+
+bool log_follower::start() {
+  // One "inode offset path" line per file.
+  if (std::ifstream state{state_file_}) {
+    std::string line;
+    while (std::getline(state, line)) {
+      std::istringstream fields(line);
+      std::uint64_t inode = 0, offset = 0;
+      std::string path;
+      if (!(fields >> inode >> offset) || !std::getline(fields >> std::ws, path)) {
+        std::println(stderr, "[ERROR] Malformed line in {}: '{}'", state_file_.string(), line);
+        return false;
+      }
+      for (auto& file : files_) {
+        if (file.path == path) {
+          file.inode = inode;
+          file.offset = offset;
+        }
+      }
+    }
+  }
+
+#ifdef __linux__
+  inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd_ < 0) {
+    std::println(stderr, "[ERROR] inotify_init1: {}", std::strerror(errno));
+    return false;
+  }
+  // Directories rather than files, so rotated and recreated files are seen.
+  std::set<std::filesystem::path> directories;
+  for (auto const& file : files_) directories.insert(file.path.parent_path());
+  for (auto const& directory : directories) {
+    auto const watched = directory.empty() ? std::filesystem::path(".") : directory;
+    if (::inotify_add_watch(inotify_fd_,
+            watched.c_str(),
+            IN_MODIFY | IN_CREATE | IN_MOVED_TO | IN_CLOSE_WRITE) < 0) {
+      std::println(stderr, "[ERROR] Watching {}: {}", watched.string(), std::strerror(errno));
+      return false;
+    }
+  }
+#endif
+  return true;
+}
+
+std::optional<tail_batch> log_follower::next_batch() {
+  for (std::size_t i = 0; i < files_.size(); ++i) {
+    auto& file = files_[i];
+    struct stat info {};
+    if (::stat(file.path.c_str(), &info) != 0) continue;  // Not written yet
+    auto const inode = static_cast<std::uint64_t>(info.st_ino);
+    auto const size = static_cast<std::uint64_t>(info.st_size);
+    // A new inode is a rotated file; a shorter one was truncated.
+    if (inode != file.inode || size < file.offset) {
+      file.inode = inode;
+      file.offset = 0;
+    }
+    if (size == file.offset) continue;
+
+    std::ifstream in(file.path, std::ios::binary);
+    if (!in.seekg(static_cast<std::streamoff>(file.offset))) continue;
+    std::string data(std::min<std::uint64_t>(size - file.offset, max_batch_), '\0');
+    in.read(data.data(), static_cast<std::streamsize>(data.size()));
+    data.resize(static_cast<std::size_t>(in.gcount()));
+
+    // Only whole lines; the rest is sent once its newline is written.
+    auto const newline = data.rfind('\n');
+    if (newline != std::string::npos) {
+      data.resize(newline + 1);
+    } else if (data.size() < max_batch_) {
+      continue;
+    }
+    return tail_batch{i, file.path.filename().string(), inode, file.offset, std::move(data)};
+  }
+  return std::nullopt;
+}
+
+bool log_follower::commit(tail_batch const& batch) {
+  auto& file = files_[batch.file];
+  if (file.inode == batch.inode && file.offset == batch.offset) {
+    file.offset += batch.data.size();
+  }
+  return save_state();
+}
+
+bool log_follower::save_state() const {
+  // Written aside and renamed over the old state, so a crash leaves one or
+  // the other intact.
+  auto temporary = state_file_;
+  temporary += ".tmp";
+  {
+    std::ofstream out(temporary, std::ios::trunc);
+    for (auto const& file : files_) {
+      out << file.inode << ' ' << file.offset << ' ' << file.path.string() << '\n';
+    }
+    if (!out.flush()) {
+      std::println(stderr, "[ERROR] Writing {}", temporary.string());
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(temporary, state_file_, ec);
+  if (ec) {
+    std::println(stderr, "[ERROR] Saving {}: {}", state_file_.string(), ec.message());
+    return false;
+  }
+  return true;
+}
+
+void log_follower::wait(std::chrono::milliseconds timeout) {
+#ifdef __linux__
+  pollfd watch{inotify_fd_, POLLIN, 0};
+  if (::poll(&watch, 1, static_cast<int>(timeout.count())) <= 0) return;
+  std::this_thread::sleep_for(linger);
+  // The events themselves are not needed: every file is checked again.
+  alignas(inotify_event) char events[4096];
+  while (::read(inotify_fd_, events, sizeof(events)) > 0) {
+  }
+#else
+  std::this_thread::sleep_for(timeout);
+#endif
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Tail mode behind --follow: remembers how far each text log has been sent,
+// by inode and offset, in a small state file, and hands out only the complete
+// lines written since. Runs survive restarts and notice rotated or truncated
+// files, which start over from their first byte.
+struct tail_batch {
+  std::size_t file;  // Index into the followed files
+  std::string name;  // File name, sent as Tail-File
+  std::uint64_t inode;
+  std::uint64_t offset;  // Where `data` starts in the file
+  std::string data;      // Whole lines only
+};
+
+class log_follower {
+ public:
+  // Batches hold at most `max_batch` bytes; a single longer line is sent in
+  // pieces of that size.
+  log_follower(std::vector<std::filesystem::path> files,
+      std::filesystem::path state_file,
+      std::size_t max_batch = 64 * 1024);
+  ~log_follower();
+  log_follower(const log_follower&) = delete;
+  log_follower& operator=(const log_follower&) = delete;
+
+  // Loads the saved offsets and starts watching the files' directories.
+  // Returns false, after printing why, if either fails.
+  bool start();
+
+  // The next unsent lines of any file, or nothing if all have been sent.
+  std::optional<tail_batch> next_batch();
+
+  // Marks `batch` as delivered and saves the new offsets.
+  bool commit(tail_batch const& batch);
+
+  // Blocks until a followed file may have changed or `timeout` passes.
+  void wait(std::chrono::milliseconds timeout);
+
+ private:
+  struct followed {
+    std::filesystem::path path;
+    std::uint64_t inode = 0;
+    std::uint64_t offset = 0;
+  };
+
+  bool save_state() const;
+
+  std::vector<followed> files_;
+  std::filesystem::path state_file_;
+  std::size_t max_batch_;
+  int inotify_fd_ = -1;
+};
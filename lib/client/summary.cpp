@@ -0,0 +1,102 @@
+#include "summary.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <print>
+#include <string_view>
+#include <thread>
+
+#include "../file/handler.hpp"
+
+namespace {
+
+// Text is parsed in pieces of about this size.
+constexpr std::size_t text_chunk = std::size_t{4} << 20;
+
+struct parse_task {
+  std::string_view data;
+  std::string_view content_type;
+  std::filesystem::path const* path;
+};
+
+computed_data parse(parse_task const& task) {
+  if (task.content_type == "application/json") return process_json_request(task.data);
+  if (task.content_type == "application/xml") return parse_xml_file(task.data);
+  return parse_text_file(task.data);
+}
+
+// Cuts text after the newline nearest each chunk boundary, so no record is
+// split between two tasks.
+void add_text_chunks(std::string_view text,
+    summary_input const& input,
+    std::vector<parse_task>& tasks) {
+  while (!text.empty()) {
+    std::size_t size = std::min(text_chunk, text.size());
+    if (size < text.size()) {
+      auto const newline = text.find('\n', size);
+      size = newline == std::string_view::npos ? text.size() : newline + 1;
+    }
+    tasks.push_back({text.substr(0, size), input.content_type, &input.path});
+    text.remove_prefix(size);
+  }
+}
+
+}  // namespace
+
+std::optional<log_summary> summarize_logs(const std::vector<summary_input>& files,
+    unsigned threads) {
+  log_summary summary;
+  std::vector<std::string> contents;
+  contents.reserve(files.size());
+  std::vector<parse_task> tasks;
+  for (auto const& input : files) {
+    std::ifstream file(input.path, std::ios::binary);
+    if (!file) {
+      std::println(stderr, "[ERROR] Cannot open {}", input.path.string());
+      return std::nullopt;
+    }
+    auto const& text = contents.emplace_back(std::istreambuf_iterator<char>(file),
+        std::istreambuf_iterator<char>());
+    summary.bytes_parsed += text.size();
+    if (input.content_type == "text/plain") {
+      add_text_chunks(text, input, tasks);
+    } else {
+      tasks.push_back({text, input.content_type, &input.path});
+    }
+  }
+
+  // Workers take tasks in order and keep their own aggregate; the aggregates
+  // are merged once at the end.
+  std::atomic<std::size_t> next{0};
+  std::atomic<bool> failed{false};
+  std::mutex merge_mutex;
+  auto const work = [&] {
+    cluster::partial local;
+    for (std::size_t i = next++; i < tasks.size() && !failed; i = next++) {
+      auto const result = parse(tasks[i]);
+      if (result.error_message != "success") {
+        std::println(stderr,
+            "[ERROR] Parsing {}: {}",
+            tasks[i].path->string(),
+            result.error_message);
+        failed = true;
+        return;
+      }
+      local.merge(result.message_stats, result.total_fields, result.invalid_fields);
+    }
+    std::scoped_lock lock(merge_mutex);
+    summary.aggregate.merge(local);
+  };
+
+  auto const workers = std::clamp<std::size_t>(threads, 1, std::max<std::size_t>(tasks.size(), 1));
+  std::vector<std::thread> pool;
+  for (std::size_t i = 1; i < workers; ++i) pool.emplace_back(work);
+  work();
+  for (auto& thread : pool) thread.join();
+
+  if (failed) return std::nullopt;
+  return summary;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../cluster/aggregate.hpp"
+
+// Client-side pre-aggregation behind --summarize: the log files are parsed
+// here with the server's own parsers, and only the merged counts go over the
+// wire, in the cluster wire format.
+struct summary_input {
+  std::filesystem::path path;
+  std::string content_type;  // application/json, application/xml or text/plain
+};
+
+struct log_summary {
+  cluster::partial aggregate;
+  std::uint64_t bytes_parsed = 0;
+};
+
+// Parses the files on up to `threads` threads. Every file is a task, and text
+// files are also cut into chunks at line boundaries, so one large file still
+// keeps every thread busy. Returns nothing, after printing why, if a file
+// cannot be read or does not parse.
+std::optional<log_summary> summarize_logs(const std::vector<summary_input>& files,
+    unsigned threads);
@@ -0,0 +1,60 @@
+#include "upload.hpp"
+
+#include <system_error>
+
+multipart_upload::multipart_upload(std::string boundary, bool gzip)
+    : boundary_(std::move(boundary)), gzip_(gzip) {}
+
+bool multipart_upload::add_file(const std::string& field_name,
+    const std::filesystem::path& path,
+    const std::string& content_type) {
+  std::error_code ec;
+  std::uintmax_t const size = std::filesystem::file_size(path, ec);
+  if (ec || size == 0) return false;
+
+  part p;
+  p.path = path;
+  p.size = size;
+  p.preamble = "--" + boundary_ + "\r\n" + "Content-Disposition: form-data; name=\"" + field_name +
+               "\"; filename=\"" + path.filename().string() + "\"\r\n" +
+               "Content-Type: " + content_type + "\r\n\r\n";
+  parts_.push_back(std::move(p));
+  return true;
+}
+
+std::uint64_t multipart_upload::content_length() const {
+  std::uint64_t length = 0;
+  for (auto const& p : parts_) {
+    length += p.preamble.size() + p.size + 2;  // Trailing CRLF after the data
+  }
+  return length + boundary_.size() + 6;  // "--" boundary "--\r\n"
+}
+
+void multipart_upload::prepare(http::request<http::buffer_body>& req) const {
+  req.set(http::field::content_type, content_type());
+  if (gzip_) {
+    req.set(http::field::content_encoding, "gzip");
+    req.chunked(true);
+  } else {
+    req.content_length(content_length());
+  }
+}
+
+std::optional<file_upload> file_upload::open(const std::filesystem::path& path,
+    std::string content_type,
+    bool gzip) {
+  std::error_code ec;
+  std::uintmax_t const size = std::filesystem::file_size(path, ec);
+  if (ec) return std::nullopt;
+  return file_upload(path, std::move(content_type), gzip, size);
+}
+
+void file_upload::prepare(http::request<http::buffer_body>& req) const {
+  req.set(http::field::content_type, content_type_);
+  if (gzip_) {
+    req.set(http::field::content_encoding, "gzip");
+    req.chunked(true);
+  } else {
+    req.content_length(size_);
+  }
+}
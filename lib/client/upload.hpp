@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../codec/gzip.hpp"
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+
+namespace upload_detail {
+
+inline constexpr std::size_t chunk_size = 64 * 1024;
+
+// Writes the request header, then the body that produce(send) hands over
+// piece by piece. When gzipped, the pieces go through a deflater and each
+// full buffer of compressed output becomes one chunk; otherwise they are
+// written as they come. `send(data, size)` leaves `ec` set on failure.
+template <class SyncWriteStream, class Produce>
+void write_streamed(SyncWriteStream& stream,
+    http::request<http::buffer_body>& req,
+    bool gzip,
+    Produce&& produce,
+    beast::error_code& ec) {
+  req.body().data = nullptr;
+  req.body().more = true;
+  http::request_serializer<http::buffer_body> serializer{req};
+  http::write_header(stream, serializer, ec);
+  if (ec) return;
+
+  // Hands one buffer to the serializer. need_buffer only means it wants more.
+  auto emit = [&](const char* data, std::size_t size) {
+    req.body().data = const_cast<char*>(data);
+    req.body().size = size;
+    http::write(stream, serializer, ec);
+    if (ec == http::error::need_buffer) ec = {};
+  };
+
+  std::array<char, chunk_size> packed;
+  std::optional<codec::deflater> deflater;
+  if (gzip) deflater.emplace();
+  auto send = [&](const char* data, std::size_t size, bool finish = false) {
+    if (!deflater) return emit(data, size);
+    while (!ec) {
+      auto const result = deflater->step(data, size, packed.data(), packed.size(), finish);
+      data += result.consumed;
+      size -= result.consumed;
+      if (result.error) {
+        ec = beast::errc::make_error_code(beast::errc::io_error);
+        return;
+      }
+      if (result.produced > 0) emit(packed.data(), result.produced);
+      if (finish ? result.done : (size == 0 && result.produced < packed.size())) return;
+    }
+  };
+
+  produce(send);
+  if (ec) return;
+  if (deflater) send(nullptr, 0, true);
+  if (ec) return;
+
+  req.body().data = nullptr;
+  req.body().more = false;
+  http::write(stream, serializer, ec);
+}
+
+// Reads `size` bytes of `path` a chunk at a time into send(data, size).
+template <class Send>
+void send_file(const std::filesystem::path& path,
+    std::uint64_t size,
+    Send& send,
+    beast::error_code& ec) {
+  std::array<char, chunk_size> chunk;
+  std::ifstream file(path, std::ios::binary);
+  std::uint64_t remaining = size;
+  while (remaining > 0 && file) {
+    auto const wanted = std::min<std::uint64_t>(remaining, chunk.size());
+    file.read(chunk.data(), static_cast<std::streamsize>(wanted));
+    auto const count = static_cast<std::size_t>(file.gcount());
+    if (count == 0) break;
+    send(chunk.data(), count);
+    if (ec) return;
+    remaining -= count;
+  }
+  // The file shrank after Content-Length was computed; the body would be short.
+  if (remaining > 0) ec = beast::errc::make_error_code(beast::errc::io_error);
+}
+
+}  // namespace upload_detail
+
+// A multipart/form-data upload whose file parts are streamed from disk. The
+// body length is known up front, so requests carry a Content-Length and the
+// client holds one fixed-size buffer no matter how large the files are. A
+// gzipped upload is compressed on the fly and sent chunked instead.
+class multipart_upload {
+ public:
+  static constexpr std::size_t chunk_size = upload_detail::chunk_size;
+
+  explicit multipart_upload(std::string boundary, bool gzip = false);
+
+  // Adds a file as the next part. Returns false if it is missing or empty.
+  bool add_file(const std::string& field_name,
+      const std::filesystem::path& path,
+      const std::string& content_type);
+
+  std::uint64_t content_length() const;
+  std::string content_type() const { return "multipart/form-data; boundary=" + boundary_; }
+
+  // Sets Content-Type and Content-Length, or Content-Encoding and chunked
+  // transfer when gzipped, on a request before it is written.
+  void prepare(http::request<http::buffer_body>& req) const;
+
+  // Writes the request header followed by every part, streamed chunk by chunk.
+  template <class SyncWriteStream>
+  void write(SyncWriteStream& stream,
+      http::request<http::buffer_body>& req,
+      beast::error_code& ec) const;
+
+ private:
+  struct part {
+    std::filesystem::path path;
+    std::string preamble;  // Boundary line and part headers
+    std::uint64_t size = 0;
+  };
+
+  std::string boundary_;
+  bool gzip_ = false;
+  std::vector<part> parts_;
+};
+
+template <class SyncWriteStream>
+void multipart_upload::write(SyncWriteStream& stream,
+    http::request<http::buffer_body>& req,
+    beast::error_code& ec) const {
+  upload_detail::write_streamed(
+      stream,
+      req,
+      gzip_,
+      [&](auto& send) {
+        for (auto const& p : parts_) {
+          send(p.preamble.data(), p.preamble.size());
+          if (ec) return;
+          upload_detail::send_file(p.path, p.size, send, ec);
+          if (ec) return;
+          send("\r\n", 2);
+          if (ec) return;
+        }
+        std::string const closing = "--" + boundary_ + "--\r\n";
+        send(closing.data(), closing.size());
+      },
+      ec);
+}
+
+// One file sent as the whole request body, streamed from disk the same way
+// as the parts of a multipart_upload: with a Content-Length, or gzipped on
+// the fly and chunked.
+class file_upload {
+ public:
+  // Returns nothing if the file is missing.
+  static std::optional<file_upload> open(const std::filesystem::path& path,
+      std::string content_type,
+      bool gzip = false);
+
+  std::uint64_t size() const { return size_; }
+
+  // Sets Content-Type and Content-Length, or Content-Encoding and chunked
+  // transfer when gzipped, on a request before it is written.
+  void prepare(http::request<http::buffer_body>& req) const;
+
+  // Writes the request header followed by the file, streamed chunk by chunk.
+  template <class SyncWriteStream>
+  void write(SyncWriteStream& stream,
+      http::request<http::buffer_body>& req,
+      beast::error_code& ec) const {
+    upload_detail::write_streamed(
+        stream,
+        req,
+        gzip_,
+        [&](auto& send) { upload_detail::send_file(path_, size_, send, ec); },
+        ec);
+  }
+
+ private:
+  file_upload(std::filesystem::path path, std::string content_type, bool gzip, std::uint64_t size)
+      : path_(std::move(path)), content_type_(std::move(content_type)), gzip_(gzip), size_(size) {}
+
+  std::filesystem::path path_;
+  std::string content_type_;
+  bool gzip_ = false;
+  std::uint64_t size_ = 0;
+};
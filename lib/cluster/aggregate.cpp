@@ -0,0 +1,87 @@
+#include "aggregate.hpp"
+
+#include <limits>
+
+#include "wire.hpp"
+
+namespace cluster {
+
+namespace {
+
+std::int64_t& slot(string_map<std::int64_t>& counts, std::string_view message) {
+  auto it = counts.find(message);
+  if (it == counts.end()) it = counts.try_emplace(std::string(message), 0).first;
+  return it->second;
+}
+
+// Counts come from other nodes and uploads: a sum that would overflow sticks
+// at the limit instead of wrapping.
+void add_count(std::int64_t& into, std::int64_t count) {
+  using limits = std::numeric_limits<std::int64_t>;
+  if (count > 0 && into > limits::max() - count) {
+    into = limits::max();
+  } else if (count < 0 && into < limits::min() - count) {
+    into = limits::min();
+  } else {
+    into += count;
+  }
+}
+
+string_map<std::int64_t>& level_slot(partial& into, std::string_view level) {
+  auto it = into.levels.find(level);
+  if (it == into.levels.end()) it = into.levels.try_emplace(std::string(level)).first;
+  return it->second;
+}
+
+}  // namespace
+
+void partial::merge(boost::json::object const& stats, std::size_t total, std::size_t invalid) {
+  for (auto const& [level, messages] : stats) {
+    auto const* counts = messages.if_object();
+    if (!counts) continue;
+    auto& target = level_slot(*this, level);
+    for (auto const& [message, count] : *counts) {
+      if (count.is_int64()) add_count(slot(target, message), count.get_int64());
+    }
+  }
+  total_entries += total;
+  invalid_data += invalid;
+}
+
+void partial::merge(wire::view const& encoded) {
+  string_map<std::int64_t>* target = nullptr;
+  std::string_view current_level;
+  encoded.for_each([&](std::string_view level, std::string_view message, std::uint64_t count) {
+    // A level's entries are contiguous, so each level is looked up once.
+    if (!target || level != current_level) {
+      target = &level_slot(*this, level);
+      current_level = level;
+    }
+    // view::parse refuses counts above INT64_MAX.
+    add_count(slot(*target, message), static_cast<std::int64_t>(count));
+  });
+  total_entries += encoded.total_entries();
+  invalid_data += encoded.invalid_data();
+}
+
+void partial::merge(partial const& other) {
+  for (auto const& [level, counts] : other.levels) {
+    auto& target = level_slot(*this, level);
+    for (auto const& [message, count] : counts) add_count(slot(target, message), count);
+  }
+  total_entries += other.total_entries;
+  invalid_data += other.invalid_data;
+}
+
+boost::json::object partial::message_stats() const {
+  boost::json::object out;
+  out.reserve(levels.size());
+  for (auto const& [level, counts] : levels) {
+    auto& messages = out[level].emplace_object();
+    messages.reserve(counts.size());
+    for (auto const& [message, count] : counts) messages[message] = count;
+  }
+  return out;
+}
+
+}  // namespace cluster
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <boost/json.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Partial aggregates exchanged between nodes. Merging only adds counts, so
+// partials can be applied in any order and grouped in any way.
+namespace cluster {
+
+namespace wire {
+class view;
+}
+
+// Lets maps keyed by std::string be probed with a string_view, so merging
+// allocates only for keys not seen before.
+struct string_hash {
+  using is_transparent = void;
+  std::size_t operator()(std::string_view text) const {
+    return std::hash<std::string_view>{}(text);
+  }
+};
+
+template <class Value>
+using string_map = std::unordered_map<std::string, Value, string_hash, std::equal_to<>>;
+
+struct partial {
+  std::size_t total_entries = 0;
+  std::size_t invalid_data = 0;
+  string_map<string_map<std::int64_t>> levels;  // level -> message -> count
+
+  // Counts that are not integers are skipped.
+  void merge(boost::json::object const& stats, std::size_t total, std::size_t invalid);
+  void merge(wire::view const& encoded);
+  void merge(partial const& other);
+  bool empty() const { return total_entries == 0 && levels.empty(); }
+
+  // The `level -> message -> count` object of the analysis response.
+  boost::json::object message_stats() const;
+};
+
+}  // namespace cluster
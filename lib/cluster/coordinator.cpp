@@ -0,0 +1,74 @@
+#include "coordinator.hpp"
+
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "upstream.hpp"
+#include "wire.hpp"
+
+namespace cluster {
+
+namespace {
+
+std::atomic<bool> enabled{false};
+
+std::mutex view_mutex;
+partial global;
+// Highest sequence number applied per "node/epoch".
+std::unordered_map<std::string, std::uint64_t> last_applied;
+std::unordered_set<std::string> nodes;
+
+}  // namespace
+
+void enable_coordinator() {
+  enabled.store(true, std::memory_order_relaxed);
+}
+
+bool coordinator_enabled() {
+  return enabled.load(std::memory_order_relaxed);
+}
+
+push_result apply_push(std::string_view node,
+    std::string_view epoch,
+    std::string_view seq,
+    std::string_view body) {
+  std::uint64_t seq_number = 0;
+  auto const [end, ec] = std::from_chars(seq.data(), seq.data() + seq.size(), seq_number);
+  if (node.empty() || epoch.empty() || ec != std::errc{} || end != seq.data() + seq.size()) {
+    return push_result::invalid;
+  }
+  auto const encoded = wire::view::parse(body);
+  if (!encoded) return push_result::invalid;
+
+  std::string key(node);
+  key += '/';
+  key += epoch;
+  {
+    std::scoped_lock lock(view_mutex);
+    auto& last = last_applied[key];
+    if (seq_number <= last) return push_result::duplicate;
+    last = seq_number;
+    nodes.emplace(node);
+    global.merge(*encoded);
+  }
+  // A coordinator with an upstream of its own is an inner node of the tree.
+  record(*encoded);
+  return push_result::applied;
+}
+
+partial snapshot() {
+  std::scoped_lock lock(view_mutex);
+  return global;
+}
+
+std::size_t node_count() {
+  std::scoped_lock lock(view_mutex);
+  return nodes.size();
+}
+
+}  // namespace cluster
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+#include "aggregate.hpp"
+
+// Coordinator side of the aggregation tree: partials pushed by leaf servers
+// are merged into one global view as they arrive, so querying it costs the
+// same however many log lines went into it.
+namespace cluster {
+
+void enable_coordinator();
+bool coordinator_enabled();
+
+enum class push_result { applied, duplicate, invalid };
+
+// Merges a push from upstream_pusher: its Node-Id, Push-Epoch and Push-Seq
+// headers and its wire-format body. A batch at or below the sequence number
+// last applied for its node and epoch is a retry and is acknowledged without
+// being merged again. Applied pushes are also recorded for this node's own
+// upstream, if it has one.
+push_result apply_push(std::string_view node,
+    std::string_view epoch,
+    std::string_view seq,
+    std::string_view body);
+
+// Copy of the global view.
+partial snapshot();
+
+// Nodes that have pushed at least once.
+std::size_t node_count();
+
+}  // namespace cluster
@@ -0,0 +1,159 @@
+#include "live.hpp"
+
+#include <boost/asio/as_tuple.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../log/logger.hpp"
+#include "wire.hpp"
+
+namespace cluster {
+
+namespace {
+
+std::atomic<bool> enabled{false};
+std::mutex tick_mutex;
+partial current_tick;
+
+std::mutex frame_mutex;
+live_frame newest;
+std::vector<std::weak_ptr<asio::steady_timer>> subscribers;
+
+struct top_entry {
+  std::string_view level;
+  std::string_view message;
+  std::int64_t count;
+};
+
+}  // namespace
+
+void record_live(boost::json::object const& stats,
+    std::size_t total_entries,
+    std::size_t invalid_data) {
+  if (!enabled.load(std::memory_order_relaxed)) return;
+  std::scoped_lock lock(tick_mutex);
+  current_tick.merge(stats, total_entries, invalid_data);
+}
+
+void record_live(wire::view const& encoded) {
+  if (!enabled.load(std::memory_order_relaxed)) return;
+  std::scoped_lock lock(tick_mutex);
+  current_tick.merge(encoded);
+}
+
+void record_live(partial const& aggregate) {
+  if (!enabled.load(std::memory_order_relaxed)) return;
+  std::scoped_lock lock(tick_mutex);
+  current_tick.merge(aggregate);
+}
+
+bool live_enabled() {
+  return enabled.load(std::memory_order_relaxed);
+}
+
+live_frame latest_live_frame() {
+  std::scoped_lock lock(frame_mutex);
+  return newest;
+}
+
+void subscribe_live(std::shared_ptr<asio::steady_timer> const& wake) {
+  std::scoped_lock lock(frame_mutex);
+  subscribers.push_back(wake);
+}
+
+live_feed::live_feed(asio::io_context& ioc, std::chrono::milliseconds interval, std::size_t top)
+    : strand_(asio::make_strand(ioc)), timer_(strand_), interval_(interval), top_(top) {}
+
+live_feed::~live_feed() {
+  enabled.store(false, std::memory_order_relaxed);
+}
+
+void live_feed::start() {
+  enabled.store(true, std::memory_order_relaxed);
+  asio::co_spawn(strand_, run(), asio::detached);
+  LOG_INFO("Live feed on /live every {} ms", interval_.count());
+}
+
+asio::awaitable<void> live_feed::run() {
+  while (true) {
+    timer_.expires_after(interval_);
+    auto const [ec] = co_await timer_.async_wait(asio::as_tuple(asio::use_awaitable));
+    if (ec) co_return;
+    partial tick;
+    {
+      std::scoped_lock lock(tick_mutex);
+      tick = std::exchange(current_tick, {});
+    }
+    publish(tick);
+  }
+}
+
+void live_feed::publish(partial const& tick) {
+  auto const seconds = std::chrono::duration<double>(interval_).count();
+  total_entries_ += tick.total_entries;
+
+  string_map<std::int64_t> counts;  // Records per level in this tick
+  std::vector<top_entry> entries;
+  for (auto const& [level, messages] : tick.levels) {
+    auto& count = counts[level];
+    for (auto const& [message, n] : messages) {
+      count += n;
+      entries.push_back({level, message, n});
+    }
+    level_totals_[level] += count;
+  }
+  // Every level seen so far, so the dashboard's rows stay put when one goes
+  // quiet.
+  boost::json::object levels;
+  for (auto const& [level, total] : level_totals_) {
+    auto const it = counts.find(level);
+    std::int64_t const count = it == counts.end() ? 0 : it->second;
+    levels[level] = {{"count", count},
+        {"rate", static_cast<double>(count) / seconds},
+        {"total", total}};
+  }
+
+  auto const kept = std::min(top_, entries.size());
+  std::partial_sort(entries.begin(),
+      entries.begin() + static_cast<std::ptrdiff_t>(kept),
+      entries.end(),
+      [](top_entry const& a, top_entry const& b) {
+        return a.count != b.count ? a.count > b.count : a.message < b.message;
+      });
+  boost::json::array top;
+  for (std::size_t i = 0; i < kept; ++i) {
+    top.push_back({{"level", entries[i].level},
+        {"message", entries[i].message},
+        {"count", entries[i].count}});
+  }
+
+  boost::json::object frame;
+  frame["seq"] = ++seq_;
+  frame["interval_ms"] = interval_.count();
+  frame["entries"] = tick.total_entries;
+  frame["invalid_data"] = tick.invalid_data;
+  frame["rate"] = static_cast<double>(tick.total_entries) / seconds;
+  frame["total_entries"] = total_entries_;
+  frame["levels"] = std::move(levels);
+  frame["top"] = std::move(top);
+  auto json = std::make_shared<std::string const>(boost::json::serialize(frame));
+
+  std::scoped_lock lock(frame_mutex);
+  newest = {seq_, std::move(json)};
+  std::erase_if(subscribers, [](auto const& subscriber) { return subscriber.expired(); });
+  for (auto const& subscriber : subscribers) {
+    if (auto wake = subscriber.lock()) {
+      asio::post(wake->get_executor(), [wake] { wake->cancel(); });
+    }
+  }
+}
+
+}  // namespace cluster
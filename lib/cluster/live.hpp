@@ -0,0 +1,74 @@
+#pragma once
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/json.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "aggregate.hpp"
+
+namespace asio = boost::asio;
+
+namespace cluster {
+
+namespace wire {
+class view;
+}
+
+// Adds an analysis to the current tick of the live feed. Called by record();
+// does nothing unless a live_feed is running.
+void record_live(boost::json::object const& stats,
+    std::size_t total_entries,
+    std::size_t invalid_data);
+void record_live(wire::view const& encoded);
+void record_live(partial const& aggregate);
+
+bool live_enabled();
+
+struct live_frame {
+  std::uint64_t seq = 0;  // 0 until the first tick
+  std::shared_ptr<std::string const> json;
+};
+
+// The newest frame, shared by every subscriber.
+live_frame latest_live_frame();
+
+// `wake` is cancelled, on its own executor, after every new frame. The feed
+// holds it weakly, so a subscriber leaves by dropping it.
+void subscribe_live(std::shared_ptr<asio::steady_timer> const& wake);
+
+// Live statistics for the dashboard (GET /live, a WebSocket). Every
+// `interval`, what was recorded since the last tick becomes one JSON frame:
+// per-level counts, rates and running totals, and the `top` messages with
+// the most records in the tick. The frame is serialized once, then
+// subscribers are woken to send it as it is.
+class live_feed {
+ public:
+  live_feed(asio::io_context& ioc, std::chrono::milliseconds interval, std::size_t top);
+  ~live_feed();
+  live_feed(const live_feed&) = delete;
+  live_feed& operator=(const live_feed&) = delete;
+
+  void start();
+
+ private:
+  asio::awaitable<void> run();
+  void publish(partial const& tick);
+
+  asio::strand<asio::io_context::executor_type> strand_;
+  asio::steady_timer timer_;
+  std::chrono::milliseconds interval_;
+  std::size_t top_;
+  std::uint64_t seq_ = 0;
+  // Records per level since the server started.
+  string_map<std::int64_t> level_totals_;
+  std::uint64_t total_entries_ = 0;
+};
+
+}  // namespace cluster
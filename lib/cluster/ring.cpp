@@ -0,0 +1,130 @@
+#include "ring.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+
+#include "../log/logger.hpp"
+
+namespace cluster {
+
+namespace {
+
+// FNV-1a spreads short, similar keys poorly on its own; the finalizer of
+// splitmix64 mixes every input bit into every output bit.
+std::uint64_t mix(std::uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+}  // namespace
+
+std::uint64_t ring_hash(std::string_view key) {
+  std::uint64_t hash = 0xcbf29ce484222325ULL;
+  for (char const c : key) {
+    hash ^= static_cast<std::uint8_t>(c);
+    hash *= 0x100000001b3ULL;
+  }
+  return mix(hash);
+}
+
+hash_ring::hash_ring(std::vector<ring_node> nodes) : nodes_(std::move(nodes)) {
+  for (std::uint32_t index = 0; index < nodes_.size(); ++index) {
+    auto const points = nodes_[index].weight * points_per_weight;
+    for (unsigned i = 0; i < points; ++i) {
+      points_.emplace_back(ring_hash(std::format("{}#{}", nodes_[index].id, i)), index);
+    }
+  }
+  std::ranges::sort(points_);
+}
+
+ring_node const* hash_ring::owner_of_hash(std::uint64_t hash) const {
+  if (points_.empty()) return nullptr;
+  auto it = std::lower_bound(points_.begin(), points_.end(), std::pair{hash, std::uint32_t{0}});
+  if (it == points_.end()) it = points_.begin();  // Wrap around
+  return &nodes_[it->second];
+}
+
+ring_node const* hash_ring::owner(std::string_view key) const {
+  return owner_of_hash(ring_hash(key));
+}
+
+ring_node const* hash_ring::find(std::string_view id) const {
+  auto const it = std::ranges::find(nodes_, id, &ring_node::id);
+  return it == nodes_.end() ? nullptr : &*it;
+}
+
+double hash_ring::moved_fraction(hash_ring const& before, hash_ring const& after) {
+  if (before.points_.empty() || after.points_.empty()) return 1;
+  // Between consecutive points of either ring, both owners are constant: the
+  // arc (previous, point] belongs to the owners of `point`.
+  std::vector<std::uint64_t> bounds;
+  bounds.reserve(before.points_.size() + after.points_.size());
+  for (auto const& [hash, index] : before.points_) bounds.push_back(hash);
+  for (auto const& [hash, index] : after.points_) bounds.push_back(hash);
+  std::ranges::sort(bounds);
+
+  long double moved = 0;
+  std::uint64_t previous = bounds.back();  // The first arc wraps around zero
+  for (auto const bound : bounds) {
+    auto const length = bound - previous;  // Modulo 2^64
+    previous = bound;
+    if (before.owner_of_hash(bound)->id != after.owner_of_hash(bound)->id) {
+      moved += static_cast<long double>(length);
+    }
+  }
+  return static_cast<double>(moved / 18446744073709551616.0L);
+}
+
+std::optional<std::vector<ring_node>> load_ring(std::filesystem::path const& path) {
+  std::ifstream file(path);
+  if (!file) {
+    LOG_ERROR("Cannot open ring file {}", path.string());
+    return std::nullopt;
+  }
+
+  std::vector<ring_node> nodes;
+  std::unordered_set<std::string> ids;
+  std::string line;
+  for (std::size_t number = 1; std::getline(file, line); ++number) {
+    if (auto const hash = line.find('#'); hash != std::string::npos) line.erase(hash);
+    std::istringstream fields(line);
+    std::string id, address, weight;
+    if (!(fields >> id)) continue;
+
+    ring_node node;
+    node.id = id;
+    fields >> address >> weight;
+    auto const colon = address.rfind(':');
+    bool valid = colon != std::string::npos && colon > 0 && colon + 1 < address.size();
+    if (valid && !weight.empty()) {
+      auto const [end, ec] =
+          std::from_chars(weight.data(), weight.data() + weight.size(), node.weight);
+      valid = ec == std::errc{} && end == weight.data() + weight.size() && node.weight > 0 &&
+              node.weight <= 100;
+    }
+    std::string extra;
+    if (!valid || fields >> extra) {
+      LOG_ERROR("{}:{}: expected `id host:port [weight]`, weight 1 to 100", path.string(), number);
+      return std::nullopt;
+    }
+    if (!ids.insert(id).second) {
+      LOG_ERROR("{}:{}: node {} is listed twice", path.string(), number, id);
+      return std::nullopt;
+    }
+    node.host = address.substr(0, colon);
+    node.port = address.substr(colon + 1);
+    nodes.push_back(std::move(node));
+  }
+  if (nodes.empty()) {
+    LOG_ERROR("Ring file {} lists no nodes", path.string());
+    return std::nullopt;
+  }
+  return nodes;
+}
+
+}  // namespace cluster
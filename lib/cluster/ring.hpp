@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace cluster {
+
+struct ring_node {
+  std::string id;
+  std::string host;
+  std::string port;
+  unsigned weight = 1;
+};
+
+// Consistent hashing with virtual nodes: every node owns `weight *
+// points_per_weight` points on a 64-bit ring, and a key belongs to the node
+// of the first point at or after its hash. Adding or removing a node only
+// moves the keys between its points and their predecessors, about 1/n of
+// them, spread evenly over the remaining nodes.
+class hash_ring {
+ public:
+  static constexpr unsigned points_per_weight = 256;
+
+  explicit hash_ring(std::vector<ring_node> nodes);
+
+  // Nothing if the ring is empty.
+  ring_node const* owner(std::string_view key) const;
+  ring_node const* find(std::string_view id) const;
+  std::vector<ring_node> const& nodes() const { return nodes_; }
+
+  // Fraction of the key space whose owner differs between the two rings.
+  static double moved_fraction(hash_ring const& before, hash_ring const& after);
+
+ private:
+  ring_node const* owner_of_hash(std::uint64_t hash) const;
+
+  std::vector<ring_node> nodes_;
+  std::vector<std::pair<std::uint64_t, std::uint32_t>> points_;  // Hash, node index; sorted
+};
+
+std::uint64_t ring_hash(std::string_view key);
+
+// Reads a ring file: one node per line as `id host:port [weight]`, with `#`
+// comments and blank lines ignored. Ids must be unique. Problems are logged
+// and give nothing, so a reload can keep the ring it has.
+std::optional<std::vector<ring_node>> load_ring(std::filesystem::path const& path);
+
+}  // namespace cluster
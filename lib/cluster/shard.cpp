@@ -0,0 +1,86 @@
+#include "shard.hpp"
+
+#include <memory>
+#include <mutex>
+
+#include "../log/logger.hpp"
+
+namespace cluster {
+
+namespace {
+
+std::mutex ring_mutex;
+std::shared_ptr<hash_ring const> current_ring;
+shard_mode mode = shard_mode::forward;
+std::string self_id;
+
+std::shared_ptr<hash_ring const> ring() {
+  std::scoped_lock lock(ring_mutex);
+  return current_ring;
+}
+
+}  // namespace
+
+std::optional<shard_mode> parse_shard_mode(std::string_view text) {
+  if (text == "forward") return shard_mode::forward;
+  if (text == "redirect") return shard_mode::redirect;
+  return std::nullopt;
+}
+
+bool sharding_enabled() {
+  return ring() != nullptr;
+}
+
+shard_mode sharding_mode() {
+  return mode;
+}
+
+std::string const& self_node_id() {
+  return self_id;
+}
+
+std::optional<ring_node> foreign_owner(std::string_view client_id) {
+  auto const snapshot = ring();
+  if (!snapshot) return std::nullopt;
+  auto const* owner = snapshot->owner(client_id);
+  if (!owner || owner->id == self_id) return std::nullopt;
+  return *owner;
+}
+
+ring_watcher::ring_watcher(asio::io_context& ioc,
+    std::filesystem::path path,
+    std::string self,
+    shard_mode routing)
+    : watcher_(ioc, std::move(path), "ring", [this](auto const& file) { return reload(file); }) {
+  // Set before the first ring is published, read-only afterwards.
+  self_id = std::move(self);
+  mode = routing;
+}
+
+bool ring_watcher::reload(std::filesystem::path const& path) {
+  auto nodes = load_ring(path);
+  if (!nodes) return false;
+
+  auto next = std::make_shared<hash_ring const>(std::move(*nodes));
+  if (!next->find(self_id)) {
+    LOG_WARN("Node {} is not in ring {}: every upload will be sent to another node",
+        self_id,
+        path.string());
+  }
+  std::shared_ptr<hash_ring const> previous;
+  {
+    std::scoped_lock lock(ring_mutex);
+    previous = std::exchange(current_ring, next);
+  }
+  if (previous) {
+    LOG_INFO("Reloaded ring {}: {} nodes, {:.1f}% of clients change owner",
+        path.string(),
+        next->nodes().size(),
+        hash_ring::moved_fraction(*previous, *next) * 100);
+  } else {
+    LOG_INFO("Sharding by Client-Id over {} nodes from {}", next->nodes().size(), path.string());
+  }
+  return true;
+}
+
+}  // namespace cluster
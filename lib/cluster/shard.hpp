@@ -0,0 +1,56 @@
+#pragma once
+
+#include <boost/asio/io_context.hpp>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "../file/watcher.hpp"
+#include "ring.hpp"
+
+namespace asio = boost::asio;
+
+// Sharding of uploads by Client-Id across the nodes of a ring. A node that
+// does not own a client either forwards its uploads to the owner or
+// redirects the client there.
+namespace cluster {
+
+enum class shard_mode { forward, redirect };
+
+std::optional<shard_mode> parse_shard_mode(std::string_view text);
+
+// Set on forwarded requests, naming the node that forwarded them. A request
+// carrying it is handled where it lands, so a ring being reloaded on
+// different nodes at different moments cannot bounce it around.
+inline constexpr std::string_view forwarded_by_header = "Shard-Forwarded-By";
+
+bool sharding_enabled();
+shard_mode sharding_mode();
+std::string const& self_node_id();
+
+// The node that owns `client_id`, or nothing if sharding is off or this node
+// owns it.
+std::optional<ring_node> foreign_owner(std::string_view client_id);
+
+// Loads the ring file and re-reads it whenever its modification time changes.
+// A file that fails to parse keeps the previous ring in place.
+class ring_watcher {
+ public:
+  ring_watcher(asio::io_context& ioc,
+      std::filesystem::path path,
+      std::string self_id,
+      shard_mode routing);
+  ring_watcher(const ring_watcher&) = delete;
+  ring_watcher& operator=(const ring_watcher&) = delete;
+
+  // Returns false if the file cannot be loaded.
+  bool start() { return watcher_.start(); }
+
+ private:
+  bool reload(std::filesystem::path const& path);
+
+  file_watcher watcher_;
+};
+
+}  // namespace cluster
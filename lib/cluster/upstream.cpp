@@ -0,0 +1,213 @@
+#include "upstream.hpp"
+
+#include <boost/asio/as_tuple.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/version.hpp>
+#include <algorithm>
+#include <atomic>
+#include <format>
+#include <mutex>
+#include <print>
+#include <random>
+#include <tuple>
+#include <utility>
+
+#include "../codec/gzip.hpp"
+#include "../log/logger.hpp"
+#include "aggregate.hpp"
+#include "live.hpp"
+#include "wire.hpp"
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = asio::ip::tcp;
+
+namespace cluster {
+
+namespace {
+
+constexpr auto push_timeout = std::chrono::seconds(10);
+constexpr auto max_backoff = std::chrono::milliseconds(60'000);
+// Smaller pushes are sent as they are.
+constexpr std::size_t min_gzip_push = 1024;
+
+std::atomic<bool> recording{false};
+std::mutex pending_mutex;
+partial pending;
+
+// The running pusher, for push_now().
+std::mutex pusher_mutex;
+upstream_pusher* active = nullptr;
+
+}  // namespace
+
+void record(boost::json::object const& stats,
+    std::size_t total_entries,
+    std::size_t invalid_data) {
+  record_live(stats, total_entries, invalid_data);
+  if (!recording.load(std::memory_order_relaxed)) return;
+  std::scoped_lock lock(pending_mutex);
+  pending.merge(stats, total_entries, invalid_data);
+}
+
+void record(wire::view const& encoded) {
+  record_live(encoded);
+  if (!recording.load(std::memory_order_relaxed)) return;
+  std::scoped_lock lock(pending_mutex);
+  pending.merge(encoded);
+}
+
+void record(partial const& aggregate) {
+  record_live(aggregate);
+  if (!recording.load(std::memory_order_relaxed)) return;
+  std::scoped_lock lock(pending_mutex);
+  pending.merge(aggregate);
+}
+
+bool push_now() {
+  std::scoped_lock lock(pusher_mutex);
+  if (!active) return false;
+  active->wake();
+  return true;
+}
+
+upstream_pusher::upstream_pusher(asio::io_context& ioc,
+    std::string upstream,
+    std::string node_id,
+    std::chrono::milliseconds interval)
+    : strand_(asio::make_strand(ioc)),
+      timer_(strand_),
+      upstream_(std::move(upstream)),
+      node_id_(std::move(node_id)),
+      epoch_(std::format("{:016x}", std::mt19937_64{std::random_device{}()}())),
+      interval_(interval) {}
+
+upstream_pusher::~upstream_pusher() {
+  recording.store(false, std::memory_order_relaxed);
+  std::scoped_lock lock(pusher_mutex);
+  if (active == this) active = nullptr;
+}
+
+bool upstream_pusher::start() {
+  auto const colon = upstream_.rfind(':');
+  if (colon == std::string::npos || colon == 0 || colon + 1 == upstream_.size()) {
+    std::println(stderr, "[ERROR] Upstream must be host:port, got '{}'", upstream_);
+    return false;
+  }
+  host_ = upstream_.substr(0, colon);
+  port_ = upstream_.substr(colon + 1);
+
+  {
+    std::scoped_lock lock(pusher_mutex);
+    active = this;
+  }
+  recording.store(true, std::memory_order_relaxed);
+  asio::co_spawn(strand_, run(), asio::detached);
+  LOG_INFO("Pushing partial aggregates to {} as node {} every {} ms",
+      upstream_,
+      node_id_,
+      interval_.count());
+  return true;
+}
+
+void upstream_pusher::wake() {
+  asio::post(strand_, [this] { timer_.cancel(); });
+}
+
+std::optional<upstream_pusher::batch> upstream_pusher::cut_batch() {
+  partial taken;
+  {
+    std::scoped_lock lock(pending_mutex);
+    if (pending.empty()) return std::nullopt;
+    taken = std::exchange(pending, {});
+  }
+
+  batch b{next_seq_++, wire::encode(taken)};
+  if (b.body.size() >= min_gzip_push) {
+    if (auto compressed = codec::gzip(b.body, 6)) {
+      b.body = std::move(*compressed);
+      b.gzipped = true;
+    }
+  }
+  return b;
+}
+
+asio::awaitable<void> upstream_pusher::run() {
+  // Kept until acknowledged; what is recorded meanwhile goes in the next one.
+  std::optional<batch> in_flight;
+  auto wait = interval_;
+  while (true) {
+    timer_.expires_after(wait);
+    // Cancelled by wake(): push straight away.
+    auto const [ec] = co_await timer_.async_wait(asio::as_tuple(asio::use_awaitable));
+    if (ec && ec != asio::error::operation_aborted) co_return;
+
+    if (!in_flight) in_flight = cut_batch();
+    if (!in_flight) {
+      wait = interval_;
+      continue;
+    }
+    if (co_await send(*in_flight)) {
+      in_flight.reset();
+      wait = interval_;
+    } else {
+      wait = std::min(std::max(wait, interval_) * 2, max_backoff);
+    }
+  }
+}
+
+asio::awaitable<bool> upstream_pusher::send(batch const& b) {
+  auto const token = asio::as_tuple(asio::use_awaitable);
+  beast::error_code ec;
+
+  tcp::resolver resolver(strand_);
+  auto [resolve_ec, endpoints] = co_await resolver.async_resolve(host_, port_, token);
+  if (resolve_ec) {
+    LOG_WARN("Resolving upstream {}: {}", upstream_, resolve_ec.message());
+    co_return false;
+  }
+
+  beast::tcp_stream stream(strand_);
+  stream.expires_after(push_timeout);
+  std::tie(ec, std::ignore) = co_await stream.async_connect(endpoints, token);
+  if (ec) {
+    LOG_WARN("Connecting to upstream {}: {}", upstream_, ec.message());
+    co_return false;
+  }
+
+  http::request<http::string_body> req{http::verb::post, "/cluster/push", 11};
+  req.set(http::field::host, upstream_);
+  req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
+  req.set(http::field::content_type, wire::content_type);
+  req.set("Node-Id", node_id_);
+  req.set("Push-Epoch", epoch_);
+  req.set("Push-Seq", std::to_string(b.seq));
+  if (b.gzipped) req.set(http::field::content_encoding, "gzip");
+  req.body() = b.body;
+  req.prepare_payload();
+  std::tie(ec, std::ignore) = co_await http::async_write(stream, req, token);
+
+  beast::flat_buffer buffer;
+  http::response<http::string_body> res;
+  if (!ec) std::tie(ec, std::ignore) = co_await http::async_read(stream, buffer, res, token);
+  if (ec) {
+    LOG_WARN("Pushing to upstream {}: {}", upstream_, ec.message());
+    co_return false;
+  }
+  beast::error_code ignored;
+  stream.socket().shutdown(tcp::socket::shutdown_both, ignored);
+
+  if (res.result() != http::status::ok) {
+    LOG_WARN("Upstream {} refused a push: {} {}", upstream_, res.result_int(), res.body());
+    co_return false;
+  }
+  co_return true;
+}
+
+}  // namespace cluster
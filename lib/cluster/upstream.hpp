@@ -0,0 +1,75 @@
+#pragma once
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/json.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace asio = boost::asio;
+
+namespace cluster {
+
+struct partial;
+
+namespace wire {
+class view;
+}
+
+// Folds one analysis into what the next push carries, if an upstream_pusher
+// is running, and into the live feed's current tick.
+void record(boost::json::object const& stats, std::size_t total_entries, std::size_t invalid_data);
+void record(wire::view const& encoded);
+void record(partial const& aggregate);
+
+// Has the running pusher push now rather than at its next tick. Returns false
+// if there is none.
+bool push_now();
+
+// Leaf side of the aggregation tree. Every `interval`, what was recorded since
+// the last push is cut into a numbered batch and posted to the coordinator at
+// `upstream` in the wire format. A batch is retried with backoff until it is
+// acknowledged; the node id, process epoch and sequence number, sent as
+// headers, let the coordinator drop repeats.
+class upstream_pusher {
+ public:
+  upstream_pusher(asio::io_context& ioc,
+      std::string upstream,
+      std::string node_id,
+      std::chrono::milliseconds interval);
+  ~upstream_pusher();
+  upstream_pusher(const upstream_pusher&) = delete;
+  upstream_pusher& operator=(const upstream_pusher&) = delete;
+
+  // Returns false if `upstream` is not host:port.
+  bool start();
+  void wake();
+
+ private:
+  struct batch {
+    std::uint64_t seq = 0;
+    std::string body;
+    bool gzipped = false;
+  };
+
+  asio::awaitable<void> run();
+  asio::awaitable<bool> send(batch const& b);
+  std::optional<batch> cut_batch();
+
+  asio::strand<asio::io_context::executor_type> strand_;
+  asio::steady_timer timer_;
+  std::string upstream_;
+  std::string host_;
+  std::string port_;
+  std::string node_id_;
+  std::string epoch_;
+  std::chrono::milliseconds interval_;
+  std::uint64_t next_seq_ = 1;
+};
+
+}  // namespace cluster
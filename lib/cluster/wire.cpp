@@ -0,0 +1,207 @@
+#include "wire.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+namespace cluster::wire {
+
+namespace {
+
+constexpr std::string_view magic = "LAG";
+constexpr std::uint8_t has_sketches = 0x01;
+constexpr std::size_t max_varint_bytes = 10;
+// Counts are merged into std::int64_t, so larger ones are refused.
+constexpr std::uint64_t max_count = std::numeric_limits<std::int64_t>::max();
+
+void put_varint(std::uint64_t value, std::string& out) {
+  while (value >= 0x80) {
+    out += static_cast<char>((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  out += static_cast<char>(value);
+}
+
+std::uint64_t level_code(std::string_view level) {
+  auto const it = std::ranges::find(known_levels, level);
+  return it == known_levels.end() ? 0 : static_cast<std::uint64_t>(it - known_levels.begin()) + 1;
+}
+
+// Writes `levels` (level -> message -> count, any map types) in the wire
+// layout. The level section is written first, to learn the string table that
+// goes before it.
+template <class Levels>
+std::string encode_levels(std::uint64_t total_entries,
+    std::uint64_t invalid_data,
+    Levels const& levels,
+    std::span<sketch const> sketches) {
+  std::unordered_map<std::string_view, std::uint64_t> index;
+  std::vector<std::string_view> strings;
+  auto const intern = [&](std::string_view text) {
+    auto const [it, added] = index.try_emplace(text, strings.size());
+    if (added) strings.push_back(text);
+    return it->second;
+  };
+
+  std::string body;
+  std::uint64_t level_count = 0;
+  for (auto const& [level, counts] : levels) {
+    auto const kept = std::ranges::count_if(counts, [](auto const& e) { return e.second > 0; });
+    if (kept == 0) continue;
+    ++level_count;
+    auto const code = level_code(level);
+    put_varint(code, body);
+    if (code == 0) put_varint(intern(level), body);
+    put_varint(static_cast<std::uint64_t>(kept), body);
+    for (auto const& [message, count] : counts) {
+      if (count <= 0) continue;
+      put_varint(intern(message), body);
+      put_varint(static_cast<std::uint64_t>(count), body);
+    }
+  }
+
+  std::size_t table_bytes = 0;
+  for (auto const text : strings) table_bytes += text.size() + 2;
+  std::string out;
+  out.reserve(32 + table_bytes + body.size());
+  out += magic;
+  out += static_cast<char>(version);
+  out += static_cast<char>(sketches.empty() ? 0 : has_sketches);
+  put_varint(total_entries, out);
+  put_varint(invalid_data, out);
+  put_varint(strings.size(), out);
+  for (auto const text : strings) {
+    put_varint(text.size(), out);
+    out += text;
+  }
+  put_varint(level_count, out);
+  out += body;
+  if (!sketches.empty()) {
+    put_varint(sketches.size(), out);
+    for (auto const& s : sketches) {
+      put_varint(s.kind, out);
+      put_varint(s.payload.size(), out);
+      out += s.payload;
+    }
+  }
+  return out;
+}
+
+// Bounds-checked reading for view::parse.
+class reader {
+ public:
+  explicit reader(std::string_view data) : data_(data) {}
+
+  std::size_t position() const { return position_; }
+  std::size_t remaining() const { return data_.size() - position_; }
+
+  bool varint(std::uint64_t& value) {
+    value = 0;
+    for (std::size_t i = 0; i < max_varint_bytes && position_ < data_.size(); ++i) {
+      auto const byte = static_cast<std::uint8_t>(data_[position_++]);
+      value |= std::uint64_t{byte & 0x7fu} << (7 * i);
+      if (byte < 0x80) return true;
+    }
+    return false;
+  }
+
+  bool bytes(std::uint64_t length, std::string_view& out) {
+    if (length > remaining()) return false;
+    out = data_.substr(position_, length);
+    position_ += length;
+    return true;
+  }
+
+  // A length that cannot be right, since every element takes at least
+  // `min_bytes` of what is left.
+  bool plausible(std::uint64_t count, std::size_t min_bytes) const {
+    return count <= remaining() / min_bytes;
+  }
+
+ private:
+  std::string_view data_;
+  std::size_t position_ = 0;
+};
+
+}  // namespace
+
+std::string encode(partial const& aggregate, std::span<sketch const> sketches) {
+  return encode_levels(aggregate.total_entries, aggregate.invalid_data, aggregate.levels, sketches);
+}
+
+std::optional<view> view::parse(std::string_view data) {
+  if (data.size() < magic.size() + 2 || !data.starts_with(magic)) return std::nullopt;
+  if (static_cast<std::uint8_t>(data[magic.size()]) != version) return std::nullopt;
+  auto const flags = static_cast<std::uint8_t>(data[magic.size() + 1]);
+  if (flags & ~has_sketches) return std::nullopt;
+
+  view v;
+  v.data_ = data;
+  reader in(data.substr(magic.size() + 2));
+  auto const offset = [&] { return magic.size() + 2 + in.position(); };
+
+  std::uint64_t count = 0;
+  if (!in.varint(v.total_entries_) || !in.varint(v.invalid_data_)) return std::nullopt;
+  if (!in.varint(count) || !in.plausible(count, 1)) return std::nullopt;
+  v.strings_.resize(count);
+  for (auto& text : v.strings_) {
+    std::uint64_t length = 0;
+    if (!in.varint(length) || !in.bytes(length, text)) return std::nullopt;
+  }
+
+  v.levels_offset_ = offset();
+  std::uint64_t level_count = 0;
+  if (!in.varint(level_count) || !in.plausible(level_count, 2)) return std::nullopt;
+  for (std::uint64_t i = 0; i < level_count; ++i) {
+    std::uint64_t code = 0, index = 0;
+    if (!in.varint(code) || code > known_levels.size()) return std::nullopt;
+    if (code == 0 && (!in.varint(index) || index >= v.strings_.size())) return std::nullopt;
+    if (!in.varint(count) || !in.plausible(count, 2)) return std::nullopt;
+    for (std::uint64_t j = 0; j < count; ++j) {
+      std::uint64_t message = 0, value = 0;
+      if (!in.varint(message) || message >= v.strings_.size() || !in.varint(value) ||
+          value > max_count) {
+        return std::nullopt;
+      }
+    }
+  }
+
+  if (flags & has_sketches) {
+    v.sketches_offset_ = offset();
+    if (!in.varint(count) || !in.plausible(count, 2)) return std::nullopt;
+    for (std::uint64_t i = 0; i < count; ++i) {
+      std::uint64_t kind = 0, length = 0;
+      std::string_view payload;
+      if (!in.varint(kind) || !in.varint(length) || !in.bytes(length, payload)) {
+        return std::nullopt;
+      }
+    }
+  }
+  if (in.remaining() != 0) return std::nullopt;
+  return v;
+}
+
+std::string merge(std::span<view const> parts) {
+  // Keys point into the parts' buffers: nothing is copied until the output.
+  std::unordered_map<std::string_view, std::unordered_map<std::string_view, std::uint64_t>> levels;
+  std::uint64_t total_entries = 0, invalid_data = 0;
+  std::vector<sketch> sketches;
+  for (auto const& part : parts) {
+    std::unordered_map<std::string_view, std::uint64_t>* counts = nullptr;
+    std::string_view current_level;
+    part.for_each([&](std::string_view level, std::string_view message, std::uint64_t count) {
+      if (!counts || level != current_level) {
+        counts = &levels[level];
+        current_level = level;
+      }
+      auto& sum = (*counts)[message];
+      sum = std::min(sum + count, max_count);  // Both at most max_count: no wrap
+    });
+    total_entries += part.total_entries();
+    invalid_data += part.invalid_data();
+    part.for_each_sketch([&](sketch const& s) { sketches.push_back(s); });
+  }
+  return encode_levels(total_entries, invalid_data, levels, sketches);
+}
+
+}  // namespace cluster::wire
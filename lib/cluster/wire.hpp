@@ -0,0 +1,120 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "aggregate.hpp"
+
+// Binary form of a partial aggregate, for exchange between nodes.
+//
+//   "LAG" version:u8 flags:u8
+//   total_entries:varint invalid_data:varint
+//   string_count:varint (length:varint bytes)*        string table
+//   level_count:varint (level entry_count:varint (message:varint count:varint)*)*
+//   [sketch_count:varint (kind:varint length:varint bytes)*]   when flags & 1
+//
+// Varints are unsigned LEB128. A level is the code of a well-known level, or 0
+// followed by an index into the string table; messages are string table
+// indices, so text repeated across levels is sent once.
+namespace cluster::wire {
+
+constexpr std::uint8_t version = 1;
+constexpr std::string_view content_type = "application/vnd.log-aggregate";
+
+// Level codes 1..n, in this order. Never reordered: only appended to in a
+// new version.
+inline constexpr std::array<std::string_view, 8> known_levels{
+    "TRACE", "DEBUG", "INFO", "WARN", "WARNING", "ERROR", "CRITICAL", "FATAL"};
+
+// An opaque mergeable summary carried next to the counts, such as a
+// cardinality sketch. Merging keeps every payload; combining payloads of the
+// same kind is up to whoever understands it.
+struct sketch {
+  std::uint64_t kind = 0;
+  std::string_view payload;
+};
+
+namespace detail {
+
+// Only used on data view::parse has already checked.
+inline std::uint64_t read_varint(std::string_view data, std::size_t& position) {
+  std::uint64_t value = 0;
+  for (int shift = 0;; shift += 7) {
+    auto const byte = static_cast<std::uint8_t>(data[position++]);
+    value |= std::uint64_t{byte & 0x7fu} << shift;
+    if (byte < 0x80) return value;
+  }
+}
+
+}  // namespace detail
+
+// Counts of zero or less are left out.
+std::string encode(partial const& aggregate, std::span<sketch const> sketches = {});
+
+// A checked encoded partial, read in place: strings are views into the
+// buffer given to parse(), which must outlive the view.
+class view {
+ public:
+  // Returns nothing if the data is truncated, malformed or of a later version,
+  // or holds a count above INT64_MAX.
+  static std::optional<view> parse(std::string_view data);
+
+  std::uint64_t total_entries() const { return total_entries_; }
+  std::uint64_t invalid_data() const { return invalid_data_; }
+  std::string_view data() const { return data_; }
+
+  // Calls fn(level, message, count) for every entry, a level's entries together.
+  template <class Fn>
+  void for_each(Fn&& fn) const {
+    std::size_t position = levels_offset_;
+    auto level_count = detail::read_varint(data_, position);
+    while (level_count-- > 0) {
+      auto const code = detail::read_varint(data_, position);
+      auto const level = code == 0 ? strings_[detail::read_varint(data_, position)]
+                                   : known_levels[code - 1];
+      auto entry_count = detail::read_varint(data_, position);
+      while (entry_count-- > 0) {
+        auto const message = strings_[detail::read_varint(data_, position)];
+        fn(level, message, detail::read_varint(data_, position));
+      }
+    }
+  }
+
+  // Calls fn(sketch) for every sketch payload.
+  template <class Fn>
+  void for_each_sketch(Fn&& fn) const {
+    if (sketches_offset_ == 0) return;
+    std::size_t position = sketches_offset_;
+    auto count = detail::read_varint(data_, position);
+    while (count-- > 0) {
+      sketch s;
+      s.kind = detail::read_varint(data_, position);
+      auto const length = detail::read_varint(data_, position);
+      s.payload = data_.substr(position, length);
+      position += length;
+      fn(s);
+    }
+  }
+
+ private:
+  view() = default;
+
+  std::string_view data_;
+  std::vector<std::string_view> strings_;
+  std::uint64_t total_entries_ = 0;
+  std::uint64_t invalid_data_ = 0;
+  std::size_t levels_offset_ = 0;
+  std::size_t sketches_offset_ = 0;  // 0 when there are none
+};
+
+// Adds the parts together without decoding them into a partial first; the
+// result is encoded again. Sketches are carried over unchanged.
+std::string merge(std::span<view const> parts);
+
+}  // namespace cluster::wire
@@ -0,0 +1,362 @@
+#include "analysis.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <limits>
+
+#include "header_values.hpp"
+
+namespace codec {
+
+namespace {
+
+constexpr std::size_t serialize_chunk = 64 * 1024;
+// Deeper documents than the analysis ever produces are rejected.
+constexpr int max_depth = 16;
+
+// Runs the serializer straight into the end of `out`.
+void drain(boost::json::serializer& sr, std::string& out) {
+  while (!sr.done()) {
+    auto const used = out.size();
+    out.resize(used + serialize_chunk);
+    auto const written = sr.read(out.data() + used, serialize_chunk);
+    out.resize(used + written.size());
+  }
+}
+
+void append_json_string(boost::json::serializer& sr, std::string_view text, std::string& out) {
+  sr.reset(boost::json::string_view(text.data(), text.size()));
+  drain(sr, out);
+}
+
+void append_number(std::size_t value, std::string& out) {
+  char digits[std::numeric_limits<std::size_t>::digits10 + 1];
+  auto const end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+  out.append(digits, end);
+}
+
+// Roughly the encoded size of the map, so the output is allocated once.
+std::size_t estimate_size(boost::json::object const& stats) {
+  std::size_t bytes = 256;
+  for (auto const& [level, messages] : stats) {
+    bytes += level.size() + 8;
+    if (auto const* inner = messages.if_object()) {
+      for (auto const& [message, count] : *inner) bytes += message.size() + 16;
+    }
+  }
+  return bytes;
+}
+
+void put_byte(unsigned value, std::string& out) {
+  out += static_cast<char>(value);
+}
+
+template <class T>
+void put_big_endian(T value, std::string& out) {
+  for (int shift = (sizeof(T) - 1) * 8; shift >= 0; shift -= 8) {
+    out += static_cast<char>((value >> shift) & 0xff);
+  }
+}
+
+void put_uint(std::uint64_t value, std::string& out) {
+  if (value < 0x80) {
+    put_byte(static_cast<unsigned>(value), out);
+  } else if (value <= 0xff) {
+    put_byte(0xcc, out);
+    put_byte(static_cast<unsigned>(value), out);
+  } else if (value <= 0xffff) {
+    put_byte(0xcd, out);
+    put_big_endian(static_cast<std::uint16_t>(value), out);
+  } else if (value <= 0xffffffff) {
+    put_byte(0xce, out);
+    put_big_endian(static_cast<std::uint32_t>(value), out);
+  } else {
+    put_byte(0xcf, out);
+    put_big_endian(value, out);
+  }
+}
+
+void put_int(std::int64_t value, std::string& out) {
+  if (value >= 0) return put_uint(static_cast<std::uint64_t>(value), out);
+  if (value >= -32) return put_byte(static_cast<std::uint8_t>(value), out);
+  put_byte(0xd3, out);
+  put_big_endian(static_cast<std::uint64_t>(value), out);
+}
+
+// Header of a string, array or map: a fixed form for small sizes, else a
+// marker and a 16- or 32-bit length.
+void put_length(std::size_t size,
+    std::size_t fixed_limit,
+    unsigned fixed,
+    unsigned marker16,
+    std::string& out) {
+  if (size < fixed_limit) {
+    put_byte(fixed | static_cast<unsigned>(size), out);
+  } else if (size <= 0xffff) {
+    put_byte(marker16, out);
+    put_big_endian(static_cast<std::uint16_t>(size), out);
+  } else {
+    put_byte(marker16 + 1, out);
+    put_big_endian(static_cast<std::uint32_t>(size), out);
+  }
+}
+
+void put_string(std::string_view text, std::string& out) {
+  if (text.size() >= 32 && text.size() <= 0xff) {
+    put_byte(0xd9, out);
+    put_byte(static_cast<unsigned>(text.size()), out);
+  } else {
+    put_length(text.size(), 32, 0xa0, 0xda, out);
+  }
+  out += text;
+}
+
+void put_value(boost::json::value const& value, std::string& out);
+
+void put_object(boost::json::object const& object, std::string& out) {
+  put_length(object.size(), 16, 0x80, 0xde, out);
+  for (auto const& [key, value] : object) {
+    put_string(key, out);
+    put_value(value, out);
+  }
+}
+
+void put_value(boost::json::value const& value, std::string& out) {
+  switch (value.kind()) {
+    case boost::json::kind::null:
+      put_byte(0xc0, out);
+      break;
+    case boost::json::kind::bool_:
+      put_byte(value.get_bool() ? 0xc3 : 0xc2, out);
+      break;
+    case boost::json::kind::int64:
+      put_int(value.get_int64(), out);
+      break;
+    case boost::json::kind::uint64:
+      put_uint(value.get_uint64(), out);
+      break;
+    case boost::json::kind::double_:
+      put_byte(0xcb, out);
+      put_big_endian(std::bit_cast<std::uint64_t>(value.get_double()), out);
+      break;
+    case boost::json::kind::string:
+      put_string(value.get_string(), out);
+      break;
+    case boost::json::kind::array:
+      put_length(value.get_array().size(), 16, 0x90, 0xdc, out);
+      for (auto const& element : value.get_array()) put_value(element, out);
+      break;
+    case boost::json::kind::object:
+      put_object(value.get_object(), out);
+      break;
+  }
+}
+
+class msgpack_reader {
+ public:
+  explicit msgpack_reader(std::string_view data) : data_(data) {}
+
+  bool at_end() const { return position_ == data_.size(); }
+
+  bool read(boost::json::value& out, int depth) {
+    if (depth > max_depth) return false;
+    std::uint8_t marker = 0;
+    if (!take_big_endian(marker)) return false;
+
+    if (marker < 0x80) {
+      out = std::int64_t{marker};  // Positive fixint
+      return true;
+    }
+    if (marker >= 0xe0) {
+      out = std::int64_t{static_cast<std::int8_t>(marker)};  // Negative fixint
+      return true;
+    }
+    if (marker < 0x90) return read_object(marker & 0x0f, out, depth);
+    if (marker < 0xa0) return read_array(marker & 0x0f, out, depth);
+    if (marker < 0xc0) return read_string(marker & 0x1f, out);
+
+    std::size_t size = 0;
+    switch (marker) {
+      case 0xc0:
+        out = nullptr;
+        return true;
+      case 0xc2:
+      case 0xc3:
+        out = marker == 0xc3;
+        return true;
+      case 0xcb: {
+        std::uint64_t bits = 0;
+        if (!take_big_endian(bits)) return false;
+        out = std::bit_cast<double>(bits);
+        return true;
+      }
+      case 0xcc: return read_uint<std::uint8_t>(out);
+      case 0xcd: return read_uint<std::uint16_t>(out);
+      case 0xce: return read_uint<std::uint32_t>(out);
+      case 0xcf: return read_uint<std::uint64_t>(out);
+      case 0xd0: return read_int<std::int8_t, std::uint8_t>(out);
+      case 0xd1: return read_int<std::int16_t, std::uint16_t>(out);
+      case 0xd2: return read_int<std::int32_t, std::uint32_t>(out);
+      case 0xd3: return read_int<std::int64_t, std::uint64_t>(out);
+      case 0xd9: return take_length<std::uint8_t>(size) && read_string(size, out);
+      case 0xda: return take_length<std::uint16_t>(size) && read_string(size, out);
+      case 0xdb: return take_length<std::uint32_t>(size) && read_string(size, out);
+      case 0xdc: return take_length<std::uint16_t>(size) && read_array(size, out, depth);
+      case 0xdd: return take_length<std::uint32_t>(size) && read_array(size, out, depth);
+      case 0xde: return take_length<std::uint16_t>(size) && read_object(size, out, depth);
+      case 0xdf: return take_length<std::uint32_t>(size) && read_object(size, out, depth);
+      default:
+        return false;  // bin, ext and float32 are never written
+    }
+  }
+
+ private:
+  std::string_view data_;
+  std::size_t position_ = 0;
+
+  std::size_t remaining() const { return data_.size() - position_; }
+
+  template <class T>
+  bool take_big_endian(T& value) {
+    if (remaining() < sizeof(T)) return false;
+    value = 0;
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+      value = static_cast<T>((value << 8) | static_cast<std::uint8_t>(data_[position_ + i]));
+    }
+    position_ += sizeof(T);
+    return true;
+  }
+
+  template <class Length>
+  bool take_length(std::size_t& size) {
+    Length length = 0;
+    if (!take_big_endian(length)) return false;
+    size = length;
+    return true;
+  }
+
+  template <class T>
+  bool read_uint(boost::json::value& out) {
+    T value = 0;
+    if (!take_big_endian(value)) return false;
+    if (value <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max())) {
+      out = static_cast<std::int64_t>(value);
+    } else {
+      out = static_cast<std::uint64_t>(value);
+    }
+    return true;
+  }
+
+  template <class Signed, class Unsigned>
+  bool read_int(boost::json::value& out) {
+    Unsigned bits = 0;
+    if (!take_big_endian(bits)) return false;
+    out = std::int64_t{static_cast<Signed>(bits)};
+    return true;
+  }
+
+  bool read_string(std::size_t size, boost::json::value& out) {
+    if (remaining() < size) return false;
+    out = boost::json::string_view(data_.data() + position_, size);
+    position_ += size;
+    return true;
+  }
+
+  bool read_array(std::size_t size, boost::json::value& out, int depth) {
+    auto& array = out.emplace_array();
+    array.reserve(std::min(size, remaining()));  // Every element takes a byte
+    for (std::size_t i = 0; i < size; ++i) {
+      if (!read(array.emplace_back(nullptr), depth + 1)) return false;
+    }
+    return true;
+  }
+
+  bool read_object(std::size_t size, boost::json::value& out, int depth) {
+    auto& object = out.emplace_object();
+    object.reserve(std::min(size, remaining() / 2));  // A key and a value per entry
+    boost::json::value key;
+    for (std::size_t i = 0; i < size; ++i) {
+      if (!read(key, depth + 1) || !key.is_string()) return false;
+      if (!read(object[key.get_string()], depth + 1)) return false;
+    }
+    return true;
+  }
+};
+
+}  // namespace
+
+response_format negotiate_format(std::string_view accept) {
+  double json_q = -1;
+  double msgpack_q = -1;
+  detail::for_each_element(accept, [&](std::string_view name, double q) {
+    if (detail::iequals(name, "application/vnd.msgpack") ||
+        detail::iequals(name, "application/msgpack") ||
+        detail::iequals(name, "application/x-msgpack")) {
+      msgpack_q = q;
+    } else if (detail::iequals(name, "application/json")) {
+      json_q = q;
+    }
+  });
+  return msgpack_q > 0 && msgpack_q >= json_q ? response_format::msgpack : response_format::json;
+}
+
+std::string_view content_type(response_format format) {
+  return format == response_format::msgpack ? "application/vnd.msgpack" : "application/json";
+}
+
+void write_json(analysis const& result, std::string& out) {
+  out.reserve(out.size() + estimate_size(result.message_stats));
+  boost::json::serializer sr;
+  out += R"({"status":"success","total_entries":)";
+  append_number(result.total_entries, out);
+  out += R"(,"client_ip":)";
+  append_json_string(sr, result.client_ip, out);
+  out += R"(,"client_port":)";
+  append_json_string(sr, result.client_port, out);
+  out += R"(,"analysis_type":)";
+  append_json_string(sr, result.analysis_type, out);
+  out += R"(,"message_stats":)";
+  sr.reset(&result.message_stats);
+  drain(sr, out);
+  out += R"(,"invalid_data":)";
+  append_number(result.invalid_data, out);
+  if (!result.next_cursor.empty()) {
+    out += R"(,"next_cursor":)";
+    append_json_string(sr, result.next_cursor, out);
+  }
+  out += '}';
+}
+
+void write_msgpack(analysis const& result, std::string& out) {
+  out.reserve(out.size() + estimate_size(result.message_stats));
+  put_length(result.next_cursor.empty() ? 7 : 8, 16, 0x80, 0xde, out);
+  put_string("status", out);
+  put_string("success", out);
+  put_string("total_entries", out);
+  put_uint(result.total_entries, out);
+  put_string("client_ip", out);
+  put_string(result.client_ip, out);
+  put_string("client_port", out);
+  put_string(result.client_port, out);
+  put_string("analysis_type", out);
+  put_string(result.analysis_type, out);
+  put_string("message_stats", out);
+  put_object(result.message_stats, out);
+  put_string("invalid_data", out);
+  put_uint(result.invalid_data, out);
+  if (!result.next_cursor.empty()) {
+    put_string("next_cursor", out);
+    put_string(result.next_cursor, out);
+  }
+}
+
+std::optional<boost::json::value> read_msgpack(std::string_view data) {
+  msgpack_reader reader(data);
+  boost::json::value value;
+  if (!reader.read(value, 0) || !reader.at_end()) return std::nullopt;
+  return value;
+}
+
+}  // namespace codec
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <boost/json.hpp>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Encodings of the analysis result: `status`, the entry counts, the client and
+// the `level -> message -> count` map. Both writers append straight to the
+// response body from the aggregate, without building a JSON document first.
+namespace codec {
+
+enum class response_format { json, msgpack };
+
+// MessagePack when the Accept header prefers it over JSON, else JSON.
+response_format negotiate_format(std::string_view accept);
+
+std::string_view content_type(response_format format);
+
+// Everything the analysis response carries, by reference.
+struct analysis {
+  std::size_t total_entries;
+  std::string_view client_ip;
+  std::string_view client_port;
+  std::string_view analysis_type;
+  std::size_t invalid_data;
+  boost::json::object const& message_stats;
+  std::string_view next_cursor = {};  // Written only when set
+};
+
+void write_json(analysis const& result, std::string& out);
+void write_msgpack(analysis const& result, std::string& out);
+
+// Decodes a MessagePack document into the same value the JSON form parses to.
+// Returns nothing if the data is malformed or uses types the writer never emits.
+std::optional<boost::json::value> read_msgpack(std::string_view data);
+
+}  // namespace codec
@@ -0,0 +1,49 @@
+#include "digest.hpp"
+
+#define XXH_STATIC_LINKING_ONLY  // XXH3_state_t by value
+#include <xxhash.h>
+
+#include <format>
+
+namespace codec {
+
+namespace {
+
+digest from_xxh(XXH128_hash_t const& value) {
+  return {value.high64, value.low64};
+}
+
+}  // namespace
+
+std::string digest::hex() const {
+  return std::format("{:016x}{:016x}", high, low);
+}
+
+digest hash(std::string_view data) {
+  return from_xxh(XXH3_128bits(data.data(), data.size()));
+}
+
+struct hasher::state {
+  XXH3_state_t xxh;
+};
+
+hasher::hasher() = default;
+hasher::~hasher() = default;
+hasher::hasher(hasher&&) noexcept = default;
+hasher& hasher::operator=(hasher&&) noexcept = default;
+
+void hasher::update(char const* data, std::size_t size) {
+  if (!state_) {
+    state_ = std::make_unique<state>();
+    XXH3_128bits_reset(&state_->xxh);
+  }
+  XXH3_128bits_update(&state_->xxh, data, size);
+  bytes_ += size;
+}
+
+digest hasher::value() const {
+  if (!state_) return hash({});
+  return from_xxh(XXH3_128bits_digest(&state_->xxh));
+}
+
+}  // namespace codec
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace codec {
+
+// A 128-bit XXH3 digest: not cryptographic, but several times faster than
+// reading the bytes from disk, and wide enough that distinct uploads do not
+// collide in practice.
+struct digest {
+  std::uint64_t high = 0;
+  std::uint64_t low = 0;
+
+  bool operator==(digest const&) const = default;
+  // 32 lowercase hex digits.
+  std::string hex() const;
+};
+
+struct digest_hash {
+  std::size_t operator()(digest const& d) const { return static_cast<std::size_t>(d.low); }
+};
+
+digest hash(std::string_view data);
+
+// Streaming digest: feed the content in any split. The state is allocated on
+// the first update, so an unused hasher costs nothing.
+class hasher {
+ public:
+  hasher();
+  ~hasher();
+  hasher(hasher&&) noexcept;
+  hasher& operator=(hasher&&) noexcept;
+
+  void update(char const* data, std::size_t size);
+  // The digest of everything fed so far; more may follow.
+  digest value() const;
+  std::uint64_t bytes() const { return bytes_; }
+
+ private:
+  struct state;
+  std::unique_ptr<state> state_;
+  std::uint64_t bytes_ = 0;
+};
+
+}  // namespace codec
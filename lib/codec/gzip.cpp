@@ -0,0 +1,173 @@
+#include "gzip.hpp"
+
+#include <zlib.h>
+
+#include <cstddef>
+
+#include "header_values.hpp"
+
+namespace codec {
+
+namespace {
+
+// Adds 16 to the window bits to get a gzip header and trailer instead of zlib's;
+// adding 32 when inflating accepts either.
+constexpr int gzip_window_bits = 15 + 16;
+constexpr int detect_window_bits = 15 + 32;
+constexpr int memory_level = 8;
+constexpr std::size_t decompress_chunk = 64 * 1024;
+
+using detail::iequals;
+using detail::trim;
+
+}  // namespace
+
+struct inflater::state {
+  z_stream stream{};
+  bool ready = false;
+};
+
+inflater::inflater(content_coding coding) : state_(std::make_unique<state>()) {
+  // Both codings are detected from the stream header.
+  static_cast<void>(coding);
+  state_->ready = inflateInit2(&state_->stream, detect_window_bits) == Z_OK;
+}
+
+inflater::~inflater() {
+  if (state_->ready) inflateEnd(&state_->stream);
+}
+
+step_result inflater::step(const char* in, std::size_t in_size, char* out, std::size_t out_size) {
+  step_result result;
+  if (!state_->ready) {
+    result.error = true;
+    return result;
+  }
+  if (done_) {
+    result.done = true;
+    return result;
+  }
+  auto& stream = state_->stream;
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in));
+  stream.avail_in = static_cast<uInt>(in_size);
+  stream.next_out = reinterpret_cast<Bytef*>(out);
+  stream.avail_out = static_cast<uInt>(out_size);
+
+  int const status = inflate(&stream, Z_NO_FLUSH);
+  result.consumed = in_size - stream.avail_in;
+  result.produced = out_size - stream.avail_out;
+  done_ = status == Z_STREAM_END;
+  result.done = done_;
+  // Z_BUF_ERROR only means no progress was possible with these buffers.
+  result.error = status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR;
+  return result;
+}
+
+struct deflater::state {
+  z_stream stream{};
+  bool ready = false;
+};
+
+deflater::deflater(int level) : state_(std::make_unique<state>()) {
+  state_->ready = deflateInit2(&state_->stream,
+                      level,
+                      Z_DEFLATED,
+                      gzip_window_bits,
+                      memory_level,
+                      Z_DEFAULT_STRATEGY) == Z_OK;
+}
+
+deflater::~deflater() {
+  if (state_->ready) deflateEnd(&state_->stream);
+}
+
+step_result deflater::step(const char* in,
+    std::size_t in_size,
+    char* out,
+    std::size_t out_size,
+    bool finish) {
+  step_result result;
+  if (!state_->ready) {
+    result.error = true;
+    return result;
+  }
+  auto& stream = state_->stream;
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in));
+  stream.avail_in = static_cast<uInt>(in_size);
+  stream.next_out = reinterpret_cast<Bytef*>(out);
+  stream.avail_out = static_cast<uInt>(out_size);
+
+  int const status = deflate(&stream, finish ? Z_FINISH : Z_NO_FLUSH);
+  result.consumed = in_size - stream.avail_in;
+  result.produced = out_size - stream.avail_out;
+  result.done = status == Z_STREAM_END;
+  result.error = status == Z_STREAM_ERROR;
+  return result;
+}
+
+content_coding parse_content_coding(std::string_view content_encoding) {
+  auto const name = trim(content_encoding);
+  if (name.empty() || iequals(name, "identity")) return content_coding::identity;
+  if (iequals(name, "gzip") || iequals(name, "x-gzip")) return content_coding::gzip;
+  if (iequals(name, "deflate")) return content_coding::deflate;
+  return content_coding::unsupported;
+}
+
+std::optional<std::string> decompress(std::string_view data,
+    content_coding coding,
+    std::size_t limit) {
+  if (coding == content_coding::identity) return std::string(data);
+  if (coding == content_coding::unsupported) return std::nullopt;
+
+  inflater decoder(coding);
+  std::string out;
+  while (!decoder.done()) {
+    std::size_t const used = out.size();
+    out.resize(used + decompress_chunk);
+    auto const result = decoder.step(data.data(), data.size(), out.data() + used, decompress_chunk);
+    out.resize(used + result.produced);
+    data.remove_prefix(result.consumed);
+    if (result.error || out.size() > limit) return std::nullopt;
+    // Truncated input: nothing left to feed and no room was needed.
+    if (!result.done && data.empty() && result.produced < decompress_chunk) return std::nullopt;
+  }
+  return out;
+}
+
+std::optional<std::string> gzip(std::string_view data, int level) {
+  z_stream stream{};
+  int const init = deflateInit2(&stream,
+      level,
+      Z_DEFLATED,
+      gzip_window_bits,
+      memory_level,
+      Z_DEFAULT_STRATEGY);
+  if (init != Z_OK) {
+    return std::nullopt;
+  }
+
+  std::string out(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.size());
+  stream.next_out = reinterpret_cast<Bytef*>(out.data());
+  stream.avail_out = static_cast<uInt>(out.size());
+
+  int const result = deflate(&stream, Z_FINISH);
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+  if (result != Z_STREAM_END) return std::nullopt;
+  return out;
+}
+
+bool accepts_gzip(std::string_view accept_encoding) {
+  double gzip_q = -1;
+  double any_q = -1;
+  detail::for_each_element(accept_encoding, [&](std::string_view name, double q) {
+    if (iequals(name, "gzip") || iequals(name, "x-gzip")) gzip_q = q;
+    if (name == "*") any_q = q;
+  });
+  // An explicit gzip entry wins over the wildcard.
+  return gzip_q >= 0 ? gzip_q > 0 : any_q > 0;
+}
+
+}  // namespace codec
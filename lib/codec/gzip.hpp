@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace codec {
+
+enum class content_coding { identity, gzip, deflate, unsupported };
+
+// Coding named by a Content-Encoding header value. Stacked codings
+// ("gzip, br") are reported as unsupported.
+content_coding parse_content_coding(std::string_view content_encoding);
+
+// Whole-buffer gzip, for content that is compressed once and served many
+// times. Returns nothing if zlib fails.
+std::optional<std::string> gzip(std::string_view data, int level = 9);
+
+// Whole-buffer decoding of a gzip or deflate body. Returns nothing if the data
+// is corrupt or inflates past `limit` bytes.
+std::optional<std::string> decompress(std::string_view data,
+    content_coding coding,
+    std::size_t limit = std::size_t{1} << 30);
+
+// True if an Accept-Encoding header value allows a gzip response.
+bool accepts_gzip(std::string_view accept_encoding);
+
+// Progress of one step of a streaming coder.
+struct step_result {
+  std::size_t consumed = 0;
+  std::size_t produced = 0;
+  bool done = false;   // End of the compressed stream reached or written
+  bool error = false;  // Corrupt input or a zlib failure
+};
+
+// Streaming decoder for gzip and deflate (zlib-wrapped) data. Feed input in
+// any split; each step fills as much of `out` as it can.
+class inflater {
+ public:
+  explicit inflater(content_coding coding);
+  ~inflater();
+  inflater(const inflater&) = delete;
+  inflater& operator=(const inflater&) = delete;
+
+  step_result step(const char* in, std::size_t in_size, char* out, std::size_t out_size);
+  bool done() const { return done_; }
+
+  // Decodes all of `in`, or as much as comes before the end of the stream,
+  // through `out`, handing each decoded run to `emit` as a string_view.
+  // Returns false if the data is corrupt.
+  template <class Emit>
+  bool inflate_all(std::string_view in, char* out, std::size_t out_size, Emit&& emit) {
+    while (!done_) {
+      auto const result = step(in.data(), in.size(), out, out_size);
+      emit(std::string_view(out, result.produced));
+      in.remove_prefix(result.consumed);
+      if (result.error) return false;
+      // A partly filled output means zlib has used up this input. A full one
+      // may have used it up too, which the next step shows by producing
+      // nothing, so this comes before the check for a stalled stream.
+      if (in.empty() && result.produced < out_size) break;
+      if (result.consumed == 0 && result.produced == 0) return false;
+    }
+    return true;
+  }
+
+ private:
+  struct state;
+  std::unique_ptr<state> state_;
+  bool done_ = false;
+};
+
+// Streaming gzip encoder. Steps with `finish` set flush everything buffered
+// and write the trailer; keep calling until the result is done.
+class deflater {
+ public:
+  explicit deflater(int level = 6);
+  ~deflater();
+  deflater(const deflater&) = delete;
+  deflater& operator=(const deflater&) = delete;
+
+  step_result step(const char* in,
+      std::size_t in_size,
+      char* out,
+      std::size_t out_size,
+      bool finish);
+
+ private:
+  struct state;
+  std::unique_ptr<state> state_;
+};
+
+}  // namespace codec
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <string_view>
+
+// Parsing shared by the Accept and Accept-Encoding negotiation.
+namespace codec::detail {
+
+inline std::string_view trim(std::string_view text) {
+  auto const first = text.find_first_not_of(" \t");
+  if (first == std::string_view::npos) return {};
+  auto const last = text.find_last_not_of(" \t");
+  return text.substr(first, last - first + 1);
+}
+
+inline bool iequals(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) return false;
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    auto lower = [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; };
+    if (lower(a[i]) != lower(b[i])) return false;
+  }
+  return true;
+}
+
+// Quality of one list element's parameters ("gzip;q=0.5"), 1 when absent.
+inline double quality(std::string_view params) {
+  auto const q = params.find("q=");
+  if (q == std::string_view::npos) return 1;
+  auto const value = trim(params.substr(q + 2));
+  double result = 1;
+  std::from_chars(value.data(), value.data() + value.size(), result);
+  return result;
+}
+
+// Calls `fn(name, q)` for each element of a comma-separated header value.
+template <class Fn>
+void for_each_element(std::string_view header, Fn&& fn) {
+  while (!header.empty()) {
+    auto const comma = header.find(',');
+    auto const element = header.substr(0, comma);
+    header = comma == std::string_view::npos ? std::string_view{} : header.substr(comma + 1);
+
+    auto const semicolon = element.find(';');
+    auto const name = trim(element.substr(0, semicolon));
+    double const q =
+        semicolon == std::string_view::npos ? 1 : quality(element.substr(semicolon + 1));
+    fn(name, q);
+  }
+}
+
+}  // namespace codec::detail
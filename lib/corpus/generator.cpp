@@ -0,0 +1,218 @@
+#include "generator.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <iterator>
+#include <numbers>
+#include <utility>
+
+namespace {
+
+constexpr std::array<std::string_view, 5> levels{"INFO", "DEBUG", "WARN", "ERROR", "CRITICAL"};
+constexpr std::array<std::string_view, 6> sources{
+    "api", "auth", "billing", "db", "scheduler", "worker"};
+constexpr std::array<std::string_view, 20> words{"request", "timeout", "user", "session",
+    "cache", "miss", "connection", "reset", "disk", "latency", "retry", "queue", "worker",
+    "token", "expired", "payload", "upstream", "handshake", "commit", "shard"};
+
+constexpr std::size_t flush_bytes = 1 << 20;
+
+// splitmix64. The std engines are portable but the std distributions are not,
+// so all sampling is done by hand on top of this.
+class splitmix64 {
+ public:
+  explicit splitmix64(std::uint64_t seed) : state_(seed) {}
+
+  std::uint64_t next() {
+    std::uint64_t z = (state_ += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+  }
+
+  double uniform() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }  // [0, 1)
+  std::uint64_t below(std::uint64_t bound) { return bound ? next() % bound : 0; }
+
+ private:
+  std::uint64_t state_;
+};
+
+std::size_t pick(const auto& cdf, double u) {
+  auto const it = std::upper_bound(std::begin(cdf), std::end(cdf), u);
+  return std::min<std::size_t>(static_cast<std::size_t>(it - std::begin(cdf)), std::size(cdf) - 1);
+}
+
+void append_timestamp(std::string& out, std::uint64_t second) {
+  using namespace std::chrono;
+  sys_seconds const time = sys_days{2026y / January / 1} + seconds{second};
+  std::format_to(std::back_inserter(out), "{:%F %T}", time);
+}
+
+}  // namespace
+
+corpus_generator::corpus_generator(corpus_options options) : options_(std::move(options)) {
+  options_.distinct_messages = std::max<std::size_t>(options_.distinct_messages, 1);
+  options_.max_message_length = std::max(options_.max_message_length, options_.min_message_length);
+
+  // Zipf: message k is drawn with probability proportional to 1 / (k + 1)^s.
+  message_cdf_.resize(options_.distinct_messages);
+  double total = 0;
+  for (std::size_t k = 0; k < message_cdf_.size(); ++k) {
+    total += 1.0 / std::pow(static_cast<double>(k + 1), options_.zipf_skew);
+    message_cdf_[k] = total;
+  }
+  for (auto& p : message_cdf_) p /= total;
+
+  double level_total = 0;
+  for (std::size_t i = 0; i < levels.size(); ++i) {
+    level_total += std::max(options_.level_weights[i], 0.0);
+    level_cdf_[i] = level_total;
+  }
+  for (auto& p : level_cdf_) p = level_total > 0 ? p / level_total : 1;
+}
+
+std::string_view corpus_generator::extension(corpus_format format) {
+  switch (format) {
+    case corpus_format::json:
+      return "json";
+    case corpus_format::xml:
+      return "xml";
+    case corpus_format::text:
+      return "txt";
+    case corpus_format::ndjson:
+      return "ndjson";
+  }
+  return {};
+}
+
+// Message text is a pure function of the seed and the message index, so it is
+// rebuilt on demand instead of keeping every distinct message in memory.
+void corpus_generator::append_message(std::string& out, std::size_t index) const {
+  splitmix64 rng(options_.seed ^ (0xa0761d6478bd642f * (index + 1)));
+
+  auto const min = static_cast<double>(options_.min_message_length);
+  auto const max = static_cast<double>(options_.max_message_length);
+  double length = min + rng.uniform() * (max - min + 1);
+  if (options_.message_lengths == length_distribution::lognormal) {
+    // Box-Muller normal, shaped so the median sits at the midpoint of the range.
+    double const u1 = 1 - rng.uniform();
+    double const u2 = rng.uniform();
+    double const z = std::sqrt(-2 * std::log(u1)) * std::cos(2 * std::numbers::pi * u2);
+    length = std::clamp((min + max) / 2 * std::exp(0.5 * z), min, max);
+  }
+  auto const wanted = static_cast<std::size_t>(length);
+
+  // The "m<index>" prefix keeps distinct messages distinct whatever their length.
+  std::size_t const start = out.size();
+  std::format_to(std::back_inserter(out), "m{}", index);
+  std::size_t const prefix = out.size() - start;
+  while (out.size() - start < wanted) {
+    out += ' ';
+    out += words[rng.below(words.size())];
+  }
+  out.resize(start + std::max(wanted, prefix));
+  while (out.back() == ' ') out.pop_back();
+}
+
+template <class Sink>
+corpus_stats corpus_generator::emit(corpus_format format, Sink&& sink) const {
+  splitmix64 rng(options_.seed);
+  corpus_stats stats;
+  std::string chunk;
+  chunk.reserve(flush_bytes + 4096);
+
+  auto flush = [&] {
+    stats.bytes += chunk.size();
+    sink(chunk);
+    chunk.clear();
+  };
+  auto done = [&] {
+    if (options_.target_bytes > 0) return stats.bytes + chunk.size() >= options_.target_bytes;
+    return stats.records >= options_.records;
+  };
+
+  if (format == corpus_format::json) chunk += "[\n";
+  if (format == corpus_format::xml) chunk += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<logs>\n";
+
+  std::string message;
+  while (!done()) {
+    // Draws happen in the same order for every format so the records match.
+    std::string_view const level = levels[pick(level_cdf_, rng.uniform())];
+    std::size_t const index = pick(message_cdf_, rng.uniform());
+    std::string_view const source = sources[rng.below(sources.size())];
+    bool const invalid = rng.uniform() < options_.invalid_rate;
+
+    message.clear();
+    append_message(message, index);
+
+    // Invalid records are the shapes each parser rejects: a null JSON message,
+    // an empty XML message, a text line with no message field.
+    switch (format) {
+      case corpus_format::json:
+      case corpus_format::ndjson:
+        if (format == corpus_format::json) chunk += stats.records ? ",\n  " : "  ";
+        chunk += "{\"timestamp\":\"";
+        append_timestamp(chunk, stats.records);
+        chunk += "\",\"log_level\":\"";
+        chunk += level;
+        if (invalid) {
+          chunk += "\",\"message\":null";
+        } else {
+          chunk += "\",\"message\":\"";
+          chunk += message;
+          chunk += '"';
+        }
+        chunk += ",\"source\":\"";
+        chunk += source;
+        chunk += "\"}";
+        if (format == corpus_format::ndjson) chunk += '\n';
+        break;
+      case corpus_format::xml:
+        chunk += "  <log><timestamp>";
+        append_timestamp(chunk, stats.records);
+        chunk += "</timestamp><log_level>";
+        chunk += level;
+        chunk += "</log_level><message>";
+        if (!invalid) chunk += message;
+        chunk += "</message><source>";
+        chunk += source;
+        chunk += "</source></log>\n";
+        break;
+      case corpus_format::text:
+        append_timestamp(chunk, stats.records);
+        chunk += '|';
+        chunk += level;
+        if (!invalid) {
+          chunk += '|';
+          chunk += message;
+          chunk += '|';
+          chunk += source;
+        }
+        chunk += '\n';
+        break;
+    }
+
+    ++stats.records;
+    if (invalid) ++stats.invalid;
+    if (chunk.size() >= flush_bytes) flush();
+  }
+
+  if (format == corpus_format::json) chunk += "\n]\n";
+  if (format == corpus_format::xml) chunk += "</logs>\n";
+  flush();
+  return stats;
+}
+
+corpus_stats corpus_generator::write(std::ostream& out, corpus_format format) const {
+  return emit(format, [&](const std::string& chunk) {
+    out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+  });
+}
+
+std::string corpus_generator::generate(corpus_format format) const {
+  std::string corpus;
+  emit(format, [&](const std::string& chunk) { corpus += chunk; });
+  return corpus;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class corpus_format { json, xml, text, ndjson };
+
+enum class length_distribution { uniform, lognormal };
+
+struct corpus_options {
+  std::uint64_t seed = 1;
+  std::uint64_t records = 100'000;  // Records per corpus, unless target_bytes is set
+  std::uint64_t target_bytes = 0;   // When set, write records until the corpus reaches this size
+  std::size_t distinct_messages = 1000;
+  double zipf_skew = 1.0;  // 0 draws messages uniformly; larger values favour the first few
+  std::array<double, 5> level_weights{60, 20, 10, 8, 2};  // INFO, DEBUG, WARN, ERROR, CRITICAL
+  std::size_t min_message_length = 16;
+  std::size_t max_message_length = 64;
+  length_distribution message_lengths = length_distribution::uniform;
+  double invalid_rate = 0;  // Fraction of records the parsers must count as invalid
+};
+
+struct corpus_stats {
+  std::uint64_t records = 0;
+  std::uint64_t invalid = 0;
+  std::uint64_t bytes = 0;
+};
+
+// Deterministic synthetic log corpora in the formats the server parses, plus
+// NDJSON. The same options and seed always give byte-identical output, and
+// every format written by one generator carries the same record sequence.
+// Output is produced in bounded chunks, so corpus size is limited only by disk.
+class corpus_generator {
+ public:
+  explicit corpus_generator(corpus_options options);
+
+  corpus_stats write(std::ostream& out, corpus_format format) const;
+  std::string generate(corpus_format format) const;
+
+  static std::string_view extension(corpus_format format);
+
+ private:
+  template <class Sink>
+  corpus_stats emit(corpus_format format, Sink&& sink) const;
+  void append_message(std::string& out, std::size_t index) const;
+
+  corpus_options options_;
+  std::vector<double> message_cdf_;
+  std::array<double, 5> level_cdf_{};
+};
@@ -1,31 +1,35 @@
 #include "handler.hpp"
 
+#include <algorithm>
+#include <array>
 #include <map>
 #include <pugixml.hpp>
 #include <unordered_map>
 
+#include "../log/logger.hpp"
 #include "simdjson.h"
 
-std::string trim(const std::string& data) {
+std::string_view trim(std::string_view data) {
   size_t first = data.find_first_not_of(" \t\n\r\f\v");
   size_t last = data.find_last_not_of(" \t\n\r\f\v");
 
-  if (first == std::string::npos) return "";
+  if (first == std::string_view::npos) return {};
 
   return data.substr(first, last - first + 1);
 }
 
-bool is_log_level(const std::string& log_level) {
-  const std::vector<std::string> valid_log_level = {"INFO", "DEBUG", "WARN", "ERROR", "CRITICAL"};
+bool is_log_level(std::string_view log_level) {
+  static constexpr std::array<std::string_view, 5> valid_log_level = {
+      "INFO", "DEBUG", "WARN", "ERROR", "CRITICAL"};
   return std::find(valid_log_level.begin(), valid_log_level.end(), log_level) !=
          valid_log_level.end();
 }
 
-computed_data process_json_request(const std::string& body) {
+computed_data process_json_request(std::string_view body) {
   computed_data response_data;
   simdjson::dom::parser parser;
   try {
-    simdjson::dom::element logs_array = parser.parse(body);
+    simdjson::dom::element logs_array = parser.parse(body.data(), body.size());
 
     std::unordered_map<std::string, std::map<std::string, int>> parsedData;
     size_t valid_objects = 0, invalid_objects = 0;
@@ -60,7 +64,7 @@ computed_data process_json_request(const std::string& body) {
       throw std::runtime_error("Parsed JSON is not an object");
     }
   } catch (const std::exception& e) {
-    std::cerr << "[ERROR] Processing Json: " << e.what() << '\n';
+    LOG_ERROR("Processing Json: {}", e.what());
     response_data.total_fields = 0;
     response_data.invalid_fields = 0;
     response_data.error_message = e.what();
@@ -70,36 +74,36 @@ computed_data process_json_request(const std::string& body) {
   return response_data;
 }
 
-computed_data parse_text_file(const std::string& body) {
+computed_data parse_text_file(std::string_view body) {
   computed_data response_data;
 
   std::unordered_map<std::string, std::unordered_map<std::string, int>> parsedData;
   size_t valid_objects = 0, invalid_objects = 0;
 
-  std::stringstream iss(body);
-  std::string line;
   try {
-    while (std::getline(iss, line)) {
-      std::stringstream iss_line(line);
-      size_t field = 0;
-      std::string line_data, log_level, message;
-
-      while (std::getline(iss_line, line_data, '|')) {
-        ++field;
-        if (field == 2) {
-          log_level = trim(line_data);
-        }
-        if (field == 3) {
-          message = trim(line_data);
-          break;
-        }
+    size_t line_start = 0;
+    while (line_start < body.size()) {
+      size_t line_end = body.find('\n', line_start);
+      if (line_end == std::string_view::npos) line_end = body.size();
+      std::string_view line = body.substr(line_start, line_end - line_start);
+      line_start = line_end + 1;
+
+      // Pipe-delimited: field 2 is the log level, field 3 the message
+      std::string_view log_level, message;
+      size_t field_start = 0;
+      for (size_t field = 1; field <= 3 && field_start <= line.size(); ++field) {
+        size_t field_end = line.find('|', field_start);
+        if (field_end == std::string_view::npos) field_end = line.size();
+        if (field == 2) log_level = trim(line.substr(field_start, field_end - field_start));
+        if (field == 3) message = trim(line.substr(field_start, field_end - field_start));
+        field_start = field_end + 1;
       }
 
       if (log_level.empty() || message.empty()) {
         invalid_objects++;
         continue;
       }
-      parsedData[log_level][message]++;
+      parsedData[std::string(log_level)][std::string(message)]++;
       ++valid_objects;
     }
 
@@ -114,7 +118,7 @@ computed_data parse_text_file(const std::string& body) {
       throw std::runtime_error("Parsed JSON is not an object");
     }
   } catch (std::exception& e) {
-    std::cerr << "[ERROR] Processing Text: " << e.what() << '\n';
+    LOG_ERROR("Processing Text: {}", e.what());
     response_data.total_fields = 0;
     response_data.invalid_fields = 0;
     response_data.error_message = e.what();
@@ -124,7 +128,7 @@ computed_data parse_text_file(const std::string& body) {
   return response_data;
 }
 
-computed_data parse_xml_file(const std::string& body) {
+computed_data parse_xml_file(std::string_view body) {
   computed_data response_data;
 
   std::unordered_map<std::string, std::unordered_map<std::string, int>> parsedData;
@@ -132,19 +136,19 @@ computed_data parse_xml_file(const std::string& body) {
 
   try {
     pugi::xml_document doc;
-    doc.load_string(body.c_str());
+    doc.load_buffer(body.data(), body.size());
 
     pugi::xml_node logs = doc.child("logs");
 
     for (const auto& log : logs) {
-      const std::string currentLog = trim(log.child("log_level").text().as_string());
-      const std::string currentLogMsg = trim(log.child("message").text().as_string());
+      std::string_view const currentLog = trim(log.child("log_level").text().as_string());
+      std::string_view const currentLogMsg = trim(log.child("message").text().as_string());
       if (!is_log_level(currentLog) || currentLogMsg.empty()) {
         ++invalid_objects;
         continue;
       }
 
-      parsedData[currentLog][currentLogMsg]++;
+      parsedData[std::string(currentLog)][std::string(currentLogMsg)]++;
       ++valid_objects;
     }
     boost::json::value jv = boost::json::value_from(parsedData);
@@ -159,7 +163,7 @@ computed_data parse_xml_file(const std::string& body) {
     }
 
   } catch (const std::exception& e) {
-    std::cerr << "[ERROR] Processing XML: " << e.what() << '\n';
+    LOG_ERROR("Processing XML: {}", e.what());
     response_data.total_fields = 0;
     response_data.invalid_fields = 0;
     response_data.error_message = e.what();
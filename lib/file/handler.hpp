@@ -3,6 +3,7 @@
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/json.hpp>
 #include <string>
+#include <string_view>
 
 using tcp = boost::asio::ip::tcp;
 
@@ -13,7 +14,9 @@ struct computed_data {
   std::string error_message;
 };
 
-computed_data process_json_request(const std::string& body);
-computed_data parse_text_file(const std::string& body);
-computed_data parse_xml_file(const std::string& body);
+// Parsers take views so callers can hand over bytes they do not own, such as
+// records still sitting in a shared-memory ring.
+computed_data process_json_request(std::string_view body);
+computed_data parse_text_file(std::string_view body);
+computed_data parse_xml_file(std::string_view body);
 boost::json::object merge_json_objects(const std::vector<boost::json::value>& json_array);
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "watcher.hpp"
+
+#include <boost/asio/as_tuple.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <system_error>
+#include <utility>
+
+#include "../log/logger.hpp"
+
+file_watcher::file_watcher(asio::io_context& ioc,
+    std::filesystem::path path,
+    std::string what,
+    reload_fn reload)
+    : timer_(ioc), path_(std::move(path)), what_(std::move(what)), reload_(std::move(reload)) {}
+
+bool file_watcher::start() {
+  if (!load()) return false;
+  asio::co_spawn(timer_.get_executor(), run(), asio::detached);
+  return true;
+}
+
+bool file_watcher::load() {
+  std::error_code ec;
+  auto const modified = std::filesystem::last_write_time(path_, ec);
+  if (ec) {
+    LOG_ERROR("Cannot read {} file {}: {}", what_, path_.string(), ec.message());
+    return false;
+  }
+  loaded_time_ = modified;
+  return reload_(path_);
+}
+
+asio::awaitable<void> file_watcher::run() {
+  while (true) {
+    timer_.expires_after(poll_interval);
+    auto const [ec] = co_await timer_.async_wait(asio::as_tuple(asio::use_awaitable));
+    if (ec) co_return;
+
+    std::error_code stat_ec;
+    auto const modified = std::filesystem::last_write_time(path_, stat_ec);
+    if (stat_ec || modified == loaded_time_) continue;
+    // A rejected file is not retried until it changes again.
+    if (!load()) LOG_WARN("Keeping the previous {}; {} did not load", what_, path_.string());
+  }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <string>
+
+namespace asio = boost::asio;
+
+// Loads a configuration file and loads it again whenever its modification
+// time changes, polling from the io_context. `reload` parses the file and
+// applies it, returning false if it was rejected; the previous contents then
+// stay in effect, and the file is not retried until it changes again.
+class file_watcher {
+ public:
+  using reload_fn = std::function<bool(std::filesystem::path const&)>;
+
+  // `what` names the file in log messages, such as "ring" or "limits".
+  file_watcher(asio::io_context& ioc,
+      std::filesystem::path path,
+      std::string what,
+      reload_fn reload);
+  file_watcher(const file_watcher&) = delete;
+  file_watcher& operator=(const file_watcher&) = delete;
+
+  // Loads the file, then starts polling. Returns false if the file cannot be
+  // loaded, and does not poll then.
+  bool start();
+
+ private:
+  static constexpr auto poll_interval = std::chrono::seconds(2);
+
+  asio::awaitable<void> run();
+  bool load();
+
+  asio::steady_timer timer_;
+  std::filesystem::path path_;
+  std::string what_;
+  reload_fn reload_;
+  std::filesystem::file_time_type loaded_time_{};
+};
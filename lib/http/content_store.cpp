@@ -0,0 +1,163 @@
+#include "content_store.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+
+#include "../metrics/registry.hpp"
+
+namespace fs = std::filesystem;
+
+namespace content_store {
+
+namespace {
+
+fs::path const storage_root = "./storage";
+
+struct cache_key {
+  codec::digest digest;
+  format kind;
+
+  bool operator==(cache_key const&) const = default;
+};
+
+struct cache_key_hash {
+  std::size_t operator()(cache_key const& key) const {
+    return codec::digest_hash{}(key.digest) ^ static_cast<std::size_t>(key.kind);
+  }
+};
+
+struct cache_entry {
+  cache_key key;
+  analysis result;
+  std::size_t footprint;
+};
+
+using lru_list = std::list<cache_entry>;  // Most recently used first
+
+std::mutex cache_mutex;
+std::size_t capacity = std::size_t{64} << 20;
+std::size_t cached_bytes = 0;
+lru_list entries;
+std::unordered_map<cache_key, lru_list::iterator, cache_key_hash> index;
+
+// Rough bytes an analysis holds: the text of its levels and messages plus a
+// fixed overhead for each, as for stored results.
+constexpr std::size_t entry_overhead = 64;
+
+std::size_t footprint(computed_data const& data) {
+  std::size_t bytes = sizeof(computed_data) + data.error_message.size() + entry_overhead;
+  for (auto const& [level, messages] : data.message_stats) {
+    bytes += level.size() + entry_overhead;
+    auto const* inner = messages.if_object();
+    if (!inner) continue;
+    for (auto const& [message, count] : *inner) bytes += message.size() + entry_overhead;
+  }
+  return bytes;
+}
+
+void evict() {
+  while (cached_bytes > capacity && !entries.empty()) {
+    cached_bytes -= entries.back().footprint;
+    index.erase(entries.back().key);
+    entries.pop_back();
+  }
+}
+
+std::atomic<std::uint64_t> temporary_files{0};
+
+// Writes the object under a temporary name first, so a reader never sees it
+// half written, and two uploads of the same content racing to write it both
+// leave it whole.
+void write_object(fs::path const& object, std::string_view content) {
+  std::error_code ec;
+  fs::create_directories(object.parent_path(), ec);
+  auto temporary = object;
+  temporary += std::format(".{}-{}.tmp",
+      std::hash<std::thread::id>{}(std::this_thread::get_id()),
+      temporary_files.fetch_add(1, std::memory_order_relaxed));
+  {
+    std::ofstream file(temporary, std::ios::binary);
+    if (!file) throw std::runtime_error("[ERROR] Failed to open file: " + temporary.string());
+    file.write(content.data(), static_cast<std::streamsize>(content.size()));
+    if (!file) throw std::runtime_error("[ERROR] Failed to write file: " + temporary.string());
+  }
+  fs::rename(temporary, object, ec);
+  if (ec) {
+    fs::remove(temporary, ec);
+    throw std::runtime_error("[ERROR] Failed to store file: " + object.string());
+  }
+}
+
+}  // namespace
+
+stored store(std::string_view content,
+    codec::digest const& digest,
+    std::string const& client_id,
+    std::string_view ext) {
+  auto const hex = digest.hex();
+  fs::path const client_dir = storage_root / ("Client#" + client_id);
+  auto reference = client_dir / hex;
+  reference += ext;
+  std::error_code ec;
+  if (fs::exists(reference, ec)) {
+    metrics::add(metrics::counter::parts_deduplicated);
+    return stored::referenced;
+  }
+
+  auto const object = storage_root / "objects" / hex.substr(0, 2) / hex;
+  bool const existed = fs::exists(object, ec);
+  if (!existed) write_object(object, content);
+
+  fs::create_directories(client_dir, ec);
+  fs::create_hard_link(object, reference, ec);
+  if (ec && ec != std::errc::file_exists) {
+    // Some filesystems have no hard links; the client gets its own copy.
+    fs::copy_file(object, reference, fs::copy_options::skip_existing, ec);
+    if (ec) throw std::runtime_error("[ERROR] Failed to store file: " + reference.string());
+  }
+  if (!existed) return stored::written;
+  metrics::add(metrics::counter::parts_deduplicated);
+  return stored::linked;
+}
+
+void set_cache_capacity(std::size_t bytes) {
+  std::scoped_lock lock(cache_mutex);
+  capacity = bytes;
+  evict();
+}
+
+analysis cached(codec::digest const& digest, format kind) {
+  std::scoped_lock lock(cache_mutex);
+  auto const it = index.find({digest, kind});
+  if (it == index.end()) return nullptr;
+  entries.splice(entries.begin(), entries, it->second);
+  metrics::add(metrics::counter::analysis_cache_hits);
+  return it->second->result;
+}
+
+void remember(codec::digest const& digest, format kind, analysis const& result) {
+  auto const bytes = footprint(*result);  // Outside the lock: it walks every message
+  std::scoped_lock lock(cache_mutex);
+  if (bytes > capacity) return;
+  cache_key const key{digest, kind};
+  if (auto const it = index.find(key); it != index.end()) {
+    // Parsed twice by uploads that raced; either result will do.
+    entries.splice(entries.begin(), entries, it->second);
+    return;
+  }
+  entries.push_front({key, result, bytes});
+  index.emplace(key, entries.begin());
+  cached_bytes += bytes;
+  evict();
+}
+
+}  // namespace content_store
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "../codec/digest.hpp"
+#include "../file/handler.hpp"
+
+// Uploads by content. Agents retry, and services upload the same rotated
+// files, so identical parts are common: their bytes are written to disk once
+// per digest and parsed once while their analysis stays cached.
+namespace content_store {
+
+enum class stored {
+  referenced,  // The client already had this content; nothing was written
+  linked,      // Another client's copy was linked for this one
+  written,     // New content
+};
+
+// Makes `content` one of the client's stored uploads. The bytes go to
+// storage/objects/<first two hex digits>/<digest> once; each client that
+// sent them gets a hard link at storage/Client#<id>/<digest><ext>, or a copy
+// where links are not supported. Throws std::runtime_error if the content
+// cannot be written.
+stored store(std::string_view content,
+    codec::digest const& digest,
+    std::string const& client_id,
+    std::string_view ext);
+
+// The same bytes parse differently as JSON and as text.
+enum class format { json, xml, text };
+
+using analysis = std::shared_ptr<computed_data const>;
+
+// Approximate bytes of analyses kept in the cache, least recently used dropped
+// first; 0 turns it off. An analysis larger than the whole cache is not kept.
+void set_cache_capacity(std::size_t bytes);
+
+// The cached analysis of the content, or null.
+analysis cached(codec::digest const& digest, format kind);
+void remember(codec::digest const& digest, format kind, analysis const& result);
+
+// The cached analysis, or `parse()`'s, which is cached for next time. Parse
+// errors are cached too: the same bytes fail the same way.
+template <class Parse>
+analysis analyze(codec::digest const& digest, format kind, Parse&& parse) {
+  if (auto hit = cached(digest, kind)) return hit;
+  auto result = std::make_shared<computed_data const>(std::forward<Parse>(parse)());
+  remember(digest, kind, result);
+  return result;
+}
+
+}  // namespace content_store
@@ -7,19 +7,34 @@
 #include <boost/json.hpp>
 #include <cstddef>
 #include <filesystem>
-#include <fstream>
-#include <iomanip>
 #include <map>
-#include <print>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "../cluster/coordinator.hpp"
+#include "../cluster/upstream.hpp"
+#include "../cluster/wire.hpp"
+#include "../codec/digest.hpp"
+#include "../codec/gzip.hpp"
 #include "../file/handler.hpp"
+#include "../log/logger.hpp"
+#include "../metrics/stage_timer.hpp"
+#include "../metrics/trace.hpp"
+#include "../network/client_address.hpp"
 #include "../utils/utils.hpp"
+#include "content_store.hpp"
+#include "inflating_body.hpp"
+#include "multipart_digests.hpp"
 #include "response_handler.hpp"
+#include "results.hpp"
+#include "static_files.hpp"
+#include "tails.hpp"
 
 namespace beast = boost::beast;
 namespace http = beast::http;
@@ -33,11 +48,28 @@ struct ClientResponseData {
   std::string analysis_type;
   size_t invalid_fields;
   boost::json::object message_stats;
+  std::string next_cursor;  // Set when the stats were cut to a first page
 };
 
-inline std::string sanitize_ip(std::string ip) {
-  std::replace(ip.begin(), ip.end(), '.', '_');
-  return ip;
+// Splits a request target into its path and query string.
+inline std::pair<std::string_view, std::string_view> split_target(std::string_view target) {
+  auto const question = target.find('?');
+  if (question == std::string_view::npos) return {target, {}};
+  return {target.substr(0, question), target.substr(question + 1)};
+}
+
+// Applies top, min_count and limit to the merged stats before they are
+// serialized, keeping any further pages for GET /results.
+inline void narrow_stats(results::query const& query, ClientResponseData& data) {
+  if (!query.narrows()) return;
+  stage_timer select_timer(request_stage::select);
+  data.next_cursor = results::apply(query,
+      data.message_stats,
+      {data.total_number_of_fields,
+          data.invalid_fields,
+          data.client_ip,
+          data.client_port,
+          data.analysis_type});
 }
 
 inline bool is_valid_content_type(const std::string& content_type) {
@@ -45,83 +77,36 @@ inline bool is_valid_content_type(const std::string& content_type) {
   return std::find(valid_types.begin(), valid_types.end(), content_type) != valid_types.end();
 }
 
-inline std::string get_timestamp_str() {
-  auto now = std::chrono::system_clock::now();
-  auto itt = std::chrono::system_clock::to_time_t(now);
-  std::stringstream ss;
-  ss << std::put_time(std::localtime(&itt),
-      "%Y-%m-%d_%H:%M:%S");  // Local time with normal date format
-  return ss.str();
-}
-
-inline std::map<std::string, std::string> save_file(const std::string& content,
-    const std::string& client_id,
-    const std::string& ip,
-    const std::string& ext) {
-  std::string directory = "./storage/Client#" + client_id + "/";
-  fs::path dir = directory;
-  std::string construct_file_name = get_timestamp_str() + "_" + sanitize_ip(ip) + ext;
-  fs::path file_name = construct_file_name;
-  fs::path file_path = dir / file_name;
-
-  if (!fs::exists(dir)) {
-    if (!fs::create_directories(dir)) throw std::runtime_error("Failed to create directory");
-  }
-
-  std::fstream file;
-  file.open(file_path, std::ios::out);
-
-  if (!file.is_open()) {
-    throw std::runtime_error("[ERROR] Failed to open file: " + file_path.string());
+// The digest the body reader computed while the body arrived, or one computed
+// now for bodies that were not read by it.
+template <class Body, class Fields>
+codec::digest body_digest(http::request<Body, Fields> const& req, std::string_view data) {
+  if constexpr (std::is_same_v<Body, inflating_body>) {
+    if (req.body().hashed()) return req.body().hasher.value();
   }
-
-  file << content;
-  file.close();
-  return std::map<std::string, std::string>{{"status", "success"},
-      {"file_name", file_name.string()}};
+  return codec::hash(data);
 }
 
-inline std::string_view mime_type(std::string_view path) {
-  using beast::iequals;
-  auto const pos = path.rfind('.');
-  if (pos == std::string_view::npos) return "application/text";
-  auto extension = path.substr(pos);
-
-  static constexpr std::array mime_map = {
-      std::pair{".htm", "text/html"},
-      std::pair{".html", "text/html"},
-      std::pair{".php", "text/html"},
-      std::pair{".css", "text/css"},
-      std::pair{".txt", "text/plain"},
-      std::pair{".js", "application/javascript"},
-      std::pair{".json", "application/json"},
-      std::pair{".xml", "application/xml"},
-      std::pair{".swf", "application/x-shockwave-flash"},
-      std::pair{".flv", "video/x-flv"},
-      std::pair{".png", "image/png"},
-      std::pair{".jpe", "image/jpeg"},
-      std::pair{".jpeg", "image/jpeg"},
-      std::pair{".jpg", "image/jpeg"},
-      std::pair{".gif", "image/gif"},
-      std::pair{".bmp", "image/bmp"},
-      std::pair{".ico", "image/vnd.microsoft.icon"},
-      std::pair{".tiff", "image/tiff"},
-      std::pair{".tif", "image/tiff"},
-      std::pair{".svg", "image/svg+xml"},
-      std::pair{".svgz", "image/svg+xml"},
-  };
-
-  for (auto const& [ext, mime] : mime_map) {
-    if (iequals(ext, extension)) return mime;
+// The same for the multipart part whose content starts at `offset` in the
+// body: the reader hashes each part while it arrives.
+template <class Body, class Fields>
+codec::digest part_digest(http::request<Body, Fields> const& req,
+    std::size_t offset,
+    std::string_view data) {
+  if constexpr (std::is_same_v<Body, inflating_body>) {
+    if (auto const digest = req.body().part_digest(offset, data.size())) return *digest;
   }
-  return "application/text";
+  return codec::hash(data);
 }
 
 template <class Body, class Allocator>
 http::message_generator handle_request(beast::string_view doc_root,
     http::request<Body, http::basic_fields<Allocator>>&& req,
-    tcp::endpoint client_endpoint) {
-  beast::error_code ec;
+    client_address const& client,
+    stage_span const& read = {},
+    static_files::file_transfer* zero_copy = nullptr) {
+  metrics::count_request(metrics::classify_content_type(req[http::field::content_type]));
+
   // Make sure we can handle the method
   if (req.method() != http::verb::get && req.method() != http::verb::post &&
       req.method() != http::verb::head)
@@ -132,10 +117,24 @@ http::message_generator handle_request(beast::string_view doc_root,
       req.target().find("..") != beast::string_view::npos)
     return ResponseHandler::bad_request(req, "Illegal request-target");
 
+  auto const [target_path, target_query] =
+      split_target(std::string_view(req.target().data(), req.target().size()));
+  bool const upload = target_path == "/" && req.method() == http::verb::post;
+
+  // This request's own stage timings: every response built from here on
+  // carries them in Server-Timing. Sampled uploads also keep their spans for
+  // the trace file.
+  stage_timings timings;
+  std::vector<stage_span> spans;
+  if (upload && trace::should_sample()) timings.spans = &spans;
+  timings.record(read);
+  scoped_stage_sink timing_scope(timings);
+
   // Handle POST request first
-  if (req.target() == "/" && req.method() == http::verb::post) {
-    std::string client_ip_address(client_endpoint.address().to_string());
-    unsigned short client_port(client_endpoint.port());
+  if (upload) {
+    auto const query = results::parse_query(target_query);
+    if (!query) return ResponseHandler::bad_request(req, "Invalid query parameters");
+    std::string const& client_ip_address = client.ip;
     size_t total_number_of_fields = 0, invalid_fields = 0;
     ClientResponseData response_data;
     response_data.analysis_type = "LOG LEVEL";
@@ -143,9 +142,46 @@ http::message_generator handle_request(beast::string_view doc_root,
     std::string client_id(req["Client-Id"]);
     std::map<std::string, int, std::less<std::string>> message_frequencies;
 
+    // Stores one upload under the client's id and analyzes it with `parse`, or
+    // takes the cached analysis of the same bytes, then adds it to the response.
+    // Set when the request ends here instead.
+    auto const analyze_upload = [&](std::string_view data,
+                                    auto&& digest_of,
+                                    std::string_view ext,
+                                    content_store::format kind,
+                                    request_stage stage,
+                                    computed_data (*parse)(std::string_view))
+        -> std::optional<http::message_generator> {
+      stage_timer save_timer(request_stage::save);
+      auto const digest = digest_of();
+      try {
+        content_store::store(data, digest, client_id, ext);
+      } catch (const std::exception& e) {
+        LOG_ERROR("Saving file: {}", e.what());
+        return ResponseHandler::server_error(req, e.what());
+      }
+      save_timer.stop();
+      stage_timer parse_timer(stage);
+      auto const parsed = content_store::analyze(digest, kind, [&] { return parse(data); });
+      parse_timer.stop();
+      if (parsed->error_message != "success") {
+        return ResponseHandler::bad_request(req, parsed->error_message);
+      }
+      total_number_of_fields += parsed->total_fields;
+      invalid_fields += parsed->invalid_fields;
+      json_objects.push_back(parsed->message_stats);
+      return std::nullopt;
+    };
+
     if (req.find(http::field::content_type) == req.end()) {
       return ResponseHandler::bad_request(req, "Missing Content-Type header");
     }
+    // The session inflates gzip and deflate bodies and drops their header, so
+    // any coding still named here was not decoded.
+    if (codec::parse_content_coding(req[http::field::content_encoding]) !=
+        codec::content_coding::identity) {
+      return ResponseHandler::unsupported_encoding(req);
+    }
     if (req.body().size() == 0) {
       return ResponseHandler::bad_request(req, "Empty request body");
     }
@@ -153,17 +189,16 @@ http::message_generator handle_request(beast::string_view doc_root,
     std::string content_type = req[http::field::content_type];
     if (content_type.find("multipart/form-data") != std::string::npos) {
       // Parse boundary
-      std::string boundary;
-      std::string boundary_prefix = "boundary=";
-      auto pos = content_type.find(boundary_prefix);
-      if (pos != std::string::npos) {
-        boundary = "--" + content_type.substr(pos + boundary_prefix.size());
-      } else {
+      std::string const boundary = multipart_delimiter(content_type);
+      if (boundary.empty()) {
         return ResponseHandler::bad_request(req, "Missing boundary in multipart/form-data");
       }
+      stage_timer copy_timer(request_stage::split);
       std::string body = beast::buffers_to_string(req.body().data());
+      copy_timer.stop();
       size_t start = 0;
       while ((start = body.find(boundary, start)) != std::string::npos) {
+        stage_timer split_timer(request_stage::split);
         size_t part_start = start + boundary.size();
         if (body.substr(part_start, 2) == "--") break;  // End of multipart
         part_start += 2;                                // skip \r\n
@@ -200,66 +235,53 @@ http::message_generator handle_request(beast::string_view doc_root,
             }
           }
         }
+        split_timer.stop();
+
         // Save and process each part
         if (part_content_type == "application/json") {
-          std::println("[INFO] Receiving and parsing JSON file: {}", filename);
-          try {
-            auto response = save_file(part_data, client_id, client_ip_address, ".json");
-          } catch (const std::exception& e) {
-            std::println(stderr, "[ERROR] Saving file: {}", e.what());
-            return ResponseHandler::server_error(req, e.what());
-          }
-          const computed_data& parsedJson = process_json_request(part_data);
-          if (parsedJson.error_message != "success") {
-            return ResponseHandler::bad_request(req, parsedJson.error_message);
-          } else {
-            total_number_of_fields += parsedJson.total_fields;
-            invalid_fields += parsedJson.invalid_fields;
-            json_objects.push_back(parsedJson.message_stats);
-          }
+          LOG_DEBUG("Receiving and parsing JSON file: {}", filename);
+          auto res = analyze_upload(part_data,
+              [&] { return part_digest(req, data_start, part_data); },
+              ".json",
+              content_store::format::json,
+              request_stage::parse_json,
+              process_json_request);
+          if (res) return std::move(*res);
         } else if (part_content_type == "application/xml") {
-          std::println("[INFO] Receiving and parsing XML file: {}", filename);
-          try {
-            auto response = save_file(part_data, client_id, client_ip_address, ".xml");
-          } catch (const std::exception& e) {
-            std::println(stderr, "[ERROR] Saving file: {}", e.what());
-            return ResponseHandler::server_error(req, e.what());
-          }
-          const computed_data& parsedXml = parse_xml_file(part_data);
-          if (parsedXml.error_message != "success") {
-            return ResponseHandler::bad_request(req, parsedXml.error_message);
-          } else {
-            total_number_of_fields += parsedXml.total_fields;
-            invalid_fields += parsedXml.invalid_fields;
-            json_objects.push_back(parsedXml.message_stats);
-          }
+          LOG_DEBUG("Receiving and parsing XML file: {}", filename);
+          auto res = analyze_upload(part_data,
+              [&] { return part_digest(req, data_start, part_data); },
+              ".xml",
+              content_store::format::xml,
+              request_stage::parse_xml,
+              parse_xml_file);
+          if (res) return std::move(*res);
         } else if (part_content_type == "text/plain") {
-          std::println("[INFO] Receiving and parsing text file: {}", filename);
-          try {
-            auto response = save_file(part_data, client_id, client_ip_address, ".txt");
-          } catch (const std::exception& e) {
-            std::println(stderr, "[ERROR] Saving file: {}", e.what());
-            return ResponseHandler::server_error(req, e.what());
-          }
-          const computed_data& parsedText = parse_text_file(part_data);
-          if (parsedText.error_message != "success") {
-            return ResponseHandler::bad_request(req, parsedText.error_message);
-          } else {
-            total_number_of_fields += parsedText.total_fields;
-            invalid_fields += parsedText.invalid_fields;
-            json_objects.push_back(parsedText.message_stats);
-          }
+          LOG_DEBUG("Receiving and parsing text file: {}", filename);
+          auto res = analyze_upload(part_data,
+              [&] { return part_digest(req, data_start, part_data); },
+              ".txt",
+              content_store::format::text,
+              request_stage::parse_text,
+              parse_text_file);
+          if (res) return std::move(*res);
         }
         start = data_end;
       }
-      std::println("[INFO] Making analysis and preparing a response...");
+      LOG_DEBUG("Making analysis and preparing a response...");
       response_data.client_ip = client_ip_address;
-      response_data.client_port = std::to_string(client_port);
+      response_data.client_port = client.port;
+      stage_timer merge_timer(request_stage::merge);
       response_data.message_stats = merge_json_objects(json_objects);
+      merge_timer.stop();
       response_data.total_number_of_fields = total_number_of_fields;
       response_data.invalid_fields = invalid_fields;
-      std::println("[INFO] Response sent to client. ID: {}", client_id);
-      return ResponseHandler::response(req, response_data);
+      cluster::record(response_data.message_stats, total_number_of_fields, invalid_fields);
+      narrow_stats(*query, response_data);
+      LOG_INFO("Response sent to client. ID: {}", client_id);
+      auto res = ResponseHandler::response(req, response_data);
+      if (timings.spans) trace::write("POST /", client_id, spans);
+      return res;
     }
 
     if (!is_valid_content_type(content_type)) {
@@ -267,126 +289,252 @@ http::message_generator handle_request(beast::string_view doc_root,
     }
 
     if (content_type == "application/json") {
-      std::println("[INFO] Receiving and Parsing Json data");
+      LOG_DEBUG("Receiving and Parsing Json data");
 
       if (!req.count("Client-Id"))
         return ResponseHandler::bad_request(req, "Missing Client-Id header");
 
+      stage_timer copy_timer(request_stage::split);
       std::string data = beast::buffers_to_string(req.body().data());
-
-      try {
-        auto response = save_file(data, client_id, client_ip_address, ".json");
-      } catch (const std::exception& e) {
-        std::println(stderr, "[ERROR] Saving file: {}", e.what());
-        return ResponseHandler::server_error(req, e.what());
-      }
-      const computed_data& parsedJson = process_json_request(data);
-
-      if (parsedJson.error_message != "success") {
-        return ResponseHandler::bad_request(req, parsedJson.error_message);
-      } else {
-        total_number_of_fields += parsedJson.total_fields;
-        invalid_fields += parsedJson.invalid_fields;
-        json_objects.push_back(parsedJson.message_stats);
-      }
+      copy_timer.stop();
+
+      auto res = analyze_upload(data,
+          [&] { return body_digest(req, data); },
+          ".json",
+          content_store::format::json,
+          request_stage::parse_json,
+          process_json_request);
+      if (res) return std::move(*res);
     }
 
     if (content_type == "text/plain") {
-      std::println("[INFO] Receiving Text data");
+      LOG_DEBUG("Receiving Text data");
 
       if (!req.count("Client-Id"))
         return ResponseHandler::bad_request(req, "Missing Client-Id header");
 
+      stage_timer copy_timer(request_stage::split);
       std::string data = beast::buffers_to_string(req.body().data());
-
-      try {
-        auto response = save_file(data, client_id, client_ip_address, ".txt");
-      } catch (const std::exception& e) {
-        std::println(stderr, "[ERROR] Saving file: {}", e.what());
-        return ResponseHandler::server_error(req, e.what());
-      }
-      const computed_data& parsedText = parse_text_file(data);
-
-      if (parsedText.error_message != "success") {
-        return ResponseHandler::bad_request(req, parsedText.error_message);
-      } else {
-        total_number_of_fields += parsedText.total_fields;
-        invalid_fields += parsedText.invalid_fields;
-        json_objects.push_back(parsedText.message_stats);
-      }
+      copy_timer.stop();
+
+      auto res = analyze_upload(data,
+          [&] { return body_digest(req, data); },
+          ".txt",
+          content_store::format::text,
+          request_stage::parse_text,
+          parse_text_file);
+      if (res) return std::move(*res);
     }
 
     if (content_type == "application/xml") {
-      std::println("[INFO] Receiving XML data");
+      LOG_DEBUG("Receiving XML data");
 
       if (!req.count("Client-Id"))
         return ResponseHandler::bad_request(req, "Missing Client-Id header");
 
+      stage_timer copy_timer(request_stage::split);
       std::string data = beast::buffers_to_string(req.body().data());
-
-      try {
-        auto response = save_file(data, client_id, client_ip_address, ".xml");
-      } catch (const std::exception& e) {
-        std::println(stderr, "[ERROR] Saving file: {}", e.what());
-        return ResponseHandler::server_error(req, e.what());
-      }
-      const computed_data& parsedXml = parse_xml_file(data);
-
-      if (parsedXml.error_message != "success") {
-        return ResponseHandler::bad_request(req, parsedXml.error_message);
-      } else {
-        total_number_of_fields += parsedXml.total_fields;
-        invalid_fields += parsedXml.invalid_fields;
-        json_objects.push_back(parsedXml.message_stats);
-      }
+      copy_timer.stop();
+
+      auto res = analyze_upload(data,
+          [&] { return body_digest(req, data); },
+          ".xml",
+          content_store::format::xml,
+          request_stage::parse_xml,
+          parse_xml_file);
+      if (res) return std::move(*res);
     }
-    std::println("[INFO] Making analysis and preparing a response...");
+    LOG_DEBUG("Making analysis and preparing a response...");
     response_data.client_ip = client_ip_address;
-    response_data.client_port = std::to_string(client_port);
+    response_data.client_port = client.port;
+    stage_timer merge_timer(request_stage::merge);
     response_data.message_stats = merge_json_objects(json_objects);
+    merge_timer.stop();
     response_data.total_number_of_fields = total_number_of_fields;
     response_data.invalid_fields = invalid_fields;
-    std::println("[INFO] Response sent to client. ID: {}", client_id);
+    cluster::record(response_data.message_stats, total_number_of_fields, invalid_fields);
+    narrow_stats(*query, response_data);
+    LOG_INFO("Response sent to client. ID: {}", client_id);
+    auto res = ResponseHandler::response(req, response_data);
+    if (timings.spans) trace::write("POST /", client_id, spans);
+    return res;
+  }
+
+  // Counts the client aggregated itself (client --summarize)
+  if (target_path == "/summary" && req.method() == http::verb::post) {
+    auto const query = results::parse_query(target_query);
+    if (!query) return ResponseHandler::bad_request(req, "Invalid query parameters");
+    if (!req.count("Client-Id")) {
+      return ResponseHandler::bad_request(req, "Missing Client-Id header");
+    }
+    if (codec::parse_content_coding(req[http::field::content_encoding]) !=
+        codec::content_coding::identity) {
+      return ResponseHandler::unsupported_encoding(req);
+    }
+    std::string_view const content_type = req[http::field::content_type];
+    if (content_type != cluster::wire::content_type) {
+      return ResponseHandler::bad_request(req, "Invalid Content-Type header");
+    }
+    std::string const body = beast::buffers_to_string(req.body().data());
+    auto const summary = cluster::wire::view::parse(body);
+    if (!summary) return ResponseHandler::bad_request(req, "Invalid summary");
+
+    cluster::partial aggregate;
+    aggregate.merge(*summary);
+    cluster::record(*summary);
+    ClientResponseData response_data;
+    response_data.total_number_of_fields = aggregate.total_entries;
+    response_data.invalid_fields = aggregate.invalid_data;
+    response_data.client_ip = client.ip;
+    response_data.client_port = client.port;
+    response_data.analysis_type = "LOG LEVEL";
+    response_data.message_stats = aggregate.message_stats();
+    narrow_stats(*query, response_data);
+    LOG_INFO("Summary received from client. ID: {}", std::string_view(req["Client-Id"]));
     return ResponseHandler::response(req, response_data);
   }
 
-  // Build the path to the requested file
-  std::string path = path_cat(doc_root, req.target());
-  if (req.target().back() == '/') {
-    path.append("index.html");
+  // Raw log files kept for archival next to a summary; they are not parsed
+  if (target_path == "/archive" && req.method() == http::verb::post) {
+    if (!req.count("Client-Id")) {
+      return ResponseHandler::bad_request(req, "Missing Client-Id header");
+    }
+    if (codec::parse_content_coding(req[http::field::content_encoding]) !=
+        codec::content_coding::identity) {
+      return ResponseHandler::unsupported_encoding(req);
+    }
+    std::string const content_type = req[http::field::content_type];
+    if (!is_valid_content_type(content_type)) {
+      return ResponseHandler::bad_request(req, "Invalid Content-Type header");
+    }
+    std::string extension = ".txt";
+    if (content_type == "application/json") extension = ".json";
+    if (content_type == "application/xml") extension = ".xml";
+    try {
+      stage_timer save_timer(request_stage::save);
+      std::string const data = beast::buffers_to_string(req.body().data());
+      content_store::store(data, body_digest(req, data), std::string(req["Client-Id"]), extension);
+    } catch (const std::exception& e) {
+      LOG_ERROR("Saving file: {}", e.what());
+      return ResponseHandler::server_error(req, e.what());
+    }
+    return ResponseHandler::json_status(req, http::status::created, "archived");
+  }
+
+  // New lines of a followed text log (client --follow), folded into the
+  // client's running aggregate
+  if (target_path == "/tail" && req.method() == http::verb::post) {
+    if (!req.count("Client-Id")) {
+      return ResponseHandler::bad_request(req, "Missing Client-Id header");
+    }
+    if (codec::parse_content_coding(req[http::field::content_encoding]) !=
+        codec::content_coding::identity) {
+      return ResponseHandler::unsupported_encoding(req);
+    }
+    if (req[http::field::content_type] != "text/plain") {
+      return ResponseHandler::bad_request(req, "Invalid Content-Type header");
+    }
+    stage_timer parse_timer(request_stage::parse_text);
+    auto const outcome = tails::fold(req["Client-Id"],
+        req["Tail-File"],
+        req["Tail-Inode"],
+        req["Tail-Offset"],
+        beast::buffers_to_string(req.body().data()));
+    parse_timer.stop();
+    if (outcome.result == tails::fold_result::invalid) {
+      return ResponseHandler::bad_request(req, "Invalid tail batch");
+    }
+    return ResponseHandler::json_status(req,
+        http::status::ok,
+        outcome.result == tails::fold_result::applied ? "applied" : "duplicate",
+        {{"total_entries", outcome.total_entries}, {"invalid_data", outcome.invalid_data}});
   }
 
-  // Attempt to open the file
-  http::file_body::value_type body;
-  body.open(path.c_str(), beast::file_mode::scan, ec);
+  // The running aggregate of a client's followed logs
+  if (target_path == "/tail" && req.method() == http::verb::get) {
+    auto const query = results::parse_query(target_query);
+    if (!query) return ResponseHandler::bad_request(req, "Invalid query parameters");
+    auto const running = tails::snapshot(req["Client-Id"]);
+    if (!running) return ResponseHandler::not_found(req, req.target());
+    ClientResponseData response_data;
+    response_data.total_number_of_fields = running->total_entries;
+    response_data.invalid_fields = running->invalid_data;
+    response_data.client_ip = client.ip;
+    response_data.client_port = client.port;
+    response_data.analysis_type = "LOG LEVEL";
+    response_data.message_stats = running->message_stats();
+    narrow_stats(*query, response_data);
+    return ResponseHandler::response(req, response_data);
+  }
 
-  // Handle the case where the file doesn't exist
-  if (ec == beast::errc::no_such_file_or_directory)
-    return ResponseHandler::not_found(req, req.target());
+  // Partial aggregates pushed by leaf servers to this coordinator
+  if (target_path == "/cluster/push" && req.method() == http::verb::post) {
+    if (!cluster::coordinator_enabled()) return ResponseHandler::not_found(req, req.target());
+    auto const result = cluster::apply_push(req["Node-Id"],
+        req["Push-Epoch"],
+        req["Push-Seq"],
+        beast::buffers_to_string(req.body().data()));
+    if (result == cluster::push_result::invalid) {
+      return ResponseHandler::bad_request(req, "Invalid partial aggregate");
+    }
+    return ResponseHandler::json_status(req,
+        http::status::ok,
+        result == cluster::push_result::applied ? "applied" : "duplicate");
+  }
 
-  // Handle an unknown error
-  if (ec) return ResponseHandler::server_error(req, ec.message());
+  // The merged view of every node that has pushed to this coordinator
+  if (target_path == "/cluster/stats" && req.method() == http::verb::get) {
+    if (!cluster::coordinator_enabled()) return ResponseHandler::not_found(req, req.target());
+    auto const query = results::parse_query(target_query);
+    if (!query) return ResponseHandler::bad_request(req, "Invalid query parameters");
+    auto view = cluster::snapshot();
+    ClientResponseData response_data;
+    response_data.total_number_of_fields = view.total_entries;
+    response_data.invalid_fields = view.invalid_data;
+    response_data.client_ip = client.ip;
+    response_data.client_port = client.port;
+    response_data.analysis_type = "LOG LEVEL";
+    response_data.message_stats = view.message_stats();
+    narrow_stats(*query, response_data);
+    return ResponseHandler::response(req, response_data);
+  }
 
-  // Cache the size since we need it after the move
-  auto const size = body.size();
+  // Push this node's partial aggregate now instead of at the next interval
+  if (target_path == "/cluster/flush" && req.method() == http::verb::post) {
+    if (!cluster::push_now()) return ResponseHandler::not_found(req, req.target());
+    return ResponseHandler::json_status(req, http::status::accepted, "pushing");
+  }
 
-  // Respond to HEAD request
-  if (req.method() == http::verb::head) {
-    http::response<http::empty_body> res{http::status::ok, req.version()};
-    res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
-    res.set(http::field::content_type, mime_type(path));
-    res.content_length(size);
-    res.keep_alive(req.keep_alive());
-    return res;
+  // Further pages of a result cut short by `limit`
+  if (target_path == "/results" && req.method() == http::verb::get) {
+    auto const query = results::parse_query(target_query);
+    if (!query || query->cursor.empty()) {
+      return ResponseHandler::bad_request(req, "Missing or invalid cursor");
+    }
+    auto page = results::fetch(query->cursor, query->limit);
+    if (!page) return ResponseHandler::not_found(req, req.target());
+    ClientResponseData response_data;
+    response_data.total_number_of_fields = page->header.total_entries;
+    response_data.invalid_fields = page->header.invalid_data;
+    response_data.client_ip = std::move(page->header.client_ip);
+    response_data.client_port = std::move(page->header.client_port);
+    response_data.analysis_type = std::move(page->header.analysis_type);
+    response_data.message_stats = std::move(page->message_stats);
+    response_data.next_cursor = std::move(page->next_cursor);
+    return ResponseHandler::response(req, response_data);
+  }
+
+  // Prometheus scrape endpoint
+  if (target_path == "/metrics" && req.method() == http::verb::get) {
+    return ResponseHandler::prometheus(req);
+  }
+
+  // Build the path to the requested file
+  std::string path = path_cat(doc_root, req.target());
+  if (req.target().back() == '/') {
+    path.append("index.html");
   }
 
-  // Respond to GET request
-  http::response<http::file_body> res{std::piecewise_construct,
-      std::make_tuple(std::move(body)),
-      std::make_tuple(http::status::ok, req.version())};
-  res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
-  res.set(http::field::content_type, mime_type(path));
-  res.content_length(size);
-  res.keep_alive(req.keep_alive());
-  return res;
+  // Small hot files come from the cache; large ones may go out via sendfile
+  return static_files::serve(req, path, zero_copy);
 }
\ No newline at end of file
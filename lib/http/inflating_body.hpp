@@ -0,0 +1,147 @@
+#pragma once
+
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/optional.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "../codec/digest.hpp"
+#include "../codec/gzip.hpp"
+#include "multipart_digests.hpp"
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+
+// Request body that undoes Content-Encoding: gzip or deflate while it is read,
+// so the compressed body is never held in memory and the handler sees plain
+// bytes. The reader drops the Content-Encoding header of bodies it decodes;
+// bodies in other codings are stored as received, header and all. The
+// decoded bytes are hashed as they are appended, while they are still in
+// cache, so the handler can look the content up without another pass. A
+// multipart/form-data body is hashed part by part instead.
+struct inflating_body {
+  struct value_type : beast::flat_buffer {
+    codec::hasher hasher;
+    std::optional<multipart_digests> parts;
+
+    // True if `hasher` saw every byte, which a body filled in some other
+    // way than by the reader does not guarantee.
+    bool hashed() const { return hasher.bytes() == size(); }
+
+    // The digest of the multipart part with this content, if the reader
+    // computed it.
+    std::optional<codec::digest> part_digest(std::size_t offset, std::size_t size) const {
+      if (!parts) return std::nullopt;
+      return parts->find(offset, size);
+    }
+  };
+
+  // Cap on the decoded size, which the parser's body limit cannot see.
+  static constexpr std::size_t inflated_limit = std::size_t{1} << 30;
+  static constexpr std::size_t inflate_chunk = 64 * 1024;
+
+  static std::uint64_t size(value_type const& body) { return body.size(); }
+
+  class reader {
+   public:
+    // The parser constructs its reader before the header arrives, so the
+    // coding is only looked at in init().
+    template <bool isRequest, class Fields>
+    reader(http::header<isRequest, Fields>& h, value_type& body)
+        : body_(body),
+          take_coding_([&h] {
+            auto const coding = codec::parse_content_coding(h[http::field::content_encoding]);
+            if (coding == codec::content_coding::gzip || coding == codec::content_coding::deflate) {
+              h.erase(http::field::content_encoding);
+            }
+            return coding;
+          }),
+          delimiter_([&h] { return multipart_delimiter(h[http::field::content_type]); }) {}
+
+    void init(boost::optional<std::uint64_t> const& length, beast::error_code& ec) {
+      ec = {};
+      body_.max_size(inflated_limit);
+      if (auto delimiter = delimiter_(); !delimiter.empty()) {
+        body_.parts.emplace(std::move(delimiter));
+      }
+      auto const coding = take_coding_();
+      if (coding == codec::content_coding::gzip || coding == codec::content_coding::deflate) {
+        inflater_.emplace(coding);
+      } else if (length && *length > inflated_limit) {
+        ec = http::error::buffer_overflow;
+      }
+    }
+
+    template <class ConstBufferSequence>
+    std::size_t put(ConstBufferSequence const& buffers, beast::error_code& ec) {
+      ec = {};
+      auto const size = boost::asio::buffer_size(buffers);
+      try {
+        if (!inflater_) {
+          auto const out = body_.prepare(size);
+          auto const copied = boost::asio::buffer_copy(out, buffers);
+          hash(static_cast<char const*>(out.data()), copied);
+          body_.commit(copied);
+          return size;
+        }
+        for (auto const buffer : beast::buffers_range_ref(buffers)) {
+          auto const* in = static_cast<char const*>(buffer.data());
+          std::size_t left = buffer.size();
+          while (!inflater_->done()) {
+            auto const out = body_.prepare(inflate_chunk);
+            auto const result =
+                inflater_->step(in, left, static_cast<char*>(out.data()), out.size());
+            hash(static_cast<char const*>(out.data()), result.produced);
+            body_.commit(result.produced);
+            in += result.consumed;
+            left -= result.consumed;
+            if (result.error) {
+              ec = beast::errc::make_error_code(beast::errc::illegal_byte_sequence);
+              return size - left;
+            }
+            // A partly filled chunk means zlib has used up this input.
+            if (left == 0 && result.produced < out.size()) break;
+            if (result.consumed == 0 && result.produced == 0) {
+              ec = beast::errc::make_error_code(beast::errc::illegal_byte_sequence);
+              return size - left;
+            }
+          }
+        }
+      } catch (std::length_error const&) {
+        ec = http::error::buffer_overflow;  // Decoded past inflated_limit
+        return 0;
+      }
+      return size;
+    }
+
+    void finish(beast::error_code& ec) {
+      ec = {};
+      if (inflater_ && !inflater_->done()) ec = http::error::partial_message;
+    }
+
+   private:
+    // Hashes bytes about to be committed to the body.
+    void hash(char const* data, std::size_t size) {
+      if (!body_.parts) {
+        body_.hasher.update(data, size);
+        return;
+      }
+      auto const* start = static_cast<char const*>(body_.data().data());
+      body_.parts->update(std::string_view(start, static_cast<std::size_t>(data - start) + size));
+    }
+
+    value_type& body_;
+    // Reads the header's coding, dropping the header if it will be decoded.
+    std::function<codec::content_coding()> take_coding_;
+    // The multipart delimiter named by the header, if any.
+    std::function<std::string()> delimiter_;
+    std::optional<codec::inflater> inflater_;
+  };
+};
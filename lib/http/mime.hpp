@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// MIME types by file extension. The table is laid out at compile time with a
+// seeded FNV-1a hash that has no collisions for these extensions, so a lookup
+// is one hash and one string compare.
+namespace mime {
+
+struct entry {
+  std::string_view extension;  // Lowercase, without the dot
+  std::string_view type;
+  bool compressible;
+};
+
+inline constexpr std::array entries{
+    entry{"htm", "text/html", true},
+    entry{"html", "text/html", true},
+    entry{"php", "text/html", true},
+    entry{"css", "text/css", true},
+    entry{"txt", "text/plain", true},
+    entry{"js", "application/javascript", true},
+    entry{"json", "application/json", true},
+    entry{"xml", "application/xml", true},
+    entry{"swf", "application/x-shockwave-flash", false},
+    entry{"flv", "video/x-flv", false},
+    entry{"png", "image/png", false},
+    entry{"jpe", "image/jpeg", false},
+    entry{"jpeg", "image/jpeg", false},
+    entry{"jpg", "image/jpeg", false},
+    entry{"gif", "image/gif", false},
+    entry{"bmp", "image/bmp", false},
+    entry{"ico", "image/vnd.microsoft.icon", false},
+    entry{"tiff", "image/tiff", false},
+    entry{"tif", "image/tiff", false},
+    entry{"svg", "image/svg+xml", true},
+    entry{"svgz", "image/svg+xml", false},
+};
+
+inline constexpr entry fallback{"", "application/text", false};
+
+inline constexpr std::size_t table_size = 64;  // Power of two
+inline constexpr std::size_t max_extension = 8;
+inline constexpr std::uint8_t empty_slot = 0xff;
+
+constexpr std::uint32_t hash(std::string_view extension, std::uint32_t seed) {
+  std::uint32_t h = seed;
+  for (char c : extension) h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+  // FNV-1a alone leaves the low bits poorly mixed for short keys.
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  return h;
+}
+
+consteval std::uint32_t find_seed() {
+  for (std::uint32_t seed = 2166136261u;; ++seed) {
+    std::array<bool, table_size> used{};
+    bool collision = false;
+    for (auto const& e : entries) {
+      auto const slot = hash(e.extension, seed) & (table_size - 1);
+      if (used[slot]) {
+        collision = true;
+        break;
+      }
+      used[slot] = true;
+    }
+    if (!collision) return seed;
+  }
+}
+
+inline constexpr std::uint32_t seed = find_seed();
+
+consteval std::array<std::uint8_t, table_size> build_table() {
+  std::array<std::uint8_t, table_size> table{};
+  table.fill(empty_slot);
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    table[hash(entries[i].extension, seed) & (table_size - 1)] = static_cast<std::uint8_t>(i);
+  }
+  return table;
+}
+
+inline constexpr auto table = build_table();
+
+// Entry for the extension of `path`, or `fallback`.
+constexpr entry const& lookup(std::string_view path) {
+  auto const dot = path.rfind('.');
+  if (dot == std::string_view::npos) return fallback;
+  auto const extension = path.substr(dot + 1);
+  if (extension.empty() || extension.size() > max_extension) return fallback;
+
+  char lowered[max_extension]{};
+  for (std::size_t i = 0; i < extension.size(); ++i) {
+    char const c = extension[i];
+    lowered[i] = c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+  }
+  std::string_view const key{lowered, extension.size()};
+
+  auto const index = table[hash(key, seed) & (table_size - 1)];
+  if (index == empty_slot || entries[index].extension != key) return fallback;
+  return entries[index];
+}
+
+static_assert(lookup("/index.HTML").type == "text/html");
+static_assert(lookup("/logo.svgz").type == "image/svg+xml");
+static_assert(lookup("/README").type == fallback.type);
+
+}  // namespace mime
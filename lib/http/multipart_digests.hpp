@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../codec/digest.hpp"
+
+// The delimiter line of a multipart/form-data body: "--" and the boundary
+// parameter of its Content-Type, or empty if it has none.
+inline std::string multipart_delimiter(std::string_view content_type) {
+  if (content_type.find("multipart/form-data") == std::string_view::npos) return {};
+  constexpr std::string_view boundary_prefix = "boundary=";
+  auto const pos = content_type.find(boundary_prefix);
+  if (pos == std::string_view::npos) return {};
+  return "--" + std::string(content_type.substr(pos + boundary_prefix.size()));
+}
+
+// Digests of the parts of a multipart/form-data body, computed while the body
+// arrives: each run of a part's content is hashed as soon as it is known not
+// to be the start of the next delimiter, while it is still in cache. Parts
+// are delimited exactly as handle_request splits them, so the handler can
+// look up a part by where it starts and how long it is.
+class multipart_digests {
+ public:
+  struct part {
+    std::size_t offset;
+    std::size_t size;
+    codec::digest digest;
+  };
+
+  explicit multipart_digests(std::string delimiter) : delimiter_(std::move(delimiter)) {}
+
+  // `body` is everything received so far; earlier calls saw a prefix of it.
+  void update(std::string_view body) {
+    auto const npos = std::string_view::npos;
+    auto const width = delimiter_.size();
+    for (;;) {
+      switch (state_) {
+        case state::delimiter: {
+          auto const at = body.find(delimiter_, next_);
+          if (at == npos) {
+            if (body.size() >= width) next_ = std::max(next_, body.size() - width + 1);
+            return;
+          }
+          if (body.size() < at + width + 2) {
+            next_ = at;  // Found again once the two bytes after it are in
+            return;
+          }
+          if (body.substr(at + width, 2) == "--") {
+            state_ = state::done;
+            return;
+          }
+          next_ = at + width + 2;  // Skips the CRLF
+          state_ = state::headers;
+          break;
+        }
+        case state::headers: {
+          auto const end = body.find("\r\n\r\n", next_);
+          if (end == npos) {
+            if (body.size() >= 3) next_ = std::max(next_, body.size() - 3);
+            return;
+          }
+          data_start_ = end + 4;
+          hashed_ = data_start_;
+          next_ = data_start_;
+          hasher_ = codec::hasher{};
+          state_ = state::data;
+          break;
+        }
+        case state::data: {
+          auto const at = body.find(delimiter_, next_);
+          if (at == npos) {
+            // Bytes that may still turn out to be the CRLF and delimiter
+            // ending the part wait for the next call.
+            if (body.size() > width + 2 && body.size() - width - 2 > hashed_) {
+              hash(body, body.size() - width - 2);
+            }
+            if (body.size() >= width) next_ = std::max(next_, body.size() - width + 1);
+            return;
+          }
+          // The handler drops a trailing LF, then a trailing CR.
+          auto end = at;
+          if (end > data_start_ && body[end - 1] == '\n') --end;
+          if (end > data_start_ && body[end - 1] == '\r') --end;
+          hash(body, end);
+          parts_.push_back({data_start_, end - data_start_, hasher_.value()});
+          next_ = at;
+          state_ = state::delimiter;
+          break;
+        }
+        case state::done:
+          return;
+      }
+    }
+  }
+
+  // The digest of the part with this content, if it was seen whole.
+  std::optional<codec::digest> find(std::size_t offset, std::size_t size) const {
+    for (auto const& p : parts_) {
+      if (p.offset == offset && p.size == size) return p.digest;
+    }
+    return std::nullopt;
+  }
+
+ private:
+  enum class state { delimiter, headers, data, done };
+
+  void hash(std::string_view body, std::size_t end) {
+    hasher_.update(body.data() + hashed_, end - hashed_);
+    hashed_ = end;
+  }
+
+  std::string delimiter_;
+  state state_ = state::delimiter;
+  std::size_t next_ = 0;  // Where the next search starts
+  std::size_t data_start_ = 0;
+  std::size_t hashed_ = 0;  // Content before this is in hasher_
+  codec::hasher hasher_;
+  std::vector<part> parts_;
+};
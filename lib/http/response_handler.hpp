@@ -4,12 +4,23 @@
 #include <boost/beast/http.hpp>
 #include <boost/beast/version.hpp>
 #include <boost/json.hpp>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <utility>
+
+#include "../codec/analysis.hpp"
+#include "../codec/gzip.hpp"
+#include "../metrics/trace.hpp"
 
 namespace beast = boost::beast;
 namespace http = beast::http;
 
 class ResponseHandler {
 public:
+  // Analysis results smaller than this are sent uncompressed.
+  static constexpr std::size_t min_gzip_response = 1024;
+
   template <class Request>
   static http::response<http::string_body> bad_request(const Request &req,
                                                        beast::string_view why) {
@@ -20,6 +31,8 @@ public:
     res.keep_alive(req.keep_alive());
     res.body() = std::string(why);
     res.prepare_payload();
+    trace::add_server_timing(res);
+    metrics::count_response(res.result_int());
     return res;
   }
 
@@ -33,6 +46,8 @@ public:
     res.keep_alive(req.keep_alive());
     res.body() = "The resource '" + std::string(target) + "' was not found.";
     res.prepare_payload();
+    trace::add_server_timing(res);
+    metrics::count_response(res.result_int());
     return res;
   }
 
@@ -46,28 +61,144 @@ public:
     res.keep_alive(req.keep_alive());
     res.body() = "An error occurred: '" + std::string(what) + "'";
     res.prepare_payload();
+    trace::add_server_timing(res);
+    metrics::count_response(res.result_int());
     return res;
   }
 
-  template <class Request, class computed_data>
-  static http::response<http::string_body> response(const Request &req,
-                                                    computed_data &data) {
-    boost::json::object response_object;
+  template <class Request>
+  static http::response<http::string_body>
+  unsupported_encoding(const Request &req) {
+    http::response<http::string_body> res{http::status::unsupported_media_type,
+                                          req.version()};
+    res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+    res.set(http::field::content_type, "text/html");
+    res.set(http::field::accept_encoding, "gzip, deflate");
+    res.keep_alive(req.keep_alive());
+    res.body() = "Unsupported Content-Encoding '" +
+                 std::string(req[http::field::content_encoding]) + "'";
+    res.prepare_payload();
+    trace::add_server_timing(res);
+    metrics::count_response(res.result_int());
+    return res;
+  }
 
-    response_object["status"] = "success";
-    response_object["total_entries"] = data.total_number_of_fields;
-    response_object["client_ip"] = data.client_ip;
-    response_object["client_port"] = data.client_port;
-    response_object["analysis_type"] = data.analysis_type;
-    response_object["message_stats"] = data.message_stats;
-    response_object["invalid_data"] = data.invalid_fields;
+  // The upload belongs to another node. Its body is left unread, so the
+  // connection is closed after this.
+  template <class Request>
+  static http::response<http::string_body>
+  redirect(const Request &req, beast::string_view location) {
+    http::response<http::string_body> res{http::status::temporary_redirect,
+                                          req.version()};
+    res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+    res.set(http::field::content_type, "text/html");
+    res.set(http::field::location, location);
+    res.keep_alive(false);
+    res.body() = "Moved to " + std::string(location);
+    res.prepare_payload();
+    trace::add_server_timing(res);
+    metrics::count_response(res.result_int());
+    return res;
+  }
 
-    http::response<http::string_body> res{http::status::ok, req.version()};
+  template <class Request>
+  static http::response<http::string_body>
+  bad_gateway(const Request &req, beast::string_view what) {
+    http::response<http::string_body> res{http::status::bad_gateway,
+                                          req.version()};
+    res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+    res.set(http::field::content_type, "text/html");
+    res.keep_alive(req.keep_alive());
+    res.body() = "Forwarding failed: '" + std::string(what) + "'";
+    res.prepare_payload();
+    trace::add_server_timing(res);
+    metrics::count_response(res.result_int());
+    return res;
+  }
+
+  // The client is over its limits. Its body is left unread, so the
+  // connection is closed after this.
+  template <class Request>
+  static http::response<http::string_body>
+  too_many_requests(const Request &req, std::chrono::seconds retry_after) {
+    http::response<http::string_body> res{http::status::too_many_requests,
+                                          req.version()};
+    res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+    res.set(http::field::content_type, "text/html");
+    res.set(http::field::retry_after, std::to_string(retry_after.count()));
+    res.keep_alive(false);
+    res.body() = "Rate limit exceeded, retry after " +
+                 std::to_string(retry_after.count()) + " s";
+    res.prepare_payload();
+    trace::add_server_timing(res);
+    metrics::count_response(res.result_int());
+    return res;
+  }
+
+  // A short `{"status": ...}` acknowledgement, with any other fields of `body`.
+  template <class Request>
+  static http::response<http::string_body>
+  json_status(const Request &req, http::status status, beast::string_view text,
+              boost::json::object body = {}) {
+    http::response<http::string_body> res{status, req.version()};
     res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
     res.set(http::field::content_type, "application/json");
     res.keep_alive(req.keep_alive());
-    res.body() = boost::json::serialize(response_object);
+    body["status"] = text;
+    res.body() = boost::json::serialize(body);
+    res.prepare_payload();
+    trace::add_server_timing(res);
+    metrics::count_response(res.result_int());
+    return res;
+  }
+
+  template <class Request>
+  static http::response<http::string_body> prometheus(const Request &req) {
+    http::response<http::string_body> res{http::status::ok, req.version()};
+    res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+    res.set(http::field::content_type, "text/plain; version=0.0.4");
+    res.keep_alive(req.keep_alive());
+    res.body() = metrics::render_prometheus();
+    res.prepare_payload();
+    trace::add_server_timing(res);
+    metrics::count_response(res.result_int());
+    return res;
+  }
+
+  template <class Request, class computed_data>
+  static http::response<http::string_body>
+  response(const Request &req, computed_data &data) {
+    stage_timer serialize_timer(request_stage::serialize);
+    // Written straight from the aggregate into the body, as JSON or as
+    // MessagePack when the client's Accept asks for it.
+    auto const format = codec::negotiate_format(req[http::field::accept]);
+    codec::analysis const result{data.total_number_of_fields, data.client_ip,
+                                 data.client_port, data.analysis_type,
+                                 data.invalid_fields, data.message_stats,
+                                 data.next_cursor};
+
+    http::response<http::string_body> res{http::status::ok, req.version()};
+    res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+    res.set(http::field::content_type, codec::content_type(format));
+    res.keep_alive(req.keep_alive());
+    if (format == codec::response_format::msgpack) {
+      codec::write_msgpack(result, res.body());
+    } else {
+      codec::write_json(result, res.body());
+    }
+    // Large results go out gzipped when the client accepts it.
+    if (res.body().size() >= min_gzip_response &&
+        codec::accepts_gzip(req[http::field::accept_encoding])) {
+      if (auto compressed = codec::gzip(res.body(), 6)) {
+        res.body() = std::move(*compressed);
+        res.set(http::field::content_encoding, "gzip");
+      }
+    }
+    res.set(http::field::vary, "Accept, Accept-Encoding");
     res.prepare_payload();
+    serialize_timer.stop();
+    trace::add_server_timing(res);
+    metrics::count_response(res.result_int());
     return res;
   }
 };
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include "results.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <format>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace results {
+
+namespace {
+
+// Results not paged through for this long are dropped.
+constexpr auto time_to_live = std::chrono::minutes(5);
+// Rough bytes held across all stored results; the newest is always kept.
+constexpr std::size_t store_capacity = std::size_t{64} << 20;
+constexpr std::size_t entry_overhead = 64;
+
+struct entry {
+  std::string_view level;
+  std::string_view message;
+  std::int64_t count;
+};
+
+// The entries left after a first page, in the order they are paged out.
+struct stored_result {
+  summary header;
+  boost::json::object stats;  // Owns the strings the entries point into
+  std::vector<entry> entries;
+  std::size_t limit = 0;
+  std::size_t footprint = 0;
+};
+
+struct store_slot {
+  std::shared_ptr<const stored_result> result;
+  std::list<std::uint64_t>::iterator position;
+  std::chrono::steady_clock::time_point last_used;
+};
+
+std::mutex store_mutex;
+std::list<std::uint64_t> recency;  // Most recently used first
+std::unordered_map<std::uint64_t, store_slot> store;
+std::size_t stored_bytes = 0;
+std::mt19937_64 ids{std::random_device{}()};
+
+template <class Number>
+bool parse_number(std::string_view text, Number& value, int base = 10) {
+  auto const [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value, base);
+  return ec == std::errc{} && end == text.data() + text.size();
+}
+
+// Messages of every level that pass `min_count`, levels in aggregate order.
+// With `top`, each level keeps its `top` largest counts, highest first.
+std::vector<entry> select(boost::json::object const& stats, query const& q) {
+  auto const by_count = [](entry const& a, entry const& b) {
+    return a.count != b.count ? a.count > b.count : a.message < b.message;
+  };
+  std::vector<entry> selected;
+  std::vector<entry> level_entries;
+  for (auto const& [level, messages] : stats) {
+    auto const* inner = messages.if_object();
+    if (!inner) continue;
+    level_entries.clear();
+    for (auto const& [message, count] : *inner) {
+      if (count.is_int64() && count.get_int64() >= q.min_count) {
+        level_entries.push_back({level, message, count.get_int64()});
+      }
+    }
+    if (q.top > 0 && level_entries.size() > q.top) {
+      // Only the kept prefix is ordered: O(n log top) rather than a full sort.
+      std::partial_sort(level_entries.begin(),
+          level_entries.begin() + static_cast<std::ptrdiff_t>(q.top),
+          level_entries.end(),
+          by_count);
+      level_entries.resize(q.top);
+    } else if (q.top > 0) {
+      std::sort(level_entries.begin(), level_entries.end(), by_count);
+    }
+    selected.insert(selected.end(), level_entries.begin(), level_entries.end());
+  }
+  return selected;
+}
+
+// `level -> message -> count` for entries [first, last). A level's entries are
+// contiguous, so each level object is created once.
+boost::json::object build_object(std::vector<entry> const& entries,
+    std::size_t first,
+    std::size_t last) {
+  boost::json::object out;
+  boost::json::object* level_object = nullptr;
+  std::string_view current_level;
+  for (std::size_t i = first; i < last; ++i) {
+    auto const& e = entries[i];
+    if (!level_object || e.level != current_level) {
+      level_object = &out[e.level].emplace_object();
+      current_level = e.level;
+    }
+    (*level_object)[e.message] = e.count;
+  }
+  return out;
+}
+
+void erase(std::unordered_map<std::uint64_t, store_slot>::iterator it) {
+  stored_bytes -= it->second.result->footprint;
+  recency.erase(it->second.position);
+  store.erase(it);
+}
+
+std::uint64_t keep(std::shared_ptr<const stored_result> result) {
+  auto const now = std::chrono::steady_clock::now();
+  std::scoped_lock lock(store_mutex);
+  // Expired results are at the back: they have gone unused the longest.
+  while (!recency.empty() && now - store.at(recency.back()).last_used > time_to_live) {
+    erase(store.find(recency.back()));
+  }
+
+  std::uint64_t id = 0;
+  do {
+    id = ids();
+  } while (store.contains(id));
+  stored_bytes += result->footprint;
+  recency.push_front(id);
+  store.emplace(id, store_slot{std::move(result), recency.begin(), now});
+  while (stored_bytes > store_capacity && recency.size() > 1) {
+    erase(store.find(recency.back()));
+  }
+  return id;
+}
+
+std::string make_cursor(std::uint64_t id, std::size_t offset) {
+  return std::format("{:016x}.{}", id, offset);
+}
+
+}  // namespace
+
+std::optional<query> parse_query(std::string_view text) {
+  query q;
+  while (!text.empty()) {
+    auto const amp = text.find('&');
+    auto const pair = text.substr(0, amp);
+    text = amp == std::string_view::npos ? std::string_view{} : text.substr(amp + 1);
+
+    auto const equals = pair.find('=');
+    auto const key = pair.substr(0, equals);
+    auto const value =
+        equals == std::string_view::npos ? std::string_view{} : pair.substr(equals + 1);
+    if (key == "top") {
+      if (!parse_number(value, q.top) || q.top == 0) return std::nullopt;
+    } else if (key == "min_count") {
+      if (!parse_number(value, q.min_count) || q.min_count < 0) return std::nullopt;
+    } else if (key == "limit") {
+      if (!parse_number(value, q.limit) || q.limit == 0) return std::nullopt;
+    } else if (key == "cursor") {
+      q.cursor = value;
+    }
+  }
+  return q;
+}
+
+std::string apply(query const& q, boost::json::object& stats, summary const& header) {
+  if (!q.narrows()) return {};
+  auto const selected = select(stats, q);
+  auto const first_page = q.limit > 0 ? std::min(q.limit, selected.size()) : selected.size();
+
+  // Both pages are built before `stats`, which the entries point into, is
+  // replaced.
+  auto rest = build_object(selected, first_page, selected.size());
+  stats = build_object(selected, 0, first_page);
+  if (rest.empty()) return {};
+
+  auto stored = std::make_shared<stored_result>();
+  stored->header = header;
+  stored->limit = q.limit;
+  stored->stats = std::move(rest);
+  stored->entries = select(stored->stats, {});
+  for (auto const& e : stored->entries) {
+    stored->footprint += e.level.size() + e.message.size() + entry_overhead;
+  }
+  return make_cursor(keep(std::move(stored)), 0);
+}
+
+std::optional<page> fetch(std::string_view cursor, std::size_t limit) {
+  auto const dot = cursor.find('.');
+  if (dot == std::string_view::npos) return std::nullopt;
+  std::uint64_t id = 0;
+  std::size_t offset = 0;
+  if (!parse_number(cursor.substr(0, dot), id, 16)) return std::nullopt;
+  if (!parse_number(cursor.substr(dot + 1), offset)) return std::nullopt;
+
+  std::shared_ptr<const stored_result> result;
+  {
+    auto const now = std::chrono::steady_clock::now();
+    std::scoped_lock lock(store_mutex);
+    auto it = store.find(id);
+    if (it == store.end()) return std::nullopt;
+    if (now - it->second.last_used > time_to_live) {
+      erase(it);
+      return std::nullopt;
+    }
+    it->second.last_used = now;
+    recency.splice(recency.begin(), recency, it->second.position);
+    result = it->second.result;
+  }
+
+  auto const& entries = result->entries;
+  if (offset >= entries.size()) return std::nullopt;
+  if (limit == 0) limit = result->limit > 0 ? result->limit : entries.size();
+  auto const last = offset + std::min(limit, entries.size() - offset);
+  return page{result->header,
+      build_object(entries, offset, last),
+      last < entries.size() ? make_cursor(id, last) : std::string{}};
+}
+
+}  // namespace results
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <boost/json.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Narrowing and paging of `message_stats`. `top` and `min_count` are applied
+// before anything is serialized; with `limit`, only the first page is sent and
+// the rest is kept in a bounded store, reachable through a cursor.
+namespace results {
+
+// Query parameters of POST / and GET /results.
+struct query {
+  std::size_t top = 0;  // Most frequent messages per level, 0 for all
+  std::int64_t min_count = 0;
+  std::size_t limit = 0;  // Messages per page across all levels, 0 for all
+  std::string cursor;
+
+  bool narrows() const { return top > 0 || min_count > 0 || limit > 0; }
+};
+
+// Parses "top=10&min_count=2&limit=500&cursor=...". Unknown keys are ignored;
+// returns nothing if a value is malformed.
+std::optional<query> parse_query(std::string_view text);
+
+// The scalar fields of an analysis, kept with a stored result.
+struct summary {
+  std::size_t total_entries = 0;
+  std::size_t invalid_data = 0;
+  std::string client_ip;
+  std::string client_port;
+  std::string analysis_type;
+};
+
+// Replaces `stats` with the part `q` asks for. With `top`, each level's
+// messages are ordered by count, highest first. Returns the cursor of the
+// next page, or an empty string when nothing is left.
+std::string apply(query const& q, boost::json::object& stats, summary const& header);
+
+struct page {
+  summary header;
+  boost::json::object message_stats;
+  std::string next_cursor;
+};
+
+// The page at `cursor`, `limit` messages long (0 keeps the original limit).
+// Returns nothing for unknown or expired cursors.
+std::optional<page> fetch(std::string_view cursor, std::size_t limit);
+
+}  // namespace results
@@ -0,0 +1,218 @@
+#include "static_files.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+#include "mime.hpp"
+
+namespace static_files {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// Below this, gzip's header costs more than it saves.
+constexpr std::size_t min_compress_bytes = 256;
+constexpr auto revalidate_after = std::chrono::seconds(1);
+
+struct cache_entry {
+  std::shared_ptr<const cached_file> file;
+  std::list<std::string>::iterator position;
+  std::chrono::steady_clock::time_point checked;
+};
+
+// Lookups take the mutex only to find and touch an entry; files are read and
+// compressed outside it.
+std::mutex cache_mutex;
+std::list<std::string> recency;  // Most recently used first
+std::unordered_map<std::string, cache_entry> entries;
+std::size_t cached_bytes = 0;
+std::size_t capacity = std::size_t{16} << 20;
+std::size_t max_file = std::size_t{256} << 10;
+
+std::size_t footprint(cached_file const& file) {
+  return file.body.size() + file.gzip.size();
+}
+
+void erase(std::unordered_map<std::string, cache_entry>::iterator it) {
+  cached_bytes -= footprint(*it->second.file);
+  recency.erase(it->second.position);
+  entries.erase(it);
+}
+
+resolved from_cache(std::shared_ptr<const cached_file> file) {
+  resolved result;
+  result.size = file->body.size();
+  result.etag = file->etag;
+  result.last_modified = file->last_modified;
+  result.mime = file->mime;
+  result.cached = std::move(file);
+  return result;
+}
+
+std::string http_date(fs::file_time_type time) {
+  auto const utc = std::chrono::clock_cast<std::chrono::system_clock>(time);
+  return std::format("{:%a, %d %b %Y %H:%M:%S} GMT", std::chrono::floor<std::chrono::seconds>(utc));
+}
+
+std::string_view trim(std::string_view text) {
+  auto const first = text.find_first_not_of(" \t");
+  if (first == std::string_view::npos) return {};
+  auto const last = text.find_last_not_of(" \t");
+  return text.substr(first, last - first + 1);
+}
+
+bool parse_number(std::string_view text, std::uint64_t& value) {
+  auto const [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+  return ec == std::errc{} && end == text.data() + text.size();
+}
+
+std::optional<std::string> read_file(std::string const& path, std::uint64_t size) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return std::nullopt;
+  std::string content(size, '\0');
+  in.read(content.data(), static_cast<std::streamsize>(size));
+  content.resize(static_cast<std::size_t>(in.gcount()));
+  return content;
+}
+
+}  // namespace
+
+void configure(std::size_t capacity_bytes, std::size_t max_file_bytes) {
+  std::scoped_lock lock(cache_mutex);
+  capacity = capacity_bytes;
+  max_file = std::min(max_file_bytes, capacity_bytes);
+  while (cached_bytes > capacity && !recency.empty()) erase(entries.find(recency.back()));
+}
+
+resolved resolve(std::string const& path) {
+  auto const now = std::chrono::steady_clock::now();
+  {
+    std::scoped_lock lock(cache_mutex);
+    auto it = entries.find(path);
+    if (it != entries.end() && now - it->second.checked < revalidate_after) {
+      recency.splice(recency.begin(), recency, it->second.position);
+      return from_cache(it->second.file);
+    }
+  }
+
+  resolved result;
+  std::error_code ec;
+  auto const status = fs::status(path, ec);
+  if (ec || !fs::is_regular_file(status)) {
+    result.ec = beast::errc::make_error_code(beast::errc::no_such_file_or_directory);
+    return result;
+  }
+  auto const size = fs::file_size(path, ec);
+  auto const modified = ec ? fs::file_time_type{} : fs::last_write_time(path, ec);
+  if (ec) {
+    result.ec = ec;
+    return result;
+  }
+
+  result.size = size;
+  result.etag = std::format("\"{:x}-{:x}\"", size, modified.time_since_epoch().count());
+  result.last_modified = http_date(modified);
+  result.mime = mime::lookup(path).type;
+
+  std::size_t limit = 0;
+  {
+    std::scoped_lock lock(cache_mutex);
+    limit = max_file;
+    if (auto it = entries.find(path); it != entries.end()) {
+      if (it->second.file->etag == result.etag) {
+        it->second.checked = now;
+        recency.splice(recency.begin(), recency, it->second.position);
+        return from_cache(it->second.file);
+      }
+      erase(it);  // Changed on disk
+    }
+  }
+  if (size > limit) return result;
+
+  auto body = read_file(path, size);
+  if (!body || body->size() != size) return result;  // Changed while reading; serve from disk
+
+  auto file = std::make_shared<cached_file>();
+  file->body = std::move(*body);
+  file->etag = result.etag;
+  file->last_modified = result.last_modified;
+  file->mime = result.mime;
+  if (mime::lookup(path).compressible && size >= min_compress_bytes) {
+    if (auto compressed = codec::gzip(file->body); compressed && compressed->size() < size) {
+      file->gzip = std::move(*compressed);
+      // A strong tag names one representation, so the gzip form gets its own.
+      file->gzip_etag = file->etag.substr(0, file->etag.size() - 1) + "-gz\"";
+    }
+  }
+
+  std::scoped_lock lock(cache_mutex);
+  if (auto it = entries.find(path); it != entries.end()) erase(it);  // Another thread loaded it too
+  recency.push_front(path);
+  entries.emplace(path, cache_entry{file, recency.begin(), now});
+  cached_bytes += footprint(*file);
+  while (cached_bytes > capacity && !recency.empty()) erase(entries.find(recency.back()));
+  return from_cache(std::move(file));
+}
+
+range_kind parse_range(std::string_view header, std::uint64_t size, byte_range& range) {
+  constexpr std::string_view unit = "bytes=";
+  if (!header.starts_with(unit)) return range_kind::none;
+  auto const spec = trim(header.substr(unit.size()));
+  if (spec.find(',') != std::string_view::npos) return range_kind::none;
+  auto const dash = spec.find('-');
+  if (dash == std::string_view::npos) return range_kind::none;
+
+  auto const first = trim(spec.substr(0, dash));
+  auto const last = trim(spec.substr(dash + 1));
+  std::uint64_t a = 0, b = 0;
+  if (first.empty()) {
+    // Suffix range: the last `b` bytes
+    if (!parse_number(last, b)) return range_kind::none;
+    if (b == 0 || size == 0) return range_kind::unsatisfiable;
+    range = {size - std::min(b, size), size - 1};
+    return range_kind::satisfiable;
+  }
+  if (!parse_number(first, a)) return range_kind::none;
+  if (last.empty()) {
+    b = size == 0 ? 0 : size - 1;
+  } else if (!parse_number(last, b) || b < a) {
+    return range_kind::none;
+  }
+  if (a >= size) return range_kind::unsatisfiable;
+  range = {a, std::min(b, size - 1)};
+  return range_kind::satisfiable;
+}
+
+bool not_modified(std::string_view if_none_match,
+    std::string_view if_modified_since,
+    std::string_view etag,
+    std::string_view last_modified) {
+  if (!if_none_match.empty()) {
+    // Weak comparison: a W/ prefix on either side is ignored.
+    auto const strong = [](std::string_view tag) {
+      return tag.starts_with("W/") ? tag.substr(2) : tag;
+    };
+    while (!if_none_match.empty()) {
+      auto const comma = if_none_match.find(',');
+      auto const tag = trim(if_none_match.substr(0, comma));
+      if (tag == "*" || strong(tag) == strong(etag)) return true;
+      if (comma == std::string_view::npos) break;
+      if_none_match.remove_prefix(comma + 1);
+    }
+    return false;
+  }
+  // Exact match only, like nginx's default if_modified_since.
+  return !if_modified_since.empty() && if_modified_since == last_modified;
+}
+
+}  // namespace static_files
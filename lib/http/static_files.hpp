@@ -0,0 +1,246 @@
+#pragma once
+
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/version.hpp>
+#include <boost/optional.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "../codec/gzip.hpp"
+#include "../metrics/registry.hpp"
+#include "response_handler.hpp"
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+
+// Files under the document root. Small files are served from a bounded LRU
+// cache, with a gzip copy for compressible types; larger ones are streamed
+// from disk, with sendfile(2) when the session can take the file over.
+namespace static_files {
+
+// A small file held in memory. Never modified once cached; a changed file
+// gets a new entry.
+struct cached_file {
+  std::string body;
+  std::string gzip;  // Empty when not worth compressing
+  std::string etag;
+  std::string gzip_etag;  // Tag of the gzip form: etag with -gz inside the quotes
+  std::string last_modified;
+  std::string_view mime;
+};
+
+// What resolve() found for a path.
+struct resolved {
+  beast::error_code ec;
+  std::shared_ptr<const cached_file> cached;  // Set for files in the cache
+  std::uint64_t size = 0;
+  std::string etag;
+  std::string last_modified;
+  std::string_view mime;
+};
+
+// A byte range of an open file that the session sends after the header.
+struct file_transfer {
+  beast::file file;
+  std::uint64_t offset = 0;
+  std::uint64_t length = 0;
+
+  explicit operator bool() const { return file.is_open(); }
+};
+
+// Inclusive byte range from a Range header.
+struct byte_range {
+  std::uint64_t first = 0;
+  std::uint64_t last = 0;
+
+  std::uint64_t length() const { return last - first + 1; }
+};
+
+enum class range_kind { none, satisfiable, unsatisfiable };
+
+// Cache bounds: total bytes held, and the largest file that is cached.
+void configure(std::size_t capacity_bytes, std::size_t max_file_bytes);
+
+// Looks `path` up in the cache, loading it if it is small enough. Cached files
+// are re-checked against the disk at most once a second.
+resolved resolve(std::string const& path);
+
+// Only single ranges are honoured; anything else is served whole.
+range_kind parse_range(std::string_view header, std::uint64_t size, byte_range& range);
+
+// If-None-Match takes precedence over If-Modified-Since, as in RFC 9110.
+bool not_modified(std::string_view if_none_match,
+    std::string_view if_modified_since,
+    std::string_view etag,
+    std::string_view last_modified);
+
+// Read-only body over memory owned by a shared pointer, so cached files are
+// written straight from the cache without a copy.
+struct shared_body {
+  struct value_type {
+    std::shared_ptr<const void> owner;
+    std::string_view data;
+  };
+
+  static std::uint64_t size(value_type const& body) { return body.data.size(); }
+
+  class writer {
+   public:
+    using const_buffers_type = boost::asio::const_buffer;
+
+    template <bool isRequest, class Fields>
+    writer(http::header<isRequest, Fields> const&, value_type const& body) : body_(body) {}
+
+    void init(beast::error_code& ec) { ec = {}; }
+
+    boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code& ec) {
+      ec = {};
+      return {{const_buffers_type(body_.data.data(), body_.data.size()), false}};
+    }
+
+   private:
+    value_type const& body_;
+  };
+};
+
+template <class Request, class Response>
+void set_file_headers(Request const& req,
+    Response& res,
+    std::string_view etag,
+    std::string_view last_modified) {
+  res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+  res.set(http::field::etag, etag);
+  res.set(http::field::last_modified, last_modified);
+  res.set(http::field::accept_ranges, "bytes");
+  res.keep_alive(req.keep_alive());
+}
+
+// Serves a GET or HEAD for `path`. With `zero_copy`, a large file is handed to
+// the caller to send after the returned header instead of going in the body.
+template <class Request>
+http::message_generator serve(Request const& req,
+    std::string const& path,
+    file_transfer* zero_copy = nullptr) {
+  auto file = resolve(path);
+  if (file.ec == beast::errc::no_such_file_or_directory) {
+    return ResponseHandler::not_found(req, req.target());
+  }
+  if (file.ec) return ResponseHandler::server_error(req, file.ec.message());
+
+  // If-Range with a stale validator means the client wants the whole file.
+  // Ranges always refer to the identity encoding, so it is compared against
+  // the identity tag.
+  byte_range range;
+  auto kind = range_kind::none;
+  auto const if_range = req[http::field::if_range];
+  if (req.method() == http::verb::get && (if_range.empty() || if_range == file.etag)) {
+    kind = parse_range(req[http::field::range], file.size, range);
+  }
+
+  // The gzip form goes out whole to clients that accept it, under its own tag.
+  bool const compressed = kind == range_kind::none && file.cached && !file.cached->gzip.empty() &&
+                          codec::accepts_gzip(req[http::field::accept_encoding]);
+  std::string_view const etag = compressed ? file.cached->gzip_etag : file.etag;
+
+  if (not_modified(req[http::field::if_none_match], req[http::field::if_modified_since], etag,
+          file.last_modified)) {
+    http::response<http::empty_body> res{http::status::not_modified, req.version()};
+    set_file_headers(req, res, etag, file.last_modified);
+    if (file.cached && !file.cached->gzip.empty()) res.set(http::field::vary, "Accept-Encoding");
+    trace::add_server_timing(res);
+    metrics::count_response(res.result_int());
+    return res;
+  }
+
+  if (kind == range_kind::unsatisfiable) {
+    http::response<http::empty_body> res{http::status::range_not_satisfiable, req.version()};
+    set_file_headers(req, res, file.etag, file.last_modified);
+    res.set(http::field::content_range, "bytes */" + std::to_string(file.size));
+    res.content_length(0);
+    trace::add_server_timing(res);
+    metrics::count_response(res.result_int());
+    return res;
+  }
+
+  auto const status =
+      kind == range_kind::satisfiable ? http::status::partial_content : http::status::ok;
+  auto const prepare = [&](auto& res, std::uint64_t length) {
+    set_file_headers(req, res, etag, file.last_modified);
+    res.set(http::field::content_type, file.mime);
+    if (kind == range_kind::satisfiable) {
+      res.set(http::field::content_range,
+          "bytes " + std::to_string(range.first) + "-" + std::to_string(range.last) + "/" +
+              std::to_string(file.size));
+    }
+    res.content_length(length);
+    trace::add_server_timing(res);
+    metrics::count_response(res.result_int());
+  };
+
+  if (file.cached) {
+    std::string_view data = compressed ? file.cached->gzip : file.cached->body;
+    if (kind == range_kind::satisfiable) data = data.substr(range.first, range.length());
+
+    auto const length = data.size();
+    if (req.method() == http::verb::head) data = {};
+    http::response<shared_body> res{std::piecewise_construct,
+        std::make_tuple(shared_body::value_type{file.cached, data}),
+        std::make_tuple(status, req.version())};
+    if (!file.cached->gzip.empty()) res.set(http::field::vary, "Accept-Encoding");
+    if (compressed) res.set(http::field::content_encoding, "gzip");
+    prepare(res, length);
+    return res;
+  }
+
+  std::uint64_t const offset = kind == range_kind::satisfiable ? range.first : 0;
+  std::uint64_t const length = kind == range_kind::satisfiable ? range.length() : file.size;
+  if (req.method() == http::verb::head) {
+    http::response<http::empty_body> res{status, req.version()};
+    prepare(res, length);
+    return res;
+  }
+
+  beast::error_code ec;
+  beast::file body;
+  body.open(path.c_str(), beast::file_mode::scan, ec);
+  if (ec == beast::errc::no_such_file_or_directory) {
+    return ResponseHandler::not_found(req, req.target());
+  }
+  if (ec) return ResponseHandler::server_error(req, ec.message());
+
+  if (zero_copy) {
+    *zero_copy = file_transfer{std::move(body), offset, length};
+    http::response<http::empty_body> res{status, req.version()};
+    prepare(res, length);
+    return res;
+  }
+
+  if (kind == range_kind::satisfiable) {
+    // No zero-copy path to hand the file to, so read just the range.
+    std::string data(length, '\0');
+    body.seek(offset, ec);
+    if (!ec) body.read(data.data(), data.size(), ec);
+    if (ec) return ResponseHandler::server_error(req, ec.message());
+    http::response<http::string_body> res{status, req.version()};
+    res.body() = std::move(data);
+    prepare(res, length);
+    return res;
+  }
+
+  http::file_body::value_type whole;
+  whole.reset(std::move(body), ec);
+  if (ec) return ResponseHandler::server_error(req, ec.message());
+  http::response<http::file_body> res{std::piecewise_construct,
+      std::make_tuple(std::move(whole)),
+      std::make_tuple(status, req.version())};
+  prepare(res, length);
+  return res;
+}
+
+}  // namespace static_files
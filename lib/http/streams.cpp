@@ -0,0 +1,104 @@
+#include "streams.hpp"
+
+#include <mutex>
+#include <utility>
+
+#include "../file/handler.hpp"
+
+namespace streams {
+
+namespace {
+
+// Snapshots of ended streams stay readable this long.
+constexpr auto keep_ended = std::chrono::minutes(5);
+
+struct published {
+  snapshot latest;
+  std::chrono::steady_clock::time_point ended;
+};
+
+std::mutex snapshots_mutex;
+cluster::string_map<published> snapshots;
+
+}  // namespace
+
+void line_ingest::feed(std::string_view data) {
+  bytes_ += data.size();
+  while (!data.empty()) {
+    auto const newline = data.find('\n');
+    if (newline == std::string_view::npos) {
+      if (skipping_) return;
+      if (carry_.size() + data.size() > max_record) {
+        skip_record();
+        return;
+      }
+      carry_ += data;
+      return;
+    }
+    auto const line_end = newline + 1;
+    if (skipping_) {
+      skipping_ = false;
+    } else if (!carry_.empty()) {
+      carry_ += data.substr(0, line_end);
+      parse(carry_);
+      carry_.clear();
+    } else {
+      // Every complete line of the piece in one go.
+      auto const last = data.rfind('\n') + 1;
+      parse(data.substr(0, last));
+      data.remove_prefix(last);
+      continue;
+    }
+    data.remove_prefix(line_end);
+  }
+}
+
+void line_ingest::finish() {
+  if (!skipping_ && !carry_.empty()) parse(carry_);
+  carry_.clear();
+  skipping_ = false;
+}
+
+void line_ingest::parse(std::string_view lines) {
+  auto const parsed = parse_text_file(lines);
+  aggregate_.merge(parsed.message_stats, parsed.total_fields, parsed.invalid_fields);
+}
+
+void line_ingest::skip_record() {
+  carry_.clear();
+  carry_.shrink_to_fit();
+  skipping_ = true;
+  ++aggregate_.total_entries;
+  ++aggregate_.invalid_data;
+}
+
+void publish(std::string_view client_id, line_ingest const& ingest, bool done) {
+  auto const& aggregate = ingest.aggregate();
+  boost::json::object body;
+  body["total_entries"] = aggregate.total_entries;
+  body["invalid_data"] = aggregate.invalid_data;
+  body["bytes"] = ingest.bytes();
+  body["done"] = done;
+  body["message_stats"] = aggregate.message_stats();
+  auto json = std::make_shared<std::string const>(boost::json::serialize(body));
+
+  auto const now = std::chrono::steady_clock::now();
+  std::scoped_lock lock(snapshots_mutex);
+  std::erase_if(snapshots, [now](auto const& entry) {
+    return entry.second.latest.done && now - entry.second.ended > keep_ended;
+  });
+  auto it = snapshots.find(client_id);
+  if (it == snapshots.end()) it = snapshots.try_emplace(std::string(client_id)).first;
+  auto& entry = it->second;
+  entry.latest = {entry.latest.seq + 1, done, std::move(json)};
+  if (done) entry.ended = now;
+}
+
+std::optional<snapshot> latest(std::string_view client_id) {
+  std::scoped_lock lock(snapshots_mutex);
+  auto const it = snapshots.find(client_id);
+  if (it == snapshots.end()) return std::nullopt;
+  return it->second.latest;
+}
+
+}  // namespace streams
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "../cluster/aggregate.hpp"
+
+// Streaming ingestion behind POST /stream: a text log body of any length,
+// usually sent with Transfer-Encoding: chunked, is parsed line by line while
+// it arrives. What is held is one piece of the body, one unfinished line and
+// the aggregate, which grows with distinct messages rather than with the
+// stream. Snapshots of the running aggregate are published per Client-Id for
+// GET /stream/events.
+namespace streams {
+
+// Longer records are counted as invalid and skipped.
+inline constexpr std::size_t max_record = std::size_t{1} << 20;
+// How often a running stream publishes a snapshot.
+inline constexpr auto snapshot_interval = std::chrono::seconds(1);
+
+class line_ingest {
+ public:
+  // Parses the complete lines of `data`, keeping a last unfinished line for
+  // the next call.
+  void feed(std::string_view data);
+  // Parses what is left if the body did not end with a newline.
+  void finish();
+
+  cluster::partial const& aggregate() const { return aggregate_; }
+  std::uint64_t bytes() const { return bytes_; }
+
+ private:
+  void parse(std::string_view lines);
+  void skip_record();
+
+  cluster::partial aggregate_;
+  std::string carry_;      // Start of a line that goes on in the next piece
+  bool skipping_ = false;  // Inside a record longer than max_record
+  std::uint64_t bytes_ = 0;
+};
+
+struct snapshot {
+  std::uint64_t seq = 0;  // Grows with every publish for the client
+  bool done = false;      // The stream has ended
+  std::shared_ptr<std::string const> json;
+};
+
+// Makes `ingest`'s aggregate the client's latest snapshot. Snapshots of ended
+// streams are dropped a few minutes later.
+void publish(std::string_view client_id, line_ingest const& ingest, bool done);
+
+// The client's latest snapshot, or nothing if none was published.
+std::optional<snapshot> latest(std::string_view client_id);
+
+}  // namespace streams
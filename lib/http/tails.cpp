@@ -0,0 +1,126 @@
+#include "tails.hpp"
+
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "../cluster/upstream.hpp"
+#include "../file/handler.hpp"
+
+namespace tails {
+
+namespace {
+
+// Clients that have sent nothing for this long are dropped.
+constexpr auto idle_timeout = std::chrono::hours(1);
+constexpr auto sweep_interval = std::chrono::minutes(1);
+
+struct file_position {
+  std::uint64_t inode = 0;
+  std::uint64_t end = 0;  // Offset just past the last applied batch
+};
+
+struct client_tail {
+  cluster::partial aggregate;
+  cluster::string_map<file_position> files;
+  std::chrono::steady_clock::time_point last_used;
+};
+
+std::mutex tails_mutex;
+cluster::string_map<client_tail> clients;
+std::chrono::steady_clock::time_point last_sweep;
+
+bool parse_number(std::string_view text, std::uint64_t& value) {
+  auto const [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+  return ec == std::errc{} && end == text.data() + text.size();
+}
+
+void sweep(std::chrono::steady_clock::time_point now) {
+  if (now - last_sweep < sweep_interval) return;
+  last_sweep = now;
+  std::erase_if(clients, [now](auto const& entry) {
+    return now - entry.second.last_used > idle_timeout;
+  });
+}
+
+}  // namespace
+
+fold_outcome fold(std::string_view client_id,
+    std::string_view file,
+    std::string_view inode,
+    std::string_view offset,
+    std::string_view body) {
+  std::uint64_t inode_number = 0;
+  std::uint64_t start = 0;
+  if (client_id.empty() || file.empty() || body.empty() || !parse_number(inode, inode_number) ||
+      !parse_number(offset, start)) {
+    return {fold_result::invalid};
+  }
+
+  // Only what lies past the last applied batch of this inode is counted: all
+  // of a new batch, none of a retried one, and the end of one resent by a
+  // client that lost its state file.
+  std::uint64_t seen_end = 0;
+  {
+    std::scoped_lock lock(tails_mutex);
+    if (auto const it = clients.find(client_id); it != clients.end()) {
+      auto const& files = it->second.files;
+      if (auto const at = files.find(file);
+          at != files.end() && at->second.inode == inode_number) {
+        seen_end = at->second.end;
+      }
+    }
+  }
+  auto const batch_end = start + body.size();
+  bool const duplicate = batch_end <= seen_end;
+  computed_data parsed{};
+  if (!duplicate) {
+    if (start < seen_end) body.remove_prefix(seen_end - start);
+    // Parsed outside the lock, so clients do not wait on each other's batches.
+    parsed = parse_text_file(body);
+    if (parsed.error_message != "success") return {fold_result::invalid};
+  }
+
+  fold_outcome outcome{duplicate ? fold_result::duplicate : fold_result::applied};
+  {
+    auto const now = std::chrono::steady_clock::now();
+    std::scoped_lock lock(tails_mutex);
+    sweep(now);
+    auto it = clients.find(client_id);
+    if (it == clients.end()) it = clients.try_emplace(std::string(client_id)).first;
+    auto& tail = it->second;
+    tail.last_used = now;
+
+    auto position = tail.files.find(file);
+    if (position == tail.files.end()) position = tail.files.try_emplace(std::string(file)).first;
+    auto& at = position->second;
+    // Another batch of the file was applied meanwhile; the client sends one
+    // at a time, so this is a retry.
+    if ((at.inode == inode_number ? at.end : 0) != seen_end) {
+      outcome.result = fold_result::duplicate;
+    }
+    if (outcome.result == fold_result::applied) {
+      // A new inode is a rotated file, which starts over from offset 0.
+      at = {inode_number, batch_end};
+      tail.aggregate.merge(parsed.message_stats, parsed.total_fields, parsed.invalid_fields);
+    }
+    outcome.total_entries = tail.aggregate.total_entries;
+    outcome.invalid_data = tail.aggregate.invalid_data;
+  }
+  if (outcome.result == fold_result::applied) {
+    cluster::record(parsed.message_stats, parsed.total_fields, parsed.invalid_fields);
+  }
+  return outcome;
+}
+
+std::optional<cluster::partial> snapshot(std::string_view client_id) {
+  std::scoped_lock lock(tails_mutex);
+  auto const it = clients.find(client_id);
+  if (it == clients.end()) return std::nullopt;
+  return it->second.aggregate;
+}
+
+}  // namespace tails
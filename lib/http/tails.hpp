@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+#include "../cluster/aggregate.hpp"
+
+// Running aggregates of followed logs (client --follow). Every batch of new
+// lines is folded into its client's aggregate, so a batch costs only its own
+// records however large the file has grown. Clients that send nothing for an
+// hour are dropped.
+namespace tails {
+
+enum class fold_result { applied, duplicate, invalid };
+
+struct fold_outcome {
+  fold_result result;
+  std::size_t total_entries = 0;  // The client's running totals
+  std::size_t invalid_data = 0;
+};
+
+// Parses a batch of text records and adds them to the client's aggregate.
+// `file`, `inode` and `offset` (the Tail-File, Tail-Inode and Tail-Offset
+// headers) place the batch in the client's file: one that starts before the
+// end of the last batch applied for the same file and inode is a retry and is
+// acknowledged without being counted again. Applied batches are also recorded
+// for this node's upstream, if it has one.
+fold_outcome fold(std::string_view client_id,
+    std::string_view file,
+    std::string_view inode,
+    std::string_view offset,
+    std::string_view body);
+
+// Copy of the client's running aggregate, or nothing if it has none.
+std::optional<cluster::partial> snapshot(std::string_view client_id);
+
+}  // namespace tails
@@ -0,0 +1,142 @@
+#include "logger.hpp"
+
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <stop_token>
+#include <print>
+#include <system_error>
+#include <thread>
+
+namespace logging {
+
+namespace {
+
+constexpr std::array<std::string_view, 5> level_tags{
+    "[TRACE] ", "[DEBUG] ", "[INFO] ", "[WARN] ", "[ERROR] "};
+
+// Rings are only added, never removed; the mutex is taken once per thread
+// and by the flusher, never while logging.
+std::mutex rings_mutex;
+std::deque<thread_ring> rings;
+
+std::atomic<std::uint64_t> dropped{0};
+
+// Declared after the rings so that, if stop() is never called, the flusher is
+// joined at exit before they are destroyed.
+std::jthread flusher;
+
+// How long the flusher sleeps when every ring was empty.
+constexpr auto idle_wait = std::chrono::milliseconds(5);
+
+void append_line(std::string& out, level lvl, std::uint32_t suppressed, std::string_view text) {
+  out += level_tags[static_cast<std::size_t>(lvl)];
+  out += text;
+  if (suppressed > 0) {
+    std::format_to(std::back_inserter(out), " ({} similar messages suppressed)", suppressed);
+  }
+  out += '\n';
+}
+
+void write_out(std::FILE* stream, std::string& buffer) {
+  if (buffer.empty()) return;
+  std::fwrite(buffer.data(), 1, buffer.size(), stream);
+  std::fflush(stream);
+  buffer.clear();
+}
+
+// Warnings and errors go to stderr, the rest to stdout, as before.
+std::FILE* stream_for(level lvl) {
+  return lvl >= level::warn ? stderr : stdout;
+}
+
+std::size_t drain_all(std::string& out, std::string& err, std::string& text) {
+  std::size_t records = 0;
+  std::scoped_lock lock(rings_mutex);
+  for (auto& ring : rings) {
+    records += ring.drain([&](slot& s) {
+      auto const header = s.header();
+      text.clear();
+      header.format(s.payload(), text);
+      auto& buffer = stream_for(header.lvl) == stderr ? err : out;
+      append_line(buffer, header.lvl, header.suppressed, text);
+    });
+  }
+  return records;
+}
+
+// Writes out every published record; returns how many there were.
+std::size_t flush_once(std::string& out, std::string& err, std::string& text) {
+  std::size_t const records = drain_all(out, err, text);
+  if (auto const lost = dropped.exchange(0, std::memory_order_relaxed); lost > 0) {
+    append_line(err, level::warn, 0, std::format("{} log records dropped, ring buffer full", lost));
+  }
+  write_out(stdout, out);
+  write_out(stderr, err);
+  return records;
+}
+
+void flush_loop(std::stop_token token) {
+  std::string out;
+  std::string err;
+  std::string text;
+  while (true) {
+    bool const stopping = token.stop_requested();
+    std::size_t const records = flush_once(out, err, text);
+    if (stopping && records == 0) break;
+    if (records == 0) std::this_thread::sleep_for(idle_wait);
+  }
+}
+
+}  // namespace
+
+std::optional<level> parse_level(std::string_view name) {
+  for (std::size_t i = 0; i < level_names.size(); ++i) {
+    if (level_names[i] == name) return static_cast<level>(i);
+  }
+  return std::nullopt;
+}
+
+bool start(level min_level, std::uint32_t per_site_rate) {
+  runtime_level.store(static_cast<int>(min_level), std::memory_order_relaxed);
+  rate_limit.store(per_site_rate, std::memory_order_relaxed);
+  if (running.load(std::memory_order_relaxed)) return true;
+
+  try {
+    flusher = std::jthread(flush_loop);
+  } catch (const std::system_error& e) {
+    std::println(stderr, "[ERROR] Starting log flusher: {}", e.what());
+    return false;
+  }
+  running.store(true, std::memory_order_release);
+  return true;
+}
+
+void stop() {
+  if (!running.exchange(false, std::memory_order_acq_rel)) return;
+  flusher.request_stop();
+  flusher.join();
+  // A thread that saw `running` just before it was cleared may have published
+  // its record after the flusher's last drain.
+  std::string out;
+  std::string err;
+  std::string text;
+  flush_once(out, err, text);
+}
+
+thread_ring* register_thread() {
+  std::scoped_lock lock(rings_mutex);
+  return &rings.emplace_back();
+}
+
+void count_dropped() {
+  dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void write_now(level lvl, std::uint32_t suppressed, std::string_view text) {
+  std::string line;
+  append_line(line, lvl, suppressed, text);
+  write_out(stream_for(lvl), line);
+}
+
+}  // namespace logging
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Levels below LOG_ACTIVE_LEVEL are removed by the preprocessor, arguments
+// and all. Set it with -DLOG_ACTIVE_LEVEL=<n> at configure time.
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_WARN 3
+#define LOG_LEVEL_ERROR 4
+#define LOG_LEVEL_OFF 5
+
+#ifndef LOG_ACTIVE_LEVEL
+#define LOG_ACTIVE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+// Asynchronous logging. A call site copies its arguments into a slot of the
+// calling thread's ring buffer and returns; a background thread formats and
+// writes them. Producers never lock and never block: when a ring is full the
+// record is dropped and counted.
+namespace logging {
+
+enum class level : int { trace, debug, info, warn, error, off };
+
+inline constexpr std::array<std::string_view, 6> level_names{
+    "trace", "debug", "info", "warn", "error", "off"};
+
+inline std::atomic<int> runtime_level{static_cast<int>(level::info)};
+inline std::atomic<bool> running{false};
+// Records per call site per second, 0 for no limit
+inline std::atomic<std::uint32_t> rate_limit{0};
+
+std::optional<level> parse_level(std::string_view name);
+
+// Starts the flusher. Before start() and after stop() records are written
+// synchronously, so tools that never start it still see their messages.
+bool start(level min_level, std::uint32_t per_site_rate);
+void stop();
+
+inline bool enabled(level lvl) {
+  return static_cast<int>(lvl) >= runtime_level.load(std::memory_order_relaxed);
+}
+
+// Formats the payload stored after the header into `out`, then destroys it.
+using format_fn = void (*)(void* payload, std::string& out);
+
+struct record_header {
+  format_fn format;
+  level lvl;
+  std::uint32_t suppressed;  // Records this call site dropped just before this one
+};
+
+inline constexpr std::size_t slot_size = 256;
+inline constexpr std::size_t slot_align = alignof(std::max_align_t);
+inline constexpr std::size_t payload_offset =
+    (sizeof(record_header) + slot_align - 1) / slot_align * slot_align;
+
+struct alignas(slot_align) slot {
+  std::byte bytes[slot_size];
+
+  record_header& header() { return *std::launder(reinterpret_cast<record_header*>(bytes)); }
+  void* payload() { return bytes + payload_offset; }
+};
+
+// Single producer (the owning thread), single consumer (the flusher).
+class thread_ring {
+ public:
+  static constexpr std::size_t capacity = 1024;
+
+  slot* try_claim() {
+    auto const tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == capacity) return nullptr;
+    return &slots_[tail % capacity];
+  }
+
+  void publish() {
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  // Consumer side: hands every published slot to `consume` and frees them.
+  template <class Consume>
+  std::size_t drain(Consume&& consume) {
+    auto head = head_.load(std::memory_order_relaxed);
+    auto const tail = tail_.load(std::memory_order_acquire);
+    std::size_t const count = tail - head;
+    for (; head != tail; ++head) consume(slots_[head % capacity]);
+    head_.store(head, std::memory_order_release);
+    return count;
+  }
+
+ private:
+  alignas(64) std::atomic<std::size_t> head_{0};
+  alignas(64) std::atomic<std::size_t> tail_{0};
+  std::array<slot, capacity> slots_{};
+};
+
+// Creates this thread's ring. Rings are never freed, so records left by an
+// exiting thread are still flushed.
+thread_ring* register_thread();
+
+inline thread_ring& local_ring() {
+  thread_local thread_ring* const mine = register_thread();
+  return *mine;
+}
+
+void count_dropped();
+void write_now(level lvl, std::uint32_t suppressed, std::string_view text);
+
+// Per call site limit on records per second. Window changes race harmlessly:
+// the limit is approximate, which is all it needs to be.
+struct call_site {
+  std::atomic<std::uint64_t> window{0};
+  std::atomic<std::uint32_t> in_window{0};
+  std::atomic<std::uint32_t> suppressed{0};
+
+  bool admit(std::uint32_t& suppressed_before) {
+    auto const limit = rate_limit.load(std::memory_order_relaxed);
+    if (limit == 0) return true;
+    auto const now = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    if (window.load(std::memory_order_relaxed) != now) {
+      window.store(now, std::memory_order_relaxed);
+      in_window.store(0, std::memory_order_relaxed);
+      suppressed_before = suppressed.exchange(0, std::memory_order_relaxed);
+    }
+    if (in_window.fetch_add(1, std::memory_order_relaxed) < limit) return true;
+    suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+};
+
+// Arguments are stored by value; anything string-like becomes a std::string
+// so the record does not point into the caller's frame.
+template <class T>
+using captured_t = std::
+    conditional_t<std::is_convertible_v<T, std::string_view>, std::string, std::decay_t<T>>;
+
+template <class Payload>
+void format_payload(void* payload, std::string& out) {
+  auto* stored = static_cast<Payload*>(payload);
+  std::apply(
+      [&out](std::string_view fmt, auto&... args) {
+        std::vformat_to(std::back_inserter(out), fmt, std::make_format_args(args...));
+      },
+      *stored);
+  stored->~Payload();
+}
+
+template <class... Args>
+void enqueue(level lvl, std::uint32_t suppressed, std::format_string<Args...> fmt, Args&&... args) {
+  if (!running.load(std::memory_order_acquire)) {
+    write_now(lvl, suppressed, std::format(fmt, std::forward<Args>(args)...));
+    return;
+  }
+  auto& ring = local_ring();
+  slot* s = ring.try_claim();
+  if (!s) {
+    count_dropped();
+    return;
+  }
+
+  using payload = std::tuple<std::string_view, captured_t<Args>...>;
+  constexpr bool fits =
+      payload_offset + sizeof(payload) <= slot_size && alignof(payload) <= slot_align;
+  if constexpr (fits) {
+    new (s->bytes) record_header{&format_payload<payload>, lvl, suppressed};
+    new (s->payload()) payload(fmt.get(), std::forward<Args>(args)...);
+  } else {
+    // Too big for a slot: format here and store the text.
+    using text_payload = std::tuple<std::string_view, std::string>;
+    new (s->bytes) record_header{&format_payload<text_payload>, lvl, suppressed};
+    new (s->payload()) text_payload("{}", std::format(fmt, std::forward<Args>(args)...));
+  }
+  ring.publish();
+}
+
+}  // namespace logging
+
+#define LOG_AT(lvl, ...)                                       \
+  do {                                                         \
+    if (::logging::enabled(lvl)) {                             \
+      static constinit ::logging::call_site log_site_;         \
+      std::uint32_t log_suppressed_ = 0;                       \
+      if (log_site_.admit(log_suppressed_)) {                  \
+        ::logging::enqueue(lvl, log_suppressed_, __VA_ARGS__); \
+      }                                                        \
+    }                                                          \
+  } while (false)
+
+#if LOG_ACTIVE_LEVEL <= LOG_LEVEL_TRACE
+#define LOG_TRACE(...) LOG_AT(::logging::level::trace, __VA_ARGS__)
+#else
+#define LOG_TRACE(...) ((void)0)
+#endif
+
+#if LOG_ACTIVE_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) LOG_AT(::logging::level::debug, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if LOG_ACTIVE_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) LOG_AT(::logging::level::info, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LOG_ACTIVE_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) LOG_AT(::logging::level::warn, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#if LOG_ACTIVE_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) LOG_AT(::logging::level::error, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+// Log-linear histogram in the spirit of HdrHistogram. Each power of two is
+// split into linear sub-buckets, so every recorded value is kept to within
+// 1 / 2^(sub_bucket_bits - 1) of its true value over the full 64-bit range
+// in a fixed 30 KiB of counters. Not thread-safe; record per thread and merge.
+class latency_histogram {
+ public:
+  static constexpr unsigned sub_bucket_bits = 7;
+  static constexpr std::size_t sub_bucket_count = std::size_t{1} << sub_bucket_bits;
+  static constexpr std::size_t half_count = sub_bucket_count / 2;
+  static constexpr std::size_t bucket_count =
+      sub_bucket_count + (64 - sub_bucket_bits) * half_count;
+
+  void record(std::uint64_t value) {
+    ++counts_[index_of(value)];
+    ++total_;
+    sum_ += value;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+
+  void merge(const latency_histogram& other) {
+    for (std::size_t i = 0; i < bucket_count; ++i) counts_[i] += other.counts_[i];
+    total_ += other.total_;
+    sum_ += other.sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+
+  std::uint64_t count() const { return total_; }
+  std::uint64_t min() const { return total_ ? min_ : 0; }
+  std::uint64_t max() const { return max_; }
+  double mean() const {
+    return total_ ? static_cast<double>(sum_) / static_cast<double>(total_) : 0;
+  }
+
+  // Smallest recorded value (to bucket precision) at or below which
+  // `percentile` percent of all values fall.
+  std::uint64_t percentile(double percentile) const {
+    if (total_ == 0) return 0;
+    auto const wanted = static_cast<std::uint64_t>(
+        std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * static_cast<double>(total_)));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < bucket_count; ++i) {
+      seen += counts_[i];
+      if (seen >= std::max<std::uint64_t>(wanted, 1)) return std::min(highest_in(i), max_);
+    }
+    return max_;
+  }
+
+  // Bucket layout, exposed for exporters that walk the raw counts.
+  static std::size_t index_of(std::uint64_t value) {
+    if (value < sub_bucket_count) return static_cast<std::size_t>(value);
+    unsigned const shift = static_cast<unsigned>(std::bit_width(value)) - sub_bucket_bits;
+    auto const sub = static_cast<std::size_t>(value >> shift);  // In [half_count, sub_bucket_count)
+    return sub_bucket_count + (shift - 1) * half_count + (sub - half_count);
+  }
+
+  static std::uint64_t highest_in(std::size_t index) {
+    if (index < sub_bucket_count) return index;
+    std::size_t const k = index - sub_bucket_count;
+    unsigned const shift = static_cast<unsigned>(k / half_count) + 1;
+    std::uint64_t const sub = k % half_count + half_count;
+    std::uint64_t const lowest = sub << shift;
+    std::uint64_t const width = std::uint64_t{1} << shift;
+    constexpr auto limit = std::numeric_limits<std::uint64_t>::max();
+    return lowest > limit - (width - 1) ? limit : lowest + width - 1;
+  }
+
+  std::uint64_t count_at(std::size_t index) const { return counts_[index]; }
+
+ private:
+  std::array<std::uint64_t, bucket_count> counts_{};
+  std::uint64_t total_ = 0;
+  std::uint64_t sum_ = 0;
+  std::uint64_t min_ = std::numeric_limits<std::uint64_t>::max();
+  std::uint64_t max_ = 0;
+};
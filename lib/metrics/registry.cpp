@@ -0,0 +1,227 @@
+#include "registry.hpp"
+
+#include <deque>
+#include <format>
+#include <iterator>
+#include <map>
+#include <mutex>
+
+namespace metrics {
+
+namespace {
+
+// Shards are only added, never removed; the mutex is taken once per thread
+// and on scrape, never while recording.
+std::mutex shards_mutex;
+std::deque<shard> shards;
+
+template <class Read>
+std::uint64_t total(Read read) {
+  std::uint64_t value = 0;
+  for (auto const& s : shards) value += read(s).load(std::memory_order_relaxed);
+  return value;
+}
+
+struct client_series {
+  std::uint64_t wait_ns = 0;
+  std::uint64_t waits = 0;
+  std::uint64_t throttled = 0;
+};
+
+std::mutex clients_mutex;
+std::map<std::string, client_series, std::less<>> clients;
+
+client_series& series_of(std::string_view client_id) {
+  auto it = clients.find(client_id);
+  if (it != clients.end()) return it->second;
+  if (clients.size() >= max_labelled_clients) client_id = "other";
+  return clients[std::string(client_id)];
+}
+
+// Client-Id is whatever the client sent; quotes and backslashes would end
+// the label value early.
+std::string escape_label(std::string_view value) {
+  std::string out;
+  for (char const c : value) {
+    if (c == '\\' || c == '"') out += '\\';
+    if (c == '\n') {
+      out += "\\n";
+      continue;
+    }
+    out += c;
+  }
+  return out;
+}
+
+}  // namespace
+
+void observe_queue_wait(std::string_view client_id, std::uint64_t ns) {
+  std::scoped_lock lock(clients_mutex);
+  auto& series = series_of(client_id);
+  series.wait_ns += ns;
+  ++series.waits;
+}
+
+void count_throttled(std::string_view client_id) {
+  std::scoped_lock lock(clients_mutex);
+  ++series_of(client_id).throttled;
+}
+
+shard* register_shard() {
+  std::scoped_lock lock(shards_mutex);
+  return &shards.emplace_back();
+}
+
+std::uint64_t counter_total(counter which) {
+  std::scoped_lock lock(shards_mutex);
+  auto const index = static_cast<std::size_t>(which);
+  return total([index](const shard& s) -> auto& { return s.counters[index]; });
+}
+
+content_kind classify_content_type(std::string_view content_type) {
+  if (content_type.empty()) return content_kind::none;
+  if (content_type.starts_with("multipart/form-data")) return content_kind::multipart;
+  if (content_type.starts_with("application/json")) return content_kind::json;
+  if (content_type.starts_with("application/xml")) return content_kind::xml;
+  if (content_type.starts_with("text/plain")) return content_kind::text;
+  return content_kind::other;
+}
+
+std::string render_prometheus() {
+  std::scoped_lock lock(shards_mutex);
+  std::string out;
+  auto emit = std::back_inserter(out);
+
+  auto counter_value = [](counter which) {
+    auto const index = static_cast<std::size_t>(which);
+    return total([index](const shard& s) -> auto& { return s.counters[index]; });
+  };
+
+  std::format_to(emit,
+      "# HELP log_connections_accepted_total Connections accepted.\n"
+      "# TYPE log_connections_accepted_total counter\n"
+      "log_connections_accepted_total {}\n",
+      counter_value(counter::connections_accepted));
+  // The shards are not summed at one instant, so a session that closes during
+  // the scrape can count as closed without having counted as opened. Reading
+  // the closed count first makes that rare; the clamp keeps the gauge from
+  // wrapping when it happens anyway.
+  auto const sessions_closed = counter_value(counter::sessions_closed);
+  auto const sessions_opened = counter_value(counter::sessions_opened);
+  std::format_to(emit,
+      "# HELP log_sessions_active Connections currently being served.\n"
+      "# TYPE log_sessions_active gauge\n"
+      "log_sessions_active {}\n",
+      sessions_opened > sessions_closed ? sessions_opened - sessions_closed : 0);
+  std::format_to(emit,
+      "# HELP log_bytes_read_total Request bytes read from clients.\n"
+      "# TYPE log_bytes_read_total counter\n"
+      "log_bytes_read_total {}\n",
+      counter_value(counter::bytes_read));
+  std::format_to(emit,
+      "# HELP log_bytes_written_total Response bytes written to clients.\n"
+      "# TYPE log_bytes_written_total counter\n"
+      "log_bytes_written_total {}\n",
+      counter_value(counter::bytes_written));
+  std::format_to(emit,
+      "# HELP log_shard_forwarded_total Uploads forwarded to the node owning their client.\n"
+      "# TYPE log_shard_forwarded_total counter\n"
+      "log_shard_forwarded_total {}\n",
+      counter_value(counter::requests_forwarded));
+  std::format_to(emit,
+      "# HELP log_shard_redirected_total Uploads redirected to the node owning their client.\n"
+      "# TYPE log_shard_redirected_total counter\n"
+      "log_shard_redirected_total {}\n",
+      counter_value(counter::requests_redirected));
+  std::format_to(emit,
+      "# HELP log_parts_deduplicated_total Uploaded parts whose content was already stored.\n"
+      "# TYPE log_parts_deduplicated_total counter\n"
+      "log_parts_deduplicated_total {}\n",
+      counter_value(counter::parts_deduplicated));
+  std::format_to(emit,
+      "# HELP log_analysis_cache_hits_total Uploaded parts whose analysis was cached.\n"
+      "# TYPE log_analysis_cache_hits_total counter\n"
+      "log_analysis_cache_hits_total {}\n",
+      counter_value(counter::analysis_cache_hits));
+  std::format_to(emit,
+      "# HELP log_handler_allocations_total Allocations by session read and write handlers.\n"
+      "# TYPE log_handler_allocations_total counter\n"
+      "log_handler_allocations_total {}\n",
+      counter_value(counter::handler_allocations));
+  std::format_to(emit,
+      "# HELP log_handler_heap_allocations_total Handler allocations that went to the heap.\n"
+      "# TYPE log_handler_heap_allocations_total counter\n"
+      "log_handler_heap_allocations_total {}\n",
+      counter_value(counter::handler_heap_allocations));
+
+  out += "# HELP log_requests_total Requests handled, by Content-Type.\n";
+  out += "# TYPE log_requests_total counter\n";
+  for (std::size_t kind = 0; kind < content_kind_names.size(); ++kind) {
+    std::format_to(emit,
+        "log_requests_total{{content_type=\"{}\"}} {}\n",
+        content_kind_names[kind],
+        total([kind](const shard& s) -> auto& { return s.requests[kind]; }));
+  }
+
+  out += "# HELP log_responses_total Responses sent, by status code.\n";
+  out += "# TYPE log_responses_total counter\n";
+  for (std::size_t status = 0; status < status_limit; ++status) {
+    auto const count = total([status](const shard& s) -> auto& { return s.responses[status]; });
+    if (count > 0) std::format_to(emit, "log_responses_total{{status=\"{}\"}} {}\n", status, count);
+  }
+
+  out += "# HELP log_stage_duration_seconds Time spent in each stage of request handling.\n";
+  out += "# TYPE log_stage_duration_seconds histogram\n";
+  for (std::size_t stage = 0; stage < request_stage_names.size(); ++stage) {
+    auto const name = request_stage_names[stage];
+    std::uint64_t cumulative = 0;
+    for (std::size_t bucket = 0; bucket < latency_bucket_count; ++bucket) {
+      cumulative += total(
+          [stage, bucket](const shard& s) -> auto& { return s.stages[stage].buckets[bucket]; });
+      std::string le = "+Inf";
+      if (bucket + 1 < latency_bucket_count) {
+        le = std::format("{}", static_cast<double>(std::uint64_t{1} << bucket) / 1e6);
+      }
+      std::format_to(emit,
+          "log_stage_duration_seconds_bucket{{stage=\"{}\",le=\"{}\"}} {}\n",
+          name,
+          le,
+          cumulative);
+    }
+    auto const sum_ns = total([stage](const shard& s) -> auto& { return s.stages[stage].sum_ns; });
+    auto const count = total([stage](const shard& s) -> auto& { return s.stages[stage].count; });
+    std::format_to(emit,
+        "log_stage_duration_seconds_sum{{stage=\"{}\"}} {}\n",
+        name,
+        static_cast<double>(sum_ns) / 1e9);
+    std::format_to(emit, "log_stage_duration_seconds_count{{stage=\"{}\"}} {}\n", name, count);
+  }
+
+  std::scoped_lock clients_lock(clients_mutex);
+  out += "# HELP log_client_queue_wait_seconds Time requests waited for a worker, by Client-Id.\n";
+  out += "# TYPE log_client_queue_wait_seconds summary\n";
+  for (auto const& [client_id, series] : clients) {
+    if (series.waits == 0) continue;
+    auto const label = escape_label(client_id);
+    std::format_to(emit,
+        "log_client_queue_wait_seconds_sum{{client=\"{}\"}} {}\n",
+        label,
+        static_cast<double>(series.wait_ns) / 1e9);
+    std::format_to(emit,
+        "log_client_queue_wait_seconds_count{{client=\"{}\"}} {}\n",
+        label,
+        series.waits);
+  }
+  out += "# HELP log_client_throttled_total Requests refused with 429, by Client-Id.\n";
+  out += "# TYPE log_client_throttled_total counter\n";
+  for (auto const& [client_id, series] : clients) {
+    if (series.throttled == 0) continue;
+    std::format_to(emit,
+        "log_client_throttled_total{{client=\"{}\"}} {}\n",
+        escape_label(client_id),
+        series.throttled);
+  }
+  return out;
+}
+
+}  // namespace metrics
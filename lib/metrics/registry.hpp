@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Stages of request handling: the body read in the session, then the POST
+// pipeline in handle_request.
+enum class request_stage : std::size_t {
+  read,
+  split,
+  save,
+  parse_json,
+  parse_xml,
+  parse_text,
+  merge,
+  select,  // Top-N and paging of the merged result
+  serialize,
+};
+
+inline constexpr std::array<std::string_view, 9> request_stage_names{"read",
+    "split",
+    "save",
+    "parse_json",
+    "parse_xml",
+    "parse_text",
+    "merge",
+    "select",
+    "serialize"};
+
+// Server-wide counters and stage latency histograms. Every thread records into
+// its own shard with plain relaxed loads and stores, so recording takes no
+// locks and no read-modify-write instructions; a scrape walks all shards and
+// sums them.
+namespace metrics {
+
+enum class counter : std::size_t {
+  connections_accepted,
+  sessions_opened,
+  sessions_closed,
+  bytes_read,
+  bytes_written,
+  requests_forwarded,
+  requests_redirected,
+  parts_deduplicated,
+  analysis_cache_hits,
+  handler_allocations,
+  handler_heap_allocations,
+};
+inline constexpr std::size_t counter_count = 11;
+
+enum class content_kind : std::size_t { multipart, json, xml, text, other, none };
+inline constexpr std::array<std::string_view, 6> content_kind_names{
+    "multipart", "json", "xml", "text", "other", "none"};
+
+inline constexpr std::size_t status_limit = 600;
+
+// Bucket i holds durations up to 2^i microseconds; the last one is +Inf.
+inline constexpr std::size_t latency_bucket_count = 26;
+
+struct shard {
+  struct histogram {
+    std::array<std::atomic<std::uint64_t>, latency_bucket_count> buckets{};
+    std::atomic<std::uint64_t> sum_ns{0};
+    std::atomic<std::uint64_t> count{0};
+  };
+
+  std::array<std::atomic<std::uint64_t>, counter_count> counters{};
+  std::array<std::atomic<std::uint64_t>, content_kind_names.size()> requests{};
+  std::array<std::atomic<std::uint64_t>, status_limit> responses{};  // By status code
+  std::array<histogram, request_stage_names.size()> stages{};
+};
+
+// Creates this thread's shard. It is never freed, so counts survive the thread.
+shard* register_shard();
+
+inline shard& local_shard() {
+  thread_local shard* const mine = register_shard();
+  return *mine;
+}
+
+// Only the owning thread writes a shard, so a load and a store are enough.
+inline void bump(std::atomic<std::uint64_t>& value, std::uint64_t n) {
+  value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline void add(counter which, std::uint64_t n = 1) {
+  bump(local_shard().counters[static_cast<std::size_t>(which)], n);
+}
+
+inline void count_request(content_kind kind) {
+  bump(local_shard().requests[static_cast<std::size_t>(kind)], 1);
+}
+
+inline void count_response(unsigned status) {
+  if (status < status_limit) bump(local_shard().responses[status], 1);
+}
+
+inline void observe(request_stage stage, std::uint64_t ns) {
+  auto& h = local_shard().stages[static_cast<std::size_t>(stage)];
+  std::uint64_t const us = ns / 1000;
+  std::size_t bucket = 0;
+  while (bucket + 1 < latency_bucket_count && us > (std::uint64_t{1} << bucket)) ++bucket;
+  bump(h.buckets[bucket], 1);
+  bump(h.sum_ns, ns);
+  bump(h.count, 1);
+}
+
+content_kind classify_content_type(std::string_view content_type);
+
+// Per-client series take a lock, unlike the rest; they are recorded once per
+// request. Clients past the first max_labelled_clients share one series.
+inline constexpr std::size_t max_labelled_clients = 256;
+
+// Time a request waited in the fair queue before a worker took it.
+void observe_queue_wait(std::string_view client_id, std::uint64_t ns);
+// A request refused with 429 Too Many Requests.
+void count_throttled(std::string_view client_id);
+
+// One counter summed over all shards.
+std::uint64_t counter_total(counter which);
+
+// All shards merged, in the Prometheus text exposition format.
+std::string render_prometheus();
+
+}  // namespace metrics
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "registry.hpp"
+
+// One timed run of a stage.
+struct stage_span {
+  request_stage stage = request_stage::read;
+  std::chrono::steady_clock::time_point start{};
+  std::uint64_t ns = 0;
+};
+
+// Time spent per stage, for one request or summed over many.
+struct stage_timings {
+  std::array<std::uint64_t, request_stage_names.size()> ns{};
+  std::array<std::uint64_t, request_stage_names.size()> calls{};
+  std::vector<stage_span>* spans = nullptr;  // Also keeps every span when set
+
+  void record(const stage_span& span) {
+    if (span.start == std::chrono::steady_clock::time_point{}) return;  // Never timed
+    ns[static_cast<std::size_t>(span.stage)] += span.ns;
+    ++calls[static_cast<std::size_t>(span.stage)];
+    if (spans) spans->push_back(span);
+  }
+
+  void add(const stage_timings& other) {
+    for (std::size_t i = 0; i < ns.size(); ++i) {
+      ns[i] += other.ns[i];
+      calls[i] += other.calls[i];
+    }
+  }
+};
+
+// Sink that stage timers on this thread also report to, if any.
+inline thread_local stage_timings* active_stage_timings = nullptr;
+
+// Makes `timings` this thread's sink for the scope; on the way out its totals
+// are added to the sink it replaced, so sinks nest.
+class scoped_stage_sink {
+ public:
+  explicit scoped_stage_sink(stage_timings& timings)
+      : timings_(timings), outer_(active_stage_timings) {
+    active_stage_timings = &timings_;
+  }
+  scoped_stage_sink(const scoped_stage_sink&) = delete;
+  scoped_stage_sink& operator=(const scoped_stage_sink&) = delete;
+  ~scoped_stage_sink() {
+    active_stage_timings = outer_;
+    if (outer_) outer_->add(timings_);
+  }
+
+ private:
+  stage_timings& timings_;
+  stage_timings* outer_;
+};
+
+// Times from construction until stop() or destruction, whichever is first,
+// into the stage latency histogram and the thread's sink if one is installed.
+class stage_timer {
+ public:
+  explicit stage_timer(request_stage stage)
+      : stage_(stage), sink_(active_stage_timings), started_(std::chrono::steady_clock::now()) {}
+  stage_timer(const stage_timer&) = delete;
+  stage_timer& operator=(const stage_timer&) = delete;
+  ~stage_timer() { stop(); }
+
+  // Returns the span once; later calls return an empty span.
+  stage_span stop() {
+    if (stopped_) return {};
+    stopped_ = true;
+    auto const elapsed = std::chrono::steady_clock::now() - started_;
+    auto const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    stage_span const span{stage_, started_, static_cast<std::uint64_t>(ns)};
+    metrics::observe(stage_, span.ns);
+    if (sink_) sink_->record(span);
+    return span;
+  }
+
+ private:
+  request_stage stage_;
+  stage_timings* sink_;
+  std::chrono::steady_clock::time_point started_;
+  bool stopped_ = false;
+};
@@ -0,0 +1,140 @@
+#include "trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <format>
+#include <iterator>
+#include <mutex>
+#include <print>
+
+namespace trace {
+
+namespace {
+
+// Timestamps are microseconds since tracing started.
+std::chrono::steady_clock::time_point epoch;
+double rate = 0;
+std::atomic<std::uint64_t> next_request{0};
+std::atomic<unsigned> next_thread{0};
+
+// Only sampled requests take the lock.
+std::mutex file_mutex;
+std::FILE* file = nullptr;
+bool first_event = true;
+
+double since_epoch_us(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration<double, std::micro>(t - epoch).count();
+}
+
+unsigned thread_number() {
+  thread_local unsigned const number = next_thread.fetch_add(1, std::memory_order_relaxed) + 1;
+  return number;
+}
+
+// JSON string escaping for the few values taken from the request.
+std::string escape(std::string_view text) {
+  std::string out;
+  for (char c : text) {
+    if (c == '"' || c == '\\') out += '\\';
+    if (static_cast<unsigned char>(c) < 0x20) continue;
+    out += c;
+  }
+  return out;
+}
+
+}  // namespace
+
+bool open(const std::string& path, double sample_rate) {
+  std::scoped_lock lock(file_mutex);
+  file = std::fopen(path.c_str(), "w");
+  if (!file) {
+    std::println(stderr, "[ERROR] Cannot open trace file {}", path);
+    return false;
+  }
+  // Viewers accept the array without its closing "]", so a trace cut off by
+  // a crash still loads.
+  std::fputs("[\n", file);
+  first_event = true;
+  epoch = std::chrono::steady_clock::now();
+  rate = std::clamp(sample_rate, 0.0, 1.0);
+  enabled.store(rate > 0, std::memory_order_release);
+  return true;
+}
+
+void close() {
+  enabled.store(false, std::memory_order_relaxed);
+  std::scoped_lock lock(file_mutex);
+  if (!file) return;
+  std::fputs("\n]\n", file);
+  std::fclose(file);
+  file = nullptr;
+}
+
+bool sample_slow() {
+  // xorshift per thread: sampling must not contend on shared state.
+  thread_local std::uint64_t state = 0x9e3779b97f4a7c15 ^ (std::uint64_t{thread_number()} << 32);
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return static_cast<double>(state >> 11) * 0x1.0p-53 < rate;
+}
+
+void write(std::string_view name,
+    std::string_view client_id,
+    const std::vector<stage_span>& spans) {
+  if (spans.empty()) return;
+
+  auto const first = std::ranges::min_element(spans, {}, &stage_span::start)->start;
+  auto last = first;
+  for (auto const& span : spans) {
+    last = std::max(last, span.start + std::chrono::nanoseconds(span.ns));
+  }
+
+  std::uint64_t const id = next_request.fetch_add(1, std::memory_order_relaxed) + 1;
+  unsigned const tid = thread_number();
+  std::string events;
+  auto out = std::back_inserter(events);
+  std::format_to(out,
+      R"({{"name":"{}","ph":"X","ts":{:.3f},"dur":{:.3f},"pid":1,"tid":{},)"
+      R"("args":{{"request":{},"client_id":"{}"}}}})",
+      escape(name),
+      since_epoch_us(first),
+      std::chrono::duration<double, std::micro>(last - first).count(),
+      tid,
+      id,
+      escape(client_id));
+  for (auto const& span : spans) {
+    events += ",\n";
+    std::format_to(out,
+        R"({{"name":"{}","ph":"X","ts":{:.3f},"dur":{:.3f},"pid":1,"tid":{},)"
+        R"("args":{{"request":{}}}}})",
+        request_stage_names[static_cast<std::size_t>(span.stage)],
+        since_epoch_us(span.start),
+        static_cast<double>(span.ns) / 1000,
+        tid,
+        id);
+  }
+
+  std::scoped_lock lock(file_mutex);
+  if (!file) return;
+  if (!first_event) std::fputs(",\n", file);
+  first_event = false;
+  std::fwrite(events.data(), 1, events.size(), file);
+}
+
+std::string server_timing(const stage_timings& timings) {
+  std::string value;
+  for (std::size_t i = 0; i < request_stage_names.size(); ++i) {
+    if (timings.calls[i] == 0) continue;
+    std::format_to(std::back_inserter(value),
+        "{}{};dur={:.3f}",
+        value.empty() ? "" : ", ",
+        request_stage_names[i],
+        static_cast<double>(timings.ns[i]) / 1e6);
+  }
+  return value;
+}
+
+}  // namespace trace
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "stage_timer.hpp"
+
+// Sampled request traces in the Chrome trace-event format, viewable in
+// chrome://tracing or Perfetto. When tracing is off the only per-request
+// cost is one atomic load in should_sample().
+namespace trace {
+
+inline std::atomic<bool> enabled{false};
+
+// Starts writing sampled requests to `path`; `sample_rate` is in [0, 1].
+bool open(const std::string& path, double sample_rate);
+void close();
+
+bool sample_slow();
+
+inline bool should_sample() {
+  return enabled.load(std::memory_order_acquire) && sample_slow();
+}
+
+// Writes one request as a parent span with a child span per stage.
+void write(std::string_view name, std::string_view client_id, const std::vector<stage_span>& spans);
+
+// Server-Timing header value for the stages this request went through.
+std::string server_timing(const stage_timings& timings);
+
+// Sets Server-Timing on `res` from the stages timed so far into this thread's
+// sink, which handle_request installs for each request. Without a sink, or
+// before any stage was timed, the header is left out.
+template <class Message>
+void add_server_timing(Message& res) {
+  if (!active_stage_timings) return;
+  auto value = server_timing(*active_stage_timings);
+  if (!value.empty()) res.set("Server-Timing", value);
+}
+
+}  // namespace trace
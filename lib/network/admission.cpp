@@ -0,0 +1,313 @@
+#include "admission.hpp"
+
+#include <boost/asio/post.hpp>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "../log/logger.hpp"
+#include "../metrics/registry.hpp"
+
+namespace admission {
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+// Clients that have sent nothing for this long forget their buckets, which
+// a full bucket does not miss.
+constexpr auto idle_timeout = std::chrono::minutes(10);
+constexpr auto sweep_interval = std::chrono::minutes(1);
+
+client_limits const unlimited{};
+
+std::mutex policy_mutex;
+std::shared_ptr<policy const> current_policy;
+
+std::shared_ptr<policy const> rules() {
+  std::scoped_lock lock(policy_mutex);
+  return current_policy;
+}
+
+struct bucket {
+  double tokens = 0;  // Negative while in debt
+  clock::time_point refilled{};
+  bool started = false;
+
+  // Adds what accrued since the last refill; a new bucket starts full.
+  void refill(double rate, double burst, clock::time_point now) {
+    if (!started) {
+      tokens = burst;
+      started = true;
+    } else {
+      auto const elapsed = std::chrono::duration<double>(now - refilled).count();
+      tokens = std::min(burst, tokens + rate * elapsed);
+    }
+    refilled = now;
+  }
+};
+
+struct client_buckets {
+  bucket requests;
+  bucket bytes;
+  clock::time_point last_used;
+};
+
+std::mutex buckets_mutex;
+cluster::string_map<client_buckets> buckets;
+clock::time_point last_sweep;
+
+client_buckets& buckets_of(std::string_view client_id, clock::time_point now) {
+  if (now - last_sweep >= sweep_interval) {
+    last_sweep = now;
+    std::erase_if(buckets,
+        [now](auto const& entry) { return now - entry.second.last_used > idle_timeout; });
+  }
+  auto it = buckets.find(client_id);
+  if (it == buckets.end()) it = buckets.try_emplace(std::string(client_id)).first;
+  it->second.last_used = now;
+  return it->second;
+}
+
+std::chrono::milliseconds to_wait(double seconds) {
+  return std::chrono::milliseconds(static_cast<std::int64_t>(std::ceil(seconds * 1000)));
+}
+
+// A weighted fair queue, self-clocked: the virtual time is the finish tag of
+// the job started last, and a client's next job is tagged from there or from
+// its own previous tag, whichever is later.
+struct queued {
+  double finish;
+  std::uint64_t order;  // Breaks ties in arrival order
+  std::string client_id;
+  clock::time_point queued_at;
+  asio::any_io_executor executor;
+  job work;
+};
+
+struct runs_later {
+  bool operator()(queued const& a, queued const& b) const {
+    return a.finish != b.finish ? a.finish > b.finish : a.order > b.order;
+  }
+};
+
+std::mutex queue_mutex;
+std::vector<queued> waiting;  // A heap; the front runs next
+cluster::string_map<double> last_finish;
+double virtual_time = 0;
+std::uint64_t next_order = 0;
+std::size_t running = 0;
+std::size_t max_running = 1;
+
+void finished();
+
+// Starts waiting jobs while workers are free. Called with queue_mutex held.
+void dispatch() {
+  while (running < max_running && !waiting.empty()) {
+    std::pop_heap(waiting.begin(), waiting.end(), runs_later{});
+    auto next = std::move(waiting.back());
+    waiting.pop_back();
+    virtual_time = next.finish;
+    ++running;
+    std::chrono::nanoseconds const waited = clock::now() - next.queued_at;
+    metrics::observe_queue_wait(next.client_id, static_cast<std::uint64_t>(waited.count()));
+    asio::post(next.executor, [work = std::move(next.work)]() mutable {
+      struct release {
+        ~release() { finished(); }
+      } done;
+      work();
+    });
+  }
+  // Tags are started in increasing order, so once nothing waits every
+  // client's last tag is behind the virtual time and can be forgotten.
+  if (waiting.empty()) last_finish.clear();
+}
+
+void finished() {
+  std::scoped_lock lock(queue_mutex);
+  --running;
+  dispatch();
+}
+
+// `text` with an optional K, M or G suffix, in bytes.
+bool parse_amount(std::string_view text, double& value) {
+  double scale = 1;
+  if (!text.empty()) {
+    switch (text.back()) {
+      case 'K': scale = 1 << 10; break;
+      case 'M': scale = 1 << 20; break;
+      case 'G': scale = 1 << 30; break;
+      default: break;
+    }
+    if (scale != 1) text.remove_suffix(1);
+  }
+  auto const [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+  value *= scale;
+  return ec == std::errc{} && end == text.data() + text.size() && value >= 0;
+}
+
+bool parse_limit(std::string_view field, client_limits& limits) {
+  auto const equals = field.find('=');
+  if (equals == std::string_view::npos) return false;
+  auto const key = field.substr(0, equals);
+  auto const value = field.substr(equals + 1);
+  if (key == "requests") return parse_amount(value, limits.requests_per_second);
+  if (key == "request-burst") {
+    return parse_amount(value, limits.request_burst) && limits.request_burst >= 1;
+  }
+  if (key == "bytes") return parse_amount(value, limits.bytes_per_second);
+  if (key == "byte-burst") return parse_amount(value, limits.byte_burst);
+  if (key == "weight") {
+    return parse_amount(value, limits.weight) && limits.weight >= 0.01 && limits.weight <= 1000;
+  }
+  return false;
+}
+
+}  // namespace
+
+client_limits const& policy::limits(std::string_view client_id) const {
+  auto const it = clients.find(client_id);
+  return it == clients.end() ? defaults : it->second;
+}
+
+std::optional<policy> load_policy(std::filesystem::path const& path) {
+  std::ifstream file(path);
+  if (!file) {
+    LOG_ERROR("Cannot open limits file {}", path.string());
+    return std::nullopt;
+  }
+
+  policy loaded;
+  bool has_defaults = false;
+  std::string line;
+  for (std::size_t number = 1; std::getline(file, line); ++number) {
+    if (auto const hash = line.find('#'); hash != std::string::npos) line.erase(hash);
+    std::istringstream fields(line);
+    std::string id, field;
+    if (!(fields >> id)) continue;
+
+    client_limits limits;
+    bool valid = true;
+    while (valid && fields >> field) valid = parse_limit(field, limits);
+    bool const repeated = id == "*" ? has_defaults : loaded.clients.contains(id);
+    if (!valid || repeated) {
+      LOG_ERROR("{}:{}: expected `id key=value...` once per id, with keys requests, "
+          "request-burst, bytes, byte-burst and weight",
+          path.string(),
+          number);
+      return std::nullopt;
+    }
+    if (limits.request_burst == 0) limits.request_burst = std::max(1.0, limits.requests_per_second);
+    if (limits.byte_burst == 0) limits.byte_burst = limits.bytes_per_second;
+
+    if (id == "*") {
+      loaded.defaults = limits;
+      has_defaults = true;
+    } else {
+      loaded.clients.emplace(std::move(id), limits);
+    }
+  }
+  return loaded;
+}
+
+std::chrono::milliseconds admit(std::string_view client_id, std::uint64_t bytes) {
+  auto const snapshot = rules();
+  auto const& limits = snapshot ? snapshot->limits(client_id) : unlimited;
+  if (limits.requests_per_second == 0 && limits.bytes_per_second == 0) return {};
+
+  auto const now = clock::now();
+  std::scoped_lock lock(buckets_mutex);
+  auto& state = buckets_of(client_id, now);
+  double wait = 0;
+  if (limits.requests_per_second > 0) {
+    state.requests.refill(limits.requests_per_second, limits.request_burst, now);
+    if (state.requests.tokens < 1) {
+      wait = (1 - state.requests.tokens) / limits.requests_per_second;
+    }
+  } else {
+    state.requests.started = false;
+  }
+  // A body larger than the burst could never fit; it waits for a full
+  // bucket instead, and the debt it leaves holds back what follows.
+  double const needed = std::min(static_cast<double>(bytes), limits.byte_burst);
+  if (limits.bytes_per_second > 0) {
+    state.bytes.refill(limits.bytes_per_second, limits.byte_burst, now);
+    if (state.bytes.tokens < needed) {
+      wait = std::max(wait, (needed - state.bytes.tokens) / limits.bytes_per_second);
+    }
+  } else {
+    state.bytes.started = false;
+  }
+  if (wait > 0) return std::max(to_wait(wait), std::chrono::milliseconds(1));
+
+  state.requests.tokens -= 1;
+  state.bytes.tokens -= static_cast<double>(bytes);
+  return {};
+}
+
+std::chrono::milliseconds charge(std::string_view client_id, std::uint64_t bytes) {
+  auto const snapshot = rules();
+  auto const& limits = snapshot ? snapshot->limits(client_id) : unlimited;
+  if (limits.bytes_per_second == 0) return {};
+
+  auto const now = clock::now();
+  std::scoped_lock lock(buckets_mutex);
+  auto& state = buckets_of(client_id, now);
+  state.bytes.refill(limits.bytes_per_second, limits.byte_burst, now);
+  state.bytes.tokens -= static_cast<double>(bytes);
+  if (state.bytes.tokens >= 0) return {};
+  return to_wait(-state.bytes.tokens / limits.bytes_per_second);
+}
+
+void set_workers(std::size_t workers) {
+  std::scoped_lock lock(queue_mutex);
+  max_running = std::max<std::size_t>(1, workers);
+}
+
+void submit(asio::any_io_executor const& executor,
+    std::string_view client_id,
+    std::uint64_t cost,
+    job work) {
+  auto const snapshot = rules();
+  double const weight = snapshot ? snapshot->limits(client_id).weight : 1;
+
+  std::scoped_lock lock(queue_mutex);
+  auto it = last_finish.find(client_id);
+  if (it == last_finish.end()) it = last_finish.try_emplace(std::string(client_id), 0.0).first;
+  double const start = std::max(virtual_time, it->second);
+  it->second = start + static_cast<double>(std::max<std::uint64_t>(cost, 1)) / weight;
+  waiting.push_back(
+      {it->second, next_order++, it->first, clock::now(), executor, std::move(work)});
+  std::push_heap(waiting.begin(), waiting.end(), runs_later{});
+  dispatch();
+}
+
+policy_watcher::policy_watcher(asio::io_context& ioc, std::filesystem::path path)
+    : watcher_(ioc, std::move(path), "limits", [this](auto const& file) { return reload(file); }) {}
+
+bool policy_watcher::reload(std::filesystem::path const& path) {
+  auto loaded = load_policy(path);
+  if (!loaded) return false;
+
+  auto next = std::make_shared<policy const>(std::move(*loaded));
+  bool first = false;
+  {
+    std::scoped_lock lock(policy_mutex);
+    first = current_policy == nullptr;
+    current_policy = next;
+  }
+  LOG_INFO("{} per-client limits from {}: {} clients besides the default",
+      first ? "Loaded" : "Reloaded",
+      path.string(),
+      next->clients.size());
+  return true;
+}
+
+}  // namespace admission
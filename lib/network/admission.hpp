@@ -0,0 +1,91 @@
+#pragma once
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "../cluster/aggregate.hpp"
+#include "../file/watcher.hpp"
+
+namespace asio = boost::asio;
+
+// Per-Client-Id admission: token buckets on the requests and body bytes a
+// client uploads, and a weighted fair queue in front of the worker pool, so
+// one client sending a huge file neither exhausts the node nor makes small
+// uploads from others wait behind it.
+namespace admission {
+
+// A rate of 0 means no limit.
+struct client_limits {
+  double requests_per_second = 0;
+  double request_burst = 0;  // Requests a client may send at once
+  double bytes_per_second = 0;
+  double byte_burst = 0;  // Body bytes a client may send at once
+  double weight = 1;      // Share of the worker pool while others wait too
+};
+
+struct policy {
+  client_limits defaults;  // The `*` line
+  cluster::string_map<client_limits> clients;
+
+  client_limits const& limits(std::string_view client_id) const;
+};
+
+// Reads a limits file: one client per line as `id key=value...`, `*` for
+// every client without a line of its own, and `#` comments and blank lines
+// ignored. Keys are `requests` and `bytes` per second, `request-burst`,
+// `byte-burst` and `weight`; byte amounts may end in K, M or G. A burst left
+// out is one second's worth. Problems are logged and give nothing.
+std::optional<policy> load_policy(std::filesystem::path const& path);
+
+// Charges one request with a body of `bytes` to the client's buckets. A body
+// larger than the burst is let through once the bucket is full and leaves
+// it in debt. Returns how long the client should wait before retrying, or
+// zero if the request was admitted; nothing is charged then.
+std::chrono::milliseconds admit(std::string_view client_id, std::uint64_t bytes);
+
+// Charges body bytes whose length was not known when the request was
+// admitted. Returns how long reading more from the client should pause for
+// the bucket to be out of debt again.
+std::chrono::milliseconds charge(std::string_view client_id, std::uint64_t bytes);
+
+// Parse jobs waiting for a worker are run in weighted fair order: each
+// client's jobs are tagged with a virtual finish time that grows with their
+// cost (bytes) divided by the client's weight, and the smallest tag runs
+// next. At most `workers` jobs run at once; the rest of the pool stays free
+// for connections.
+void set_workers(std::size_t workers);
+
+using job = std::move_only_function<void()>;
+
+// Runs `work` on `executor` when its turn comes.
+void submit(asio::any_io_executor const& executor,
+    std::string_view client_id,
+    std::uint64_t cost,
+    job work);
+
+// Loads the limits file and re-reads it whenever its modification time
+// changes. A file that fails to parse keeps the previous limits in place.
+class policy_watcher {
+ public:
+  policy_watcher(asio::io_context& ioc, std::filesystem::path path);
+  policy_watcher(const policy_watcher&) = delete;
+  policy_watcher& operator=(const policy_watcher&) = delete;
+
+  // Returns false if the file cannot be loaded.
+  bool start() { return watcher_.start(); }
+
+ private:
+  bool reload(std::filesystem::path const& path);
+
+  file_watcher watcher_;
+};
+
+}  // namespace admission
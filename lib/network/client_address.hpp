@@ -0,0 +1,23 @@
+#pragma once
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <string>
+
+// Printable identity of a connected peer, resolved once per connection. TCP
+// peers are reported by address and port; UNIX domain socket peers have
+// neither, so they are reported as "local".
+struct client_address {
+  std::string ip;
+  std::string port;
+};
+
+inline client_address to_client_address(const boost::asio::ip::tcp::endpoint& endpoint) {
+  return {endpoint.address().to_string(), std::to_string(endpoint.port())};
+}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+inline client_address to_client_address(const boost::asio::local::stream_protocol::endpoint&) {
+  return {"local", "0"};
+}
+#endif
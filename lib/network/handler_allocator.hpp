@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+#include "../metrics/registry.hpp"
+
+// Per-connection storage for asynchronous handler allocations. A session has at
+// most one read and one write in flight, so each keeps a block that every
+// operation of that kind reuses instead of going back to the heap. Every
+// allocation is counted, and those that miss the block are counted again, so
+// /metrics shows how many handler allocations per request reach the heap.
+class handler_memory {
+ public:
+  handler_memory() = default;
+  handler_memory(const handler_memory&) = delete;
+  handler_memory& operator=(const handler_memory&) = delete;
+
+  void* allocate(std::size_t size) {
+    metrics::add(metrics::counter::handler_allocations);
+    if (size <= storage_.size() && !in_use_.exchange(true, std::memory_order_acquire)) {
+      return storage_.data();
+    }
+    metrics::add(metrics::counter::handler_heap_allocations);
+    return ::operator new(size);
+  }
+
+  void deallocate(void* pointer) {
+    if (pointer == storage_.data()) {
+      in_use_.store(false, std::memory_order_release);
+      return;
+    }
+    ::operator delete(pointer);
+  }
+
+ private:
+  alignas(std::max_align_t) std::array<std::byte, 2048> storage_{};
+  std::atomic<bool> in_use_{false};
+};
+
+// Minimal allocator that hands out blocks from a handler_memory. Bound to a
+// completion token with asio::bind_allocator.
+template <class T>
+class handler_allocator {
+ public:
+  using value_type = T;
+
+  explicit handler_allocator(handler_memory& memory) noexcept : memory_(&memory) {}
+
+  template <class U>
+  handler_allocator(const handler_allocator<U>& other) noexcept : memory_(other.memory_) {}
+
+  bool operator==(const handler_allocator& other) const noexcept {
+    return memory_ == other.memory_;
+  }
+
+  T* allocate(std::size_t n) const { return static_cast<T*>(memory_->allocate(sizeof(T) * n)); }
+
+  void deallocate(T* pointer, std::size_t) const { memory_->deallocate(pointer); }
+
+ private:
+  template <class>
+  friend class handler_allocator;
+
+  handler_memory* memory_;
+};
@@ -1,15 +1,23 @@
 #include "listener.hpp"
 
+#include <boost/asio/as_tuple.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
 #include <boost/asio/strand.hpp>
-#include <print>
+#include <boost/asio/use_awaitable.hpp>
+#include <filesystem>
+#include <type_traits>
 
+#include "../log/logger.hpp"
+#include "../metrics/registry.hpp"
 #include "session.hpp"
 
 //------------------------------------------------------------------------------
 
 // Constructor implementation for the listener class
-listener::listener(asio::io_context& ioc,
-    tcp::endpoint endpoint,
+template <class Protocol>
+basic_listener<Protocol>::basic_listener(asio::io_context& ioc,
+    endpoint_type endpoint,
     std::shared_ptr<std::string const> const& doc_root)
     : ioc_(ioc), acceptor_(asio::make_strand(ioc)), doc_root_(doc_root) {
   beast::error_code ec;
@@ -21,11 +29,17 @@ listener::listener(asio::io_context& ioc,
     return;
   }
 
-  // Allow address reuse
-  boost::ignore_unused(acceptor_.set_option(asio::socket_base::reuse_address(true), ec));
-  if (ec) {
-    fail(ec, "set_option");
-    return;
+  if constexpr (std::is_same_v<Protocol, tcp>) {
+    // Allow address reuse
+    boost::ignore_unused(acceptor_.set_option(asio::socket_base::reuse_address(true), ec));
+    if (ec) {
+      fail(ec, "set_option");
+      return;
+    }
+  } else {
+    // A socket file left behind by a previous run would make bind fail
+    std::error_code remove_ec;
+    std::filesystem::remove(endpoint.path(), remove_ec);
   }
 
   // Bind to the server address
@@ -34,7 +48,7 @@ listener::listener(asio::io_context& ioc,
     fail(ec, "bind");
     return;
   }
-  std::println("[INFO] Waiting for connection...");
+  LOG_INFO("Waiting for connection...");
   // Start listening for connections
   boost::ignore_unused(acceptor_.listen(asio::socket_base::max_listen_connections, ec));
 
@@ -45,44 +59,58 @@ listener::listener(asio::io_context& ioc,
 }
 
 // Start accepting incoming connections
-void listener::run() { do_accept(); }
-
-void listener::do_accept() {
-  // The new connection gets its own strand
-  acceptor_.async_accept(asio::make_strand(ioc_),
-      beast::bind_front_handler(&listener::on_accept, shared_from_this()));
+template <class Protocol>
+void basic_listener<Protocol>::run() {
+  asio::co_spawn(acceptor_.get_executor(),
+      [self = this->shared_from_this()] { return self->do_accept(); },
+      asio::detached);
 }
 
-void listener::on_accept(beast::error_code ec, tcp::socket socket) {
-  if (ec) {
-    fail(ec, "accept");
-    return;  // To avoid infinite loop
-  } else {
-    // Store the client IP address
-    set_client_ip(get_socket_ip_and_port(socket)[0]);
-    std::println("\n[INFO] Client connected. IP: {}, PORT: {}",
-        get_socket_ip_and_port(socket)[0],
-        get_socket_ip_and_port(socket)[1]);
-
-    // Create the session and run it
-    std::make_shared<session>(std::move(socket), doc_root_)->run();
+template <class Protocol>
+asio::awaitable<void> basic_listener<Protocol>::do_accept() {
+  for (;;) {
+    // The new connection gets its own strand
+    auto [ec, socket] = co_await acceptor_.async_accept(asio::make_strand(ioc_),
+        asio::as_tuple(asio::use_awaitable));
+    if (ec) {
+      fail(ec, "accept");
+      co_return;  // To avoid infinite loop
+    }
+    on_accept(std::move(socket));
   }
-
-  // Accept another connection
-  do_accept();
 }
 
-std::array<std::string, 2> listener::get_socket_ip_and_port(tcp::socket& socket) {
-  // Get the remote endpoint
-  auto remote_endpoint = socket.remote_endpoint();
-
-  // Convert the IP address to a string
-  std::string ip_address = remote_endpoint.address().to_string();
-  std::string port = std::to_string(remote_endpoint.port());
+template <class Protocol>
+void basic_listener<Protocol>::on_accept(socket_type socket) {
+  metrics::add(metrics::counter::connections_accepted);
+
+  // Create the session and run it on the connection's strand. The spawned
+  // function object owns the session for as long as the coroutine runs.
+  auto executor = socket.get_executor();
+  auto new_session =
+      std::make_unique<basic_session<Protocol>>(std::move(socket), doc_root_, ioc_.get_executor());
+
+  client_address const& client = new_session->client();
+  LOG_INFO("Client connected. IP: {}, PORT: {}", client.ip, client.port);
+
+  asio::co_spawn(executor,
+      [s = std::move(new_session)] { return s->run(); },
+      [](std::exception_ptr error) {
+        if (!error) return;
+        try {
+          std::rethrow_exception(error);
+        } catch (const std::exception& e) {
+          LOG_ERROR("Session: {}", e.what());
+        }
+      });
+}
 
-  return {ip_address, port};
+template <class Protocol>
+void basic_listener<Protocol>::fail(beast::error_code ec, char const* what) {
+  LOG_ERROR("{}: {}", what, ec.message());
 }
 
-void listener::fail(beast::error_code ec, char const* what) {
-  std::println("{}: {}", what, ec.message());
-}
\ No newline at end of file
+template class basic_listener<tcp>;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+template class basic_listener<asio::local::stream_protocol>;
+#endif
@@ -1,7 +1,8 @@
 #pragma once
 
-#include <array>
+#include <boost/asio/awaitable.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
 #include <memory>
@@ -11,25 +12,35 @@ namespace asio = boost::asio;
 using tcp = boost::asio::ip::tcp;
 namespace beast = boost::beast;
 
-class listener : public std::enable_shared_from_this<listener> {
+// Accepts stream connections of the given protocol and runs a session for
+// each. Instantiated for TCP and, where available, UNIX domain sockets.
+template <class Protocol>
+class basic_listener : public std::enable_shared_from_this<basic_listener<Protocol>> {
+  using acceptor_type = typename Protocol::acceptor;
+  using endpoint_type = typename Protocol::endpoint;
+  using socket_type = typename Protocol::socket;
+
   asio::io_context& ioc_;
-  tcp::acceptor acceptor_;
+  acceptor_type acceptor_;
   std::shared_ptr<std::string const> doc_root_;
-  std::string client_ip_;  // Add this line to store the client IP
 
  public:
-  listener(asio::io_context& ioc,
-      tcp::endpoint endpoint,
+  basic_listener(asio::io_context& ioc,
+      endpoint_type endpoint,
       std::shared_ptr<std::string const> const& doc_root);
 
   void run();
-  std::string get_client_ip() const { return client_ip_; }        // Updated method
-  void set_client_ip(const std::string& ip) { client_ip_ = ip; }  // New method
-  std::array<std::string, 2> get_socket_ip_and_port(
-      tcp::socket& socket);  // Renamed original method
+
+  // Where the acceptor is bound; with port 0, the port the system picked.
+  endpoint_type local_endpoint() const { return acceptor_.local_endpoint(); }
 
  private:
-  void do_accept();
-  void on_accept(beast::error_code ec, tcp::socket socket);
+  asio::awaitable<void> do_accept();
+  void on_accept(socket_type socket);
   void fail(beast::error_code ec, char const* what);
 };
+
+using listener = basic_listener<tcp>;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+using local_listener = basic_listener<asio::local::stream_protocol>;
+#endif
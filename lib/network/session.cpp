@@ -1,103 +1,777 @@
 #include "session.hpp"
 
-#include <boost/asio/dispatch.hpp>
+#include <boost/asio/as_tuple.hpp>
+#include <boost/asio/bind_allocator.hpp>
+#include <boost/asio/experimental/awaitable_operators.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/use_awaitable.hpp>
 #include <boost/core/ignore_unused.hpp>
-#include <print>
+#include <algorithm>
+#include <format>
+#include <tuple>
+#include <variant>
 
+#if defined(__linux__)
+#include <sys/sendfile.h>
+
+#include <cerrno>
+#endif
+
+#include "../cluster/live.hpp"
+#include "../cluster/shard.hpp"
+#include "../cluster/upstream.hpp"
 #include "../http/handler.hpp"
+#include "../http/streams.hpp"
+#include "../log/logger.hpp"
+#include "../metrics/registry.hpp"
+#include "../metrics/stage_timer.hpp"
+#include "admission.hpp"
+
+namespace {
+
+// Where sendfile(2) is available, large static files skip the user-space copy.
+#if defined(__linux__)
+constexpr bool zero_copy_files = true;
+#else
+constexpr bool zero_copy_files = false;
+#endif
+
+// Body bytes relayed to the owning node per read.
+constexpr std::size_t relay_chunk = 64 * 1024;
+// Body bytes of a POST /stream parsed per read.
+constexpr std::size_t stream_chunk = 64 * 1024;
+// An event feed with nothing new to send still writes this often.
+constexpr auto event_heartbeat = std::chrono::seconds(15);
+// A live feed subscriber that takes longer to accept a frame is dropped.
+constexpr auto live_write_timeout = std::chrono::seconds(10);
+
+// The value of `key` in a query string, or an empty view.
+std::string_view query_value(std::string_view query, std::string_view key) {
+  while (!query.empty()) {
+    auto const amp = query.find('&');
+    auto const pair = query.substr(0, amp);
+    query = amp == std::string_view::npos ? std::string_view{} : query.substr(amp + 1);
+    if (pair.size() > key.size() && pair.starts_with(key) && pair[key.size()] == '=') {
+      return pair.substr(key.size() + 1);
+    }
+  }
+  return {};
+}
+
+}  // namespace
 
 // Take ownership of the stream
-session::session(tcp::socket&& socket, std::shared_ptr<std::string const> const& doc_root)
-    : stream_(std::move(socket)), doc_root_(doc_root) {}
+template <class Protocol>
+basic_session<Protocol>::basic_session(typename Protocol::socket&& socket,
+    std::shared_ptr<std::string const> const& doc_root,
+    asio::any_io_executor work_executor)
+    : stream_(std::move(socket)),
+      doc_root_(doc_root),
+      work_executor_(std::move(work_executor)),
+      state_changed_(stream_.get_executor(), asio::steady_timer::time_point::max()) {
+  // Resolved once: requests are handled away from the socket's strand.
+  beast::error_code ec;
+  client_ = to_client_address(stream_.socket().remote_endpoint(ec));
+  metrics::add(metrics::counter::sessions_opened);
+}
 
-// Start the asynchronous operation
-void session::run() {
-  // We need to be executing within a strand to perform async operations
-  // on the I/O objects in this session. Although not strictly necessary
-  // for single-threaded contexts, this example code is written to be
-  // thread-safe by default.
-  boost::asio::dispatch(stream_.get_executor(),
-      beast::bind_front_handler(&session::do_read, shared_from_this()));
+template <class Protocol>
+basic_session<Protocol>::~basic_session() {
+  metrics::add(metrics::counter::sessions_closed);
 }
 
-void session::do_read() {
-  // Make the request empty before reading,
-  // otherwise the operation behavior is undefined.
-  req_ = {};
+template <class Protocol>
+asio::awaitable<void> basic_session<Protocol>::run() {
+  using namespace asio::experimental::awaitable_operators;
+
+  // The reader keeps accepting pipelined requests while the writer sends
+  // earlier responses, in order, as soon as each one is ready.
+  co_await (do_read() && do_write());
+
+  // Requests still being handled refer to this session; wait them out.
+  while (pending_ > 0) co_await wait_for_state_change();
+}
+
+template <class Protocol>
+asio::awaitable<void> basic_session<Protocol>::do_read() {
+  // Operation state for reads lives in per-connection memory.
+  auto read_token = asio::bind_allocator(handler_allocator<std::byte>(read_memory_),
+      asio::as_tuple(asio::use_awaitable));
+
+  while (!closing_) {
+    // Stop reading ahead until the writer makes room in the pipeline.
+    while (responses_.size() >= pipeline_limit && !closing_) co_await wait_for_state_change();
+    if (closing_) break;
+
+    // A fresh parser for every request, constructed in place.
+    parser_.emplace();
+    parser_->body_limit(body_limit_);  // Set the body limit to 1GB
+
+    // Set the timeout dynamically based on the size of the data being
+    // transferred.
+    stream_.expires_after(std::chrono::seconds(300));
+
+    // Read the header, then the body. Body read time is measured from the end
+    // of the header so idle time between keep-alive requests is not counted.
+    auto [ec, bytes_transferred] =
+        co_await http::async_read_header(stream_, buffer_, *parser_, read_token);
+
+    // Uploads of a client another node owns go there before their body is
+    // read. A forwarded upload is answered before the next request is read.
+    if (!ec) {
+      if (auto const owner = shard_owner()) {
+        http::request<http::empty_body> head{http::verb::post, "/", parser_->get().version()};
+        head.keep_alive(parser_->keep_alive());
+        metrics::add(metrics::counter::bytes_read, bytes_transferred);
+
+        if (cluster::sharding_mode() == cluster::shard_mode::redirect) {
+          auto const location = std::format("http://{}:{}{}",
+              owner->host,
+              owner->port,
+              std::string_view(parser_->get().target()));
+          metrics::add(metrics::counter::requests_redirected);
+          responses_.emplace_back(
+              pending_response{ResponseHandler::redirect(head, location), {}});
+          notify_state_change();
+          break;
+        }
+
+        http::response<http::string_body> res;
+        bool client_failed = false;
+        auto const relay_ec = co_await forward(*owner, res, client_failed);
+        if (client_failed) {
+          fail(relay_ec, "Read");
+          break;
+        }
+        if (relay_ec) {
+          LOG_WARN("Forwarding to {}: {}", owner->id, relay_ec.message());
+          relay_.reset();
+          head.keep_alive(false);  // The rest of the body may still be unread
+          res = ResponseHandler::bad_gateway(head, relay_ec.message());
+        } else {
+          metrics::add(metrics::counter::requests_forwarded);
+          metrics::count_response(res.result_int());
+          res.keep_alive(head.keep_alive() && res.keep_alive());
+        }
+        bool const keep_alive = res.keep_alive();
+        responses_.emplace_back(pending_response{http::message_generator(std::move(res)), {}});
+        notify_state_change();
+        if (!keep_alive) break;
+        continue;
+      }
+    }
 
-  // Set the timeout dynamically based on the size of the data being
-  // transferred.
-  stream_.expires_after(std::chrono::seconds(300));
+    // Uploads over their client's limits are refused before their body is
+    // read. A stream's bytes are charged as they arrive instead.
+    if (!ec && parser_->get().method() == http::verb::post) {
+      auto const& head = parser_->get();
+      auto const client_id = head["Client-Id"];
+      if (!client_id.empty()) {
+        std::string_view const id(client_id.data(), client_id.size());
+        auto const path =
+            split_target(std::string_view(head.target().data(), head.target().size())).first;
+        std::uint64_t const declared =
+            path == "/stream" ? 0 : parser_->content_length().value_or(0);
+        auto const wait = admission::admit(id, declared);
+        if (wait.count() > 0) {
+          metrics::add(metrics::counter::bytes_read, bytes_transferred);
+          metrics::count_throttled(id);
+          responses_.emplace_back(pending_response{
+              ResponseHandler::too_many_requests(head,
+                  std::chrono::ceil<std::chrono::seconds>(wait)),
+              {}});
+          notify_state_change();
+          break;
+        }
+      }
+    }
+
+    // A stream is parsed while its body arrives, and event and live feeds keep
+    // the connection; none of them goes through the worker pool.
+    if (!ec) {
+      auto const& head = parser_->get();
+      auto const [path, query] =
+          split_target(std::string_view(head.target().data(), head.target().size()));
+      if (path == "/stream" && head.method() == http::verb::post) {
+        metrics::add(metrics::counter::bytes_read, bytes_transferred);
+        http::response<http::string_body> res;
+        ec = co_await ingest_stream(res);
+        if (ec) {
+          fail(ec, "Read");
+          break;
+        }
+        bool const keep_alive = res.keep_alive();
+        responses_.emplace_back(pending_response{http::message_generator(std::move(res)), {}});
+        notify_state_change();
+        if (!keep_alive) break;
+        continue;
+      }
+      if (path == "/stream/events" && head.method() == http::verb::get) {
+        metrics::add(metrics::counter::bytes_read, bytes_transferred);
+        // Browsers' EventSource cannot set headers, so the query may name the client.
+        std::string client_id(head["Client-Id"]);
+        if (client_id.empty()) client_id = query_value(query, "client_id");
+        co_await serve_events(std::move(client_id), head.version());
+        break;
+      }
+      if (path == "/live" && beast::websocket::is_upgrade(head) && cluster::live_enabled()) {
+        metrics::add(metrics::counter::bytes_read, bytes_transferred);
+        co_await serve_live();
+        break;
+      }
+    }
+
+    stage_span read_span;
+    if (!ec) {
+      stage_timer read_timer(request_stage::read);
+      std::size_t body_bytes = 0;
+      std::tie(ec, body_bytes) = co_await http::async_read(stream_, buffer_, *parser_, read_token);
+      bytes_transferred += body_bytes;
+      read_span = read_timer.stop();
+      // A body of unknown length is charged once it is in.
+      auto const& req = parser_->get();
+      auto const client_id = req["Client-Id"];
+      if (!ec && req.method() == http::verb::post && !client_id.empty() &&
+          !parser_->content_length()) {
+        admission::charge(std::string_view(client_id.data(), client_id.size()), body_bytes);
+      }
+    }
+    metrics::add(metrics::counter::bytes_read, bytes_transferred);
+
+    // This means they closed the connection, or the writer is closing it
+    if (ec == http::error::end_of_stream || ec == beast::error::timeout ||
+        ec == asio::error::operation_aborted) {
+      break;
+    }
+
+    if (ec) {
+      fail(ec, "Read");
+      break;
+    }
+
+    bool const keep_alive = parser_->keep_alive();
+    std::string const client_id(parser_->get()["Client-Id"]);
+    auto& slot = responses_.emplace_back();
+    ++pending_;
+
+    // Handle the request on the worker pool, in fair order between clients,
+    // then hand the response back to the strand. Deque references stay valid
+    // while slots are pushed and popped at the ends, and a slot is never
+    // popped before it is filled.
+    auto handle = [this, &slot, read_span, req = parser_->release()]() mutable {
+      unsigned const version = req.version();
+      bool const request_keep_alive = req.keep_alive();
+      std::optional<pending_response> response;
+      try {
+        static_files::file_transfer file;
+        auto msg = handle_request(*doc_root_,
+            std::move(req),
+            client_,
+            read_span,
+            zero_copy_files ? &file : nullptr);
+        response.emplace(pending_response{std::move(msg), std::move(file)});
+      } catch (const std::exception& e) {
+        http::request<http::empty_body> failed{http::verb::post, "/", version};
+        failed.keep_alive(request_keep_alive);
+        response.emplace(pending_response{ResponseHandler::server_error(failed, e.what()), {}});
+      }
+
+      asio::post(stream_.get_executor(), [this, &slot, response = std::move(response)]() mutable {
+        slot = std::move(response);
+        --pending_;
+        notify_state_change();
+      });
+    };
+    admission::submit(work_executor_, client_id, bytes_transferred, std::move(handle));
+
+    // The client asked for the connection to be closed after this request.
+    if (!keep_alive) break;
+  }
+
+  reading_done_ = true;
+  notify_state_change();
+}
+
+template <class Protocol>
+std::optional<cluster::ring_node> basic_session<Protocol>::shard_owner() const {
+  auto const& req = parser_->get();
+  if (req.method() != http::verb::post) return std::nullopt;
+  if (req.find(cluster::forwarded_by_header) != req.end()) return std::nullopt;
+  // Only uploads are sharded; /cluster/push and the rest stay local.
+  std::string_view const target(req.target().data(), req.target().size());
+  auto const path = target.substr(0, target.find('?'));
+  if (path != "/" && path != "/summary" && path != "/archive" && path != "/tail" &&
+      path != "/stream") {
+    return std::nullopt;
+  }
+  auto const client_id = req["Client-Id"];
+  if (client_id.empty()) return std::nullopt;
+  return cluster::foreign_owner(std::string_view(client_id.data(), client_id.size()));
+}
+
+// Relays the upload whose header parser_ holds to `owner` as its body arrives,
+// still encoded, and reads the owner's response. `client_failed` tells a
+// broken client connection apart from a failing owner.
+template <class Protocol>
+asio::awaitable<beast::error_code> basic_session<Protocol>::forward(
+    cluster::ring_node const& owner,
+    http::response<http::string_body>& response,
+    bool& client_failed) {
+  auto const token = asio::as_tuple(asio::use_awaitable);
+  beast::error_code ec;
+  client_failed = false;
+
+  bool const reused = relay_ && relay_node_ == owner.id;
+  if (!reused) {
+    ec = co_await connect_relay(owner);
+    if (ec) co_return ec;
+  }
+
+  // The header as received, plus where it came from; the owner inflates and
+  // parses the body itself, and applies its own body limit, which a
+  // POST /stream does not have.
+  http::request_parser<http::buffer_body> in{std::move(*parser_)};
+  in.body_limit(boost::none);
+  auto& req = in.get();
+  req.set(cluster::forwarded_by_header, cluster::self_node_id());
+  req.set("X-Forwarded-For", client_.ip);
+  relay_body_.resize(relay_chunk);
+
+  std::optional<http::request_serializer<http::buffer_body>> serializer;
+  serializer.emplace(req);
+  relay_->expires_after(std::chrono::seconds(300));
+  std::tie(ec, std::ignore) = co_await http::async_write_header(*relay_, *serializer, token);
+  if (ec && reused) {
+    // The owner may have closed the idle connection; nothing of the body has
+    // been consumed yet, so a fresh one can take over.
+    ec = co_await connect_relay(owner);
+    if (ec) co_return ec;
+    serializer.emplace(req);
+    std::tie(ec, std::ignore) = co_await http::async_write_header(*relay_, *serializer, token);
+  }
+  if (ec) co_return ec;
+  do {
+    if (!in.is_done()) {
+      req.body().data = relay_body_.data();
+      req.body().size = relay_body_.size();
+      stream_.expires_after(std::chrono::seconds(300));
+      std::size_t body_bytes = 0;
+      std::tie(ec, body_bytes) = co_await http::async_read(stream_, buffer_, in, token);
+      metrics::add(metrics::counter::bytes_read, body_bytes);
+      if (ec == http::error::need_buffer) ec = {};
+      if (ec) {
+        client_failed = true;
+        co_return ec;
+      }
+      req.body().size = relay_body_.size() - req.body().size;
+      req.body().data = relay_body_.data();
+      req.body().more = !in.is_done();
+    } else {
+      req.body().data = nullptr;
+      req.body().size = 0;
+    }
+    relay_->expires_after(std::chrono::seconds(300));
+    std::tie(ec, std::ignore) = co_await http::async_write(*relay_, *serializer, token);
+    if (ec == http::error::need_buffer) ec = {};
+    if (ec) co_return ec;
+  } while (!in.is_done() && !serializer->is_done());
 
-  // Use a parser to set the body limit
-  auto parser = std::make_shared<http::request_parser<http::dynamic_body>>();
-  parser->body_limit(body_limit_);  // Set the body limit to 1GB
+  http::response_parser<http::string_body> out;
+  out.body_limit(boost::none);
+  std::tie(ec, std::ignore) = co_await http::async_read(*relay_, relay_read_buffer_, out, token);
+  if (ec) co_return ec;
+  response = out.release();
+  if (!response.keep_alive()) relay_.reset();
+  co_return beast::error_code{};
+}
 
-  // Read a request
-  http::async_read(stream_,
-      buffer_,
-      *parser,
-      beast::bind_front_handler(
-          [self = shared_from_this(), parser](beast::error_code ec, std::size_t bytes_transferred) {
-            self->on_read_with_parser(ec, bytes_transferred, parser);
-          }));
+template <class Protocol>
+asio::awaitable<beast::error_code> basic_session<Protocol>::connect_relay(
+    cluster::ring_node const& owner) {
+  auto const token = asio::as_tuple(asio::use_awaitable);
+  relay_.reset();
+  relay_read_buffer_.clear();
+  tcp::resolver resolver(stream_.get_executor());
+  auto [ec, endpoints] = co_await resolver.async_resolve(owner.host, owner.port, token);
+  if (ec) co_return ec;
+  relay_.emplace(stream_.get_executor());
+  relay_->expires_after(std::chrono::seconds(10));
+  std::tie(ec, std::ignore) = co_await relay_->async_connect(endpoints, token);
+  if (ec) {
+    relay_.reset();
+    co_return ec;
+  }
+  relay_->socket().set_option(tcp::no_delay(true), ec);
+  relay_node_ = owner.id;
+  co_return beast::error_code{};
 }
 
-// New handler to accept parser
-void session::on_read_with_parser(beast::error_code ec,
-    std::size_t bytes_transferred,
-    std::shared_ptr<http::request_parser<http::dynamic_body>> parser) {
-  boost::ignore_unused(bytes_transferred);
+// Parses a POST /stream body while it arrives and answers with the final
+// analysis. Snapshots of the running aggregate are published for
+// GET /stream/events along the way. Only one piece of the body is held at a
+// time, so there is no body limit. Returns an error only if reading from the
+// client failed.
+template <class Protocol>
+asio::awaitable<beast::error_code> basic_session<Protocol>::ingest_stream(
+    http::response<http::string_body>& response) {
+  auto const token = asio::as_tuple(asio::use_awaitable);
+  http::request_parser<http::buffer_body> in{std::move(*parser_)};
+  in.body_limit(boost::none);
+  auto& req = in.get();
 
-  // This means they closed the connection
-  if (ec == http::error::end_of_stream) return do_close();
+  // What is refused is answered before its body is read, so the connection
+  // is closed after the answer.
+  http::request<http::empty_body> head{req.base()};
+  head.keep_alive(false);
+  std::string const client_id(req["Client-Id"]);
+  auto const query = results::parse_query(
+      split_target(std::string_view(req.target().data(), req.target().size())).second);
+  auto const coding = codec::parse_content_coding(req[http::field::content_encoding]);
+  if (client_id.empty()) {
+    response = ResponseHandler::bad_request(head, "Missing Client-Id header");
+    co_return beast::error_code{};
+  }
+  if (!query) {
+    response = ResponseHandler::bad_request(head, "Invalid query parameters");
+    co_return beast::error_code{};
+  }
+  if (req[http::field::content_type] != "text/plain") {
+    response = ResponseHandler::bad_request(head, "Invalid Content-Type header");
+    co_return beast::error_code{};
+  }
+  if (coding == codec::content_coding::unsupported) {
+    response = ResponseHandler::unsupported_encoding(head);
+    co_return beast::error_code{};
+  }
+
+  std::optional<codec::inflater> inflater;
+  if (coding != codec::content_coding::identity) inflater.emplace(coding);
+  stream_body_.resize(stream_chunk);
+  inflated_body_.resize(stream_chunk);
+  streams::line_ingest ingest;
+  streams::publish(client_id, ingest, false);
+  auto last_publish = std::chrono::steady_clock::now();
+  bool corrupt = false;
+  asio::steady_timer pace(stream_.get_executor());
+
+  while (!in.is_done() && !corrupt) {
+    req.body().data = stream_body_.data();
+    req.body().size = stream_body_.size();
+    stream_.expires_after(std::chrono::seconds(300));
+    auto [ec, body_bytes] = co_await http::async_read(stream_, buffer_, in, token);
+    if (ec == http::error::need_buffer) ec = {};
+    if (ec) {
+      streams::publish(client_id, ingest, true);
+      co_return ec;
+    }
+    metrics::add(metrics::counter::bytes_read, body_bytes);
+    std::string_view piece(stream_body_.data(), stream_body_.size() - req.body().size);
 
-  if (ec == beast::error::timeout) return do_close();
+    stage_timer parse_timer(request_stage::parse_text);
+    if (!inflater) {
+      ingest.feed(piece);
+    } else {
+      corrupt = !inflater->inflate_all(piece,
+          inflated_body_.data(),
+          inflated_body_.size(),
+          [&ingest](std::string_view decoded) { ingest.feed(decoded); });
+    }
+    parse_timer.stop();
 
-  if (ec) return fail(ec, "[INFO] Read");
+    auto const now = std::chrono::steady_clock::now();
+    if (now - last_publish >= streams::snapshot_interval) {
+      streams::publish(client_id, ingest, false);
+      last_publish = now;
+    }
+
+    // Over its byte rate, the client is read from more slowly.
+    if (auto const pause = admission::charge(client_id, body_bytes); pause.count() > 0) {
+      pace.expires_after(pause);
+      co_await pace.async_wait(token);
+    }
+  }
 
-  req_ = parser->get();  // Move the parsed request into req_
+  ingest.finish();
+  streams::publish(client_id, ingest, true);
+  if (corrupt || (inflater && !inflater->done())) {
+    response = ResponseHandler::bad_request(head, "Corrupt compressed stream");
+    co_return beast::error_code{};
+  }
+  cluster::record(ingest.aggregate());
+  LOG_INFO("Stream from client {} ended after {} bytes", client_id, ingest.bytes());
 
-  // Get client endpoint from the socket
-  tcp::endpoint client_endpoint = stream_.socket().remote_endpoint();
-  // Send the response
-  send_response(handle_request(*doc_root_, std::move(req_), client_endpoint));
+  ClientResponseData response_data;
+  response_data.total_number_of_fields = ingest.aggregate().total_entries;
+  response_data.invalid_fields = ingest.aggregate().invalid_data;
+  response_data.client_ip = client_.ip;
+  response_data.client_port = client_.port;
+  response_data.analysis_type = "LOG LEVEL";
+  response_data.message_stats = ingest.aggregate().message_stats();
+  narrow_stats(*query, response_data);
+  response = ResponseHandler::response(req, response_data);
+  co_return beast::error_code{};
 }
 
-void session::send_response(http::message_generator&& msg) {
-  bool keep_alive = msg.keep_alive();
+// Sends the client's stream snapshots as Server-Sent Events until its stream
+// ends or the peer goes away. Only the newest snapshot is sent at each tick,
+// so a slow reader skips snapshots rather than queueing them, and one that
+// stops reading is dropped by the write timeout.
+template <class Protocol>
+asio::awaitable<void> basic_session<Protocol>::serve_events(std::string client_id,
+    unsigned version) {
+  auto const token = asio::as_tuple(asio::use_awaitable);
+  // Earlier pipelined responses go first, including one the writer has
+  // taken off the queue but not finished; then the writer is idle and the
+  // feed has the connection to itself.
+  while (!responses_.empty() || pending_ > 0 || writing_) co_await wait_for_state_change();
+
+  http::response<http::empty_body> res{http::status::ok, version};
+  res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+  res.set(http::field::content_type, "text/event-stream");
+  res.set(http::field::cache_control, "no-cache");
+  res.keep_alive(false);
+  res.chunked(true);
+  metrics::count_response(res.result_int());
+  http::response_serializer<http::empty_body> serializer{res};
+  stream_.expires_after(std::chrono::seconds(30));
+  auto [ec, bytes_written] = co_await http::async_write_header(stream_, serializer, token);
+  metrics::add(metrics::counter::bytes_written, bytes_written);
 
-  // Write the response
-  beast::async_write(stream_,
-      std::move(msg),
-      beast::bind_front_handler(&session::on_write, shared_from_this(), keep_alive));
+  asio::steady_timer tick(stream_.get_executor());
+  std::uint64_t sent_seq = 0;
+  auto last_sent = std::chrono::steady_clock::now();
+  while (!ec) {
+    auto const snapshot = streams::latest(client_id);
+    auto const now = std::chrono::steady_clock::now();
+    std::string event;
+    if (snapshot && snapshot->seq != sent_seq) {
+      event = std::format("event: {}\ndata: {}\n\n",
+          snapshot->done ? "end" : "snapshot",
+          *snapshot->json);
+      sent_seq = snapshot->seq;
+    } else if (now - last_sent >= event_heartbeat) {
+      event = ": waiting\n\n";  // A comment, which readers ignore
+    }
+    if (!event.empty()) {
+      stream_.expires_after(std::chrono::seconds(30));
+      std::tie(ec, bytes_written) =
+          co_await asio::async_write(stream_, http::make_chunk(asio::buffer(event)), token);
+      metrics::add(metrics::counter::bytes_written, bytes_written);
+      last_sent = now;
+    }
+    if (ec || (snapshot && snapshot->done)) break;
+    tick.expires_after(streams::snapshot_interval);
+    auto const [wait_ec] = co_await tick.async_wait(token);
+    boost::ignore_unused(wait_ec);
+  }
+  if (!ec) co_await asio::async_write(stream_, http::make_chunk_last(), token);
 }
 
-void session::on_write(bool keep_alive, beast::error_code ec, std::size_t bytes_transferred) {
-  boost::ignore_unused(bytes_transferred);
+// Upgrades the connection to a WebSocket and sends it the live feed until
+// either side closes it.
+template <class Protocol>
+asio::awaitable<void> basic_session<Protocol>::serve_live() {
+  using namespace asio::experimental::awaitable_operators;
+  // The 101 response must not overlap a response still being written.
+  while (!responses_.empty() || pending_ > 0 || writing_) co_await wait_for_state_change();
 
+  // The WebSocket keeps its own timeouts, with pings to find dead peers.
+  stream_.expires_never();
+  live_socket ws{stream_};
+  auto timeouts = beast::websocket::stream_base::timeout::suggested(beast::role_type::server);
+  timeouts.idle_timeout = std::chrono::seconds(60);
+  timeouts.keep_alive_pings = true;
+  ws.set_option(timeouts);
+  ws.read_message_max(4096);
+  auto const [ec] = co_await ws.async_accept(parser_->get(), asio::as_tuple(asio::use_awaitable));
   if (ec) {
-    std::println(stderr, "[ERROR] Write failed: {}", ec.message());
-    return fail(ec, "[ERROR] Write");
+    fail(ec, "WebSocket accept");
+    co_return;
   }
-  if (!keep_alive) {
-    // This means we should close the connection, usually because
-    // the response indicated the "Connection: close" semantic.
-    return do_close();
+  metrics::count_response(static_cast<unsigned>(http::status::switching_protocols));
+
+  auto const wake = std::make_shared<asio::steady_timer>(stream_.get_executor(),
+      asio::steady_timer::time_point::max());
+  cluster::subscribe_live(wake);
+  co_await (read_live(ws) || send_live(ws, *wake));
+}
+
+// Subscribers have nothing to say; reading keeps pings, pongs and the close
+// handshake going, and ends when the peer leaves.
+template <class Protocol>
+asio::awaitable<void> basic_session<Protocol>::read_live(live_socket& ws) {
+  beast::flat_buffer incoming;
+  for (;;) {
+    auto const [ec, bytes] = co_await ws.async_read(incoming, asio::as_tuple(asio::use_awaitable));
+    if (ec) co_return;
+    incoming.consume(bytes);
   }
-  buffer_.consume(buffer_.size());
-  // Read another request
-  do_read();
 }
 
-void session::do_close() {
-  // Send a TCP shutdown
+// Sends the newest frame whenever there is one this subscriber has not sent.
+// Frames published during a write are skipped over, and a subscriber that
+// holds up a write past live_write_timeout is dropped, so nothing queues.
+template <class Protocol>
+asio::awaitable<void> basic_session<Protocol>::send_live(live_socket& ws,
+    asio::steady_timer& wake) {
+  using namespace asio::experimental::awaitable_operators;
+  auto const token = asio::as_tuple(asio::use_awaitable);
+  asio::steady_timer deadline(stream_.get_executor());
+  std::uint64_t sent_seq = 0;
+  ws.text(true);
+  for (;;) {
+    auto const frame = cluster::latest_live_frame();
+    if (!frame.json || frame.seq == sent_seq) {
+      // Cancelled by the feed after each tick.
+      auto const [wait_ec] = co_await wake.async_wait(token);
+      boost::ignore_unused(wait_ec);
+      continue;
+    }
+    sent_seq = frame.seq;
+    deadline.expires_after(live_write_timeout);
+    auto const result =
+        co_await (ws.async_write(asio::buffer(*frame.json), token) || deadline.async_wait(token));
+    if (result.index() == 1) {
+      LOG_INFO("Dropping a live feed subscriber that stopped reading");
+      co_return;
+    }
+    auto const [ec, bytes] = std::get<0>(result);
+    if (ec) co_return;
+    metrics::add(metrics::counter::bytes_written, bytes);
+  }
+}
+
+template <class Protocol>
+asio::awaitable<void> basic_session<Protocol>::do_write() {
+  // Operation state for writes lives in per-connection memory.
+  auto write_token = asio::bind_allocator(handler_allocator<std::byte>(write_memory_),
+      asio::as_tuple(asio::use_awaitable));
+
+  for (;;) {
+    if (!responses_.empty() && responses_.front()) {
+      pending_response response = std::move(*responses_.front());
+      responses_.pop_front();
+      writing_ = true;
+      notify_state_change();  // Room for another pipelined request
+
+      bool const keep_alive = response.msg.keep_alive();
+
+      // Write the response, then the file body if it was left to us
+      stream_.expires_after(std::chrono::seconds(300));
+      auto [ec, bytes_transferred] =
+          co_await beast::async_write(stream_, std::move(response.msg), write_token);
+      if (!ec && response.file) {
+        std::uint64_t sent = 0;
+        ec = co_await send_file(response.file, sent);
+        bytes_transferred += sent;
+      }
+      writing_ = false;
+      notify_state_change();  // The connection is free for a feed
+      metrics::add(metrics::counter::bytes_written, bytes_transferred);
+
+      if (ec) {
+        LOG_ERROR("Write failed: {}", ec.message());
+        closing_ = true;
+        break;
+      }
+      if (!keep_alive) {
+        // This means we should close the connection, usually because
+        // the response indicated the "Connection: close" semantic.
+        closing_ = true;
+        break;
+      }
+      continue;
+    }
+
+    if (reading_done_ && responses_.empty()) break;
+    co_await wait_for_state_change();
+  }
+
+  do_close();
+  if (closing_) {
+    // Wake the reader if it is still waiting for a request or for room.
+    stream_.cancel();
+    notify_state_change();
+  }
+}
+
+template <class Protocol>
+asio::awaitable<beast::error_code> basic_session<Protocol>::send_file(
+    static_files::file_transfer& transfer,
+    std::uint64_t& sent) {
+#if defined(__linux__)
+  using namespace asio::experimental::awaitable_operators;
+  auto const token = asio::as_tuple(asio::use_awaitable);
+  // sendfile(2) on a non-blocking socket sends what fits and returns EAGAIN;
+  // wait for room and carry on from the updated offset.
+  auto& socket = stream_.socket();
   beast::error_code ec;
-  auto shutdown = stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
+  socket.native_non_blocking(true, ec);
+  if (ec) co_return ec;
+
+  // The waits below are on the raw socket, which the stream's timeout does
+  // not cover, so the file gets a deadline of its own.
+  asio::steady_timer deadline(stream_.get_executor());
+  deadline.expires_after(std::chrono::seconds(300));
+
+  auto offset = static_cast<off_t>(transfer.offset);
+  std::uint64_t remaining = transfer.length;
+  while (remaining > 0) {
+    auto const chunk =
+        static_cast<std::size_t>(std::min<std::uint64_t>(remaining, std::uint64_t{1} << 30));
+    ssize_t const n =
+        ::sendfile(socket.native_handle(), transfer.file.native_handle(), &offset, chunk);
+    if (n > 0) {
+      remaining -= static_cast<std::uint64_t>(n);
+      sent += static_cast<std::uint64_t>(n);
+      continue;
+    }
+    if (n == 0) co_return asio::error::eof;  // The file shrank under us
+    if (errno == EINTR) continue;
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      co_return beast::error_code(errno, beast::system_category());
+    }
+
+    auto const result = co_await (
+        socket.async_wait(asio::socket_base::wait_write, token) || deadline.async_wait(token));
+    if (result.index() == 1) co_return beast::error::timeout;
+    auto const [wait_ec] = std::get<0>(result);
+    if (wait_ec) co_return wait_ec;
+  }
+  co_return beast::error_code{};
+#else
+  boost::ignore_unused(transfer, sent);
+  co_return asio::error::operation_not_supported;
+#endif
+}
+
+template <class Protocol>
+asio::awaitable<void> basic_session<Protocol>::wait_for_state_change() {
+  auto [ec] = co_await state_changed_.async_wait(asio::as_tuple(asio::use_awaitable));
+  boost::ignore_unused(ec);
+}
+
+template <class Protocol>
+void basic_session<Protocol>::notify_state_change() {
+  // The timer never expires, cancelling it wakes every waiter.
+  state_changed_.cancel();
+}
+
+template <class Protocol>
+void basic_session<Protocol>::do_close() {
+  // Shut down the sending side
+  beast::error_code ec;
+  auto shutdown = stream_.socket().shutdown(asio::socket_base::shutdown_send, ec);
   boost::ignore_unused(shutdown);
   // At this point the connection is closed gracefully
 }
 
-void session::fail(beast::error_code ec, char const* what) {
-  std::println("{}: {}", what, ec.message());
-};
+template <class Protocol>
+void basic_session<Protocol>::fail(beast::error_code ec, char const* what) {
+  LOG_INFO("{}: {}", what, ec.message());
+}
+
+template class basic_session<tcp>;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+template class basic_session<asio::local::stream_protocol>;
+#endif
@@ -1,33 +1,121 @@
 #pragma once
 
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/awaitable.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
+#include <cstdint>
+#include <deque>
 #include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
+#include "../cluster/ring.hpp"
+#include "../http/inflating_body.hpp"
+#include "../http/static_files.hpp"
+#include "client_address.hpp"
+#include "handler_allocator.hpp"
 
+namespace asio = boost::asio;
 namespace beast = boost::beast;
 namespace http = beast::http;
 using tcp = boost::asio::ip::tcp;
 
-class session : public std::enable_shared_from_this<session> {
+// One HTTP connection over a stream socket of the given protocol. TCP and
+// UNIX domain socket sessions share the same request handling.
+template <class Protocol>
+class basic_session {
  private:
-  beast::tcp_stream stream_;
+  beast::basic_stream<Protocol> stream_;
   beast::flat_buffer buffer_;
   std::shared_ptr<std::string const> doc_root_;
-  http::request<http::dynamic_body> req_;
+  // Requests are handled here, off the connection's strand.
+  asio::any_io_executor work_executor_;
+  client_address client_;
+  // Re-emplaced for every request; the optional keeps the parser itself off the
+  // heap. Its request is released to the handler, which may still run while the
+  // next one is read, so the request's storage is not reused across requests.
+  // Compressed bodies are inflated as they arrive.
+  std::optional<http::request_parser<inflating_body>> parser_;
+  handler_memory read_memory_;
+  handler_memory write_memory_;
   std::size_t body_limit_ = 1073741824;
+
+  // A handled request: its response, and for a large static file the file
+  // that goes out after the response header.
+  struct pending_response {
+    http::message_generator msg;
+    static_files::file_transfer file;
+  };
+
+  // One slot per pipelined request, in arrival order. A slot is filled once its
+  // request has been handled; the writer only ever sends the front slot.
+  std::deque<std::optional<pending_response>> responses_;
+  std::size_t pending_ = 0;  // Requests still being handled
+  // A response has left the queue but is still being written.
+  bool writing_ = false;
+  bool reading_done_ = false;
+  bool closing_ = false;
+  // Never expires; cancelled to wake the reader and writer when state changes.
+  asio::steady_timer state_changed_;
+
+  // Connection to the node uploads were last forwarded to, kept open for the
+  // next one.
+  std::optional<beast::tcp_stream> relay_;
+  std::string relay_node_;
+  beast::flat_buffer relay_read_buffer_;
+  std::vector<char> relay_body_;
+
+  // Pieces of a POST /stream body, as read and as inflated.
+  std::vector<char> stream_body_;
+  std::vector<char> inflated_body_;
+
   void fail(beast::error_code ec, char const* what);
+  std::optional<cluster::ring_node> shard_owner() const;
+  asio::awaitable<beast::error_code> forward(cluster::ring_node const& owner,
+      http::response<http::string_body>& response,
+      bool& client_failed);
+  asio::awaitable<beast::error_code> connect_relay(cluster::ring_node const& owner);
+  asio::awaitable<beast::error_code> ingest_stream(http::response<http::string_body>& response);
+  asio::awaitable<void> serve_events(std::string client_id, unsigned version);
+
+  // The dashboard's feed: a WebSocket over this connection's stream.
+  using live_socket = beast::websocket::stream<beast::basic_stream<Protocol>&>;
+  asio::awaitable<void> serve_live();
+  asio::awaitable<void> read_live(live_socket& ws);
+  asio::awaitable<void> send_live(live_socket& ws, asio::steady_timer& wake);
+  asio::awaitable<void> do_read();
+  asio::awaitable<void> do_write();
+  asio::awaitable<beast::error_code> send_file(static_files::file_transfer& transfer,
+      std::uint64_t& sent);
+  asio::awaitable<void> wait_for_state_change();
+  void notify_state_change();
 
  public:
-  session(tcp::socket&& socket, std::shared_ptr<std::string const> const& doc_root);
-  void run();
-  void do_read();
-  void on_read_with_parser(beast::error_code ec,
-      std::size_t bytes_transferred,
-      std::shared_ptr<http::request_parser<http::dynamic_body>> parser);
-  void send_response(http::message_generator&& msg);
-  void on_write(bool keep_alive, beast::error_code ec, std::size_t bytes_transferred);
+  // Upper bound on requests read ahead of the response being written.
+  static constexpr std::size_t pipeline_limit = 16;
+
+  basic_session(typename Protocol::socket&& socket,
+      std::shared_ptr<std::string const> const& doc_root,
+      asio::any_io_executor work_executor);
+  ~basic_session();
+  basic_session(const basic_session&) = delete;
+  basic_session& operator=(const basic_session&) = delete;
+
+  client_address const& client() const { return client_; }
+
+  // Serves requests until the peer closes the connection or an error occurs.
+  // The caller keeps the session alive until the returned awaitable completes.
+  asio::awaitable<void> run();
   void do_close();
 };
+
+using session = basic_session<tcp>;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+using local_session = basic_session<asio::local::stream_protocol>;
+#endif
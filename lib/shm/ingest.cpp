@@ -0,0 +1,180 @@
+#include "ingest.hpp"
+
+#include <boost/json.hpp>
+#include <chrono>
+#include <print>
+
+#include "../cluster/upstream.hpp"
+#include "../codec/analysis.hpp"
+#include "../file/handler.hpp"
+#include "../log/logger.hpp"
+
+struct shm_ingest::channel {
+  shm_region region;
+  shm::ring requests;
+  shm::ring responses;
+  size_t total_fields = 0;
+  size_t invalid_fields = 0;
+  // Per-record message_stats, folded together every merge_batch records.
+  std::vector<boost::json::value> message_stats;
+  std::string error_message;  // First parse error since the last flush
+  bool detached = false;      // No longer read: its producer broke the protocol
+};
+
+namespace {
+
+constexpr std::size_t merge_batch = 64;
+constexpr std::size_t records_per_turn = 256;
+// How long a flush answer waits for the producer to make room for it.
+constexpr auto answer_timeout = std::chrono::seconds(5);
+
+}  // namespace
+
+shm_ingest::shm_ingest(std::vector<std::string> names,
+    std::size_t request_capacity,
+    std::size_t response_capacity)
+    : names_(std::move(names)),
+      request_capacity_(request_capacity),
+      response_capacity_(response_capacity) {}
+
+shm_ingest::~shm_ingest() { stop(); }
+
+bool shm_ingest::start() {
+  for (auto const& name : names_) {
+    auto region = shm_region::create(name, request_capacity_, response_capacity_);
+    if (!region) return false;
+
+    channel ch{std::move(*region)};
+    ch.requests = ch.region.request_ring();
+    ch.responses = ch.region.response_ring();
+    std::println("[INFO] Shared-memory ingestion ring {} ({} MiB)",
+        name,
+        ch.requests.capacity() >> 20);
+    channels_.push_back(std::move(ch));
+  }
+
+  if (!channels_.empty()) consumer_ = std::thread([this] { consume(); });
+  return true;
+}
+
+void shm_ingest::stop() {
+  stop_requested_.store(true);
+  if (consumer_.joinable()) consumer_.join();
+  channels_.clear();
+}
+
+void shm_ingest::consume() {
+  unsigned idle = 0;
+  while (!stop_requested_.load(std::memory_order_relaxed)) {
+    bool busy = false;
+    for (auto& ch : channels_) {
+      if (ch.detached) continue;
+      // A bounded batch per region so one producer cannot starve the others
+      for (std::size_t i = 0; i < records_per_turn; ++i) {
+        auto const handle = [&](shm::record_type type, std::string_view payload) {
+          try {
+            handle_record(ch, type, payload);
+          } catch (const std::exception& e) {
+            if (ch.error_message.empty()) ch.error_message = e.what();
+          }
+        };
+        if (ch.detached || !ch.requests.try_pop(handle)) break;
+        busy = true;
+      }
+      if (ch.requests.broken()) {
+        LOG_ERROR("Shared-memory ring {} holds a record outside its published bytes; detaching it",
+            ch.region.name());
+        ch.detached = true;
+      }
+    }
+
+    if (busy) {
+      idle = 0;
+      continue;
+    }
+    // Nothing queued: back off from yielding to short sleeps
+    if (++idle < 64) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(idle < 1024 ? std::chrono::microseconds(50)
+                                              : std::chrono::microseconds(1000));
+    }
+  }
+}
+
+void shm_ingest::handle_record(channel& ch, shm::record_type type, std::string_view payload) {
+  computed_data parsed;
+  switch (type) {
+    case shm::record_type::json:
+      parsed = process_json_request(payload);
+      break;
+    case shm::record_type::xml:
+      parsed = parse_xml_file(payload);
+      break;
+    case shm::record_type::text:
+      parsed = parse_text_file(payload);
+      break;
+    case shm::record_type::flush:
+      answer_flush(ch);
+      return;
+    default:
+      return;
+  }
+
+  if (parsed.error_message != "success") {
+    if (ch.error_message.empty()) ch.error_message = parsed.error_message;
+    return;
+  }
+
+  ch.total_fields += parsed.total_fields;
+  ch.invalid_fields += parsed.invalid_fields;
+  ch.message_stats.push_back(std::move(parsed.message_stats));
+  if (ch.message_stats.size() >= merge_batch) {
+    boost::json::object merged = merge_json_objects(ch.message_stats);
+    ch.message_stats.clear();
+    ch.message_stats.push_back(std::move(merged));
+  }
+}
+
+void shm_ingest::answer_flush(channel& ch) {
+  // Same shape as the HTTP analysis response
+  std::string body;
+  if (ch.error_message.empty()) {
+    auto const merged = merge_json_objects(ch.message_stats);
+    cluster::record(merged, ch.total_fields, ch.invalid_fields);
+    codec::write_json(
+        {ch.total_fields, "local", "0", "LOG LEVEL", ch.invalid_fields, merged}, body);
+  } else {
+    boost::json::object response_object;
+    response_object["status"] = ch.error_message;
+    body = boost::json::serialize(response_object);
+  }
+  if (body.size() > ch.responses.max_payload()) {
+    body = R"({"status":"analysis does not fit in the response ring"})";
+  }
+
+  // The producer is blocked on this answer, so wait for it to drain the ring,
+  // but not forever: a producer that stopped reading would stall every region.
+  auto const deadline = std::chrono::steady_clock::now() + answer_timeout;
+  for (unsigned attempt = 0; !ch.responses.try_push(shm::record_type::result, body); ++attempt) {
+    if (stop_requested_.load(std::memory_order_relaxed)) break;
+    if (std::chrono::steady_clock::now() >= deadline) {
+      LOG_ERROR("Shared-memory ring {} did not take a flush answer in {}s; detaching it",
+          ch.region.name(),
+          answer_timeout.count());
+      ch.detached = true;
+      break;
+    }
+    if (attempt < 64) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(attempt < 1024 ? std::chrono::microseconds(50)
+                                                 : std::chrono::microseconds(1000));
+    }
+  }
+
+  ch.total_fields = 0;
+  ch.invalid_fields = 0;
+  ch.message_stats.clear();
+  ch.error_message.clear();
+}
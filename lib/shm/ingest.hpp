@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "region.hpp"
+
+// Server side of the shared-memory ingestion path. Creates one region per
+// name and runs a consumer thread that parses records straight out of shared
+// memory, keeps a running aggregate per region and answers flush records with
+// the analysis on the response ring.
+class shm_ingest {
+ public:
+  shm_ingest(std::vector<std::string> names,
+      std::size_t request_capacity,
+      std::size_t response_capacity);
+  shm_ingest(const shm_ingest&) = delete;
+  shm_ingest& operator=(const shm_ingest&) = delete;
+  ~shm_ingest();
+
+  bool start();
+  void stop();
+
+ private:
+  struct channel;
+
+  void consume();
+  void handle_record(channel& ch, shm::record_type type, std::string_view payload);
+  void answer_flush(channel& ch);
+
+  std::vector<std::string> names_;
+  std::size_t request_capacity_;
+  std::size_t response_capacity_;
+  std::vector<channel> channels_;
+  std::atomic<bool> stop_requested_{false};
+  std::thread consumer_;
+};
@@ -0,0 +1,73 @@
+#include "producer.hpp"
+
+#include <thread>
+
+namespace {
+
+// Spin briefly, then yield, then sleep: the server drains the ring in bursts.
+void back_off(unsigned& attempt) {
+  ++attempt;
+  if (attempt > 256) {
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  } else if (attempt > 64) {
+    std::this_thread::yield();
+  }
+}
+
+}  // namespace
+
+std::optional<shm_producer> shm_producer::connect(const std::string& name) {
+  auto region = shm_region::open(name);
+  if (!region) return std::nullopt;
+  return shm_producer(std::move(*region));
+}
+
+bool shm_producer::push(shm::record_type type,
+    std::string_view payload,
+    std::chrono::milliseconds timeout) {
+  if (payload.size() > requests_.max_payload()) return false;
+
+  auto const deadline = std::chrono::steady_clock::now() + timeout;
+  unsigned attempt = 0;
+  while (!requests_.try_push(type, payload)) {
+    if (std::chrono::steady_clock::now() >= deadline) return false;
+    back_off(attempt);
+  }
+  return true;
+}
+
+bool shm_producer::push_text(std::string_view lines, std::chrono::milliseconds timeout) {
+  // Keep records well below the ring size so the server can drain one while
+  // the next is being written.
+  std::size_t const chunk_limit = requests_.max_payload() / 4;
+
+  while (!lines.empty()) {
+    std::size_t length = lines.size();
+    if (length > chunk_limit) {
+      std::size_t newline = lines.rfind('\n', chunk_limit - 1);
+      // A single line longer than a chunk is sent on its own
+      if (newline == std::string_view::npos) newline = lines.find('\n');
+      length = newline == std::string_view::npos ? lines.size() : newline + 1;
+    }
+    if (!push(shm::record_type::text, lines.substr(0, length), timeout)) return false;
+    lines.remove_prefix(length);
+  }
+  return true;
+}
+
+std::optional<std::string> shm_producer::flush(std::chrono::milliseconds timeout) {
+  if (!push(shm::record_type::flush, {}, timeout)) return std::nullopt;
+
+  auto const deadline = std::chrono::steady_clock::now() + timeout;
+  unsigned attempt = 0;
+  std::optional<std::string> result;
+  while (!result) {
+    bool const popped = responses_.try_pop([&](shm::record_type type, std::string_view payload) {
+      if (type == shm::record_type::result) result.emplace(payload);
+    });
+    if (popped) continue;
+    if (std::chrono::steady_clock::now() >= deadline) return std::nullopt;
+    back_off(attempt);
+  }
+  return result;
+}
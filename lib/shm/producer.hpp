@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "region.hpp"
+
+// Client library for the shared-memory ingestion path. Pushes log documents
+// into a region created by a server started with --shm-ring, and reads the
+// analysis back from the response ring. One producer per region: the rings
+// are single-producer/single-consumer.
+class shm_producer {
+ public:
+  static std::optional<shm_producer> connect(const std::string& name);
+
+  // Pushes one record, waiting up to `timeout` for the server to free space.
+  // Returns false if the payload can never fit or the wait timed out.
+  bool push(shm::record_type type,
+      std::string_view payload,
+      std::chrono::milliseconds timeout = std::chrono::seconds(10));
+
+  // Splits pipe-delimited text on line boundaries into records that fit the ring.
+  bool push_text(std::string_view lines,
+      std::chrono::milliseconds timeout = std::chrono::seconds(10));
+
+  // Asks for the aggregate of everything pushed since the previous flush and
+  // waits for the JSON analysis, in the same format as the HTTP response.
+  std::optional<std::string> flush(std::chrono::milliseconds timeout = std::chrono::seconds(30));
+
+  // Largest single record; JSON and XML documents must fit in one.
+  std::size_t max_record() const { return requests_.max_payload(); }
+
+ private:
+  explicit shm_producer(shm_region region)
+      : region_(std::move(region)),
+        requests_(region_.request_ring()),
+        responses_(region_.response_ring()) {}
+
+  shm_region region_;
+  shm::ring requests_;
+  shm::ring responses_;
+};
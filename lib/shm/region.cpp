@@ -0,0 +1,134 @@
+#include "region.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <print>
+#include <utility>
+
+namespace {
+
+void* map_fd(int fd, std::size_t size) {
+  void* address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  return address == MAP_FAILED ? nullptr : address;
+}
+
+}  // namespace
+
+std::optional<shm_region> shm_region::create(const std::string& name,
+    std::size_t request_capacity,
+    std::size_t response_capacity) {
+  request_capacity = std::bit_ceil(std::max<std::size_t>(request_capacity, 4096));
+  response_capacity = std::bit_ceil(std::max<std::size_t>(response_capacity, 4096));
+  std::size_t const size = shm::region_size(request_capacity, response_capacity);
+
+  // A region left behind by a previous run is replaced
+  ::shm_unlink(name.c_str());
+  int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    std::println(stderr, "[ERROR] shm_open {}: {}", name, std::strerror(errno));
+    return std::nullopt;
+  }
+
+  if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    std::println(stderr, "[ERROR] Sizing shared memory {}: {}", name, std::strerror(errno));
+    ::close(fd);
+    ::shm_unlink(name.c_str());
+    return std::nullopt;
+  }
+
+  void* address = map_fd(fd, size);
+  ::close(fd);
+  if (!address) {
+    std::println(stderr, "[ERROR] Mapping shared memory {}: {}", name, std::strerror(errno));
+    ::shm_unlink(name.c_str());
+    return std::nullopt;
+  }
+
+  // ftruncate zero-fills, so the positions start out at zero
+  auto* header = new (address) shm::region_header{};
+  header->request_capacity = request_capacity;
+  header->response_capacity = response_capacity;
+  header->version = shm::region_version;
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = shm::region_magic;
+
+  return shm_region(name, address, size, true);
+}
+
+std::optional<shm_region> shm_region::open(const std::string& name) {
+  int fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+  if (fd < 0) {
+    std::println(stderr, "[ERROR] shm_open {}: {}", name, std::strerror(errno));
+    return std::nullopt;
+  }
+
+  struct stat info{};
+  if (::fstat(fd, &info) != 0 ||
+      static_cast<std::size_t>(info.st_size) < sizeof(shm::region_header)) {
+    std::println(stderr, "[ERROR] Shared memory {} is not an ingestion region", name);
+    ::close(fd);
+    return std::nullopt;
+  }
+
+  std::size_t const size = static_cast<std::size_t>(info.st_size);
+  void* address = map_fd(fd, size);
+  ::close(fd);
+  if (!address) {
+    std::println(stderr, "[ERROR] Mapping shared memory {}: {}", name, std::strerror(errno));
+    return std::nullopt;
+  }
+
+  shm_region region(name, address, size, false);
+  auto const& header = region.header();
+  if (header.magic != shm::region_magic || header.version != shm::region_version ||
+      shm::region_size(header.request_capacity, header.response_capacity) > size) {
+    std::println(stderr, "[ERROR] Shared memory {} has an unknown layout", name);
+    return std::nullopt;
+  }
+  return region;
+}
+
+shm_region::shm_region(shm_region&& other) noexcept
+    : name_(std::move(other.name_)),
+      address_(std::exchange(other.address_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      owner_(std::exchange(other.owner_, false)) {}
+
+shm_region& shm_region::operator=(shm_region&& other) noexcept {
+  if (this != &other) {
+    if (address_) ::munmap(address_, size_);
+    if (owner_) ::shm_unlink(name_.c_str());
+    name_ = std::move(other.name_);
+    address_ = std::exchange(other.address_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    owner_ = std::exchange(other.owner_, false);
+  }
+  return *this;
+}
+
+shm_region::~shm_region() {
+  if (address_) ::munmap(address_, size_);
+  if (owner_) ::shm_unlink(name_.c_str());
+}
+
+shm::ring shm_region::request_ring() const {
+  auto& h = header();
+  return {&h.request,
+      static_cast<std::byte*>(address_) + shm::request_data_offset(),
+      h.request_capacity};
+}
+
+shm::ring shm_region::response_ring() const {
+  auto& h = header();
+  return {&h.response,
+      static_cast<std::byte*>(address_) + shm::response_data_offset(h),
+      h.response_capacity};
+}
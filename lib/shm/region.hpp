@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+
+#include "ring.hpp"
+
+// A named POSIX shared-memory region (shm_open + mmap) holding one request
+// ring and one response ring. The server creates and owns the name; producers
+// open it by the same name.
+class shm_region {
+ public:
+  // Creates (or recreates) the region; capacities are rounded up to powers of two.
+  static std::optional<shm_region> create(const std::string& name,
+      std::size_t request_capacity,
+      std::size_t response_capacity);
+  static std::optional<shm_region> open(const std::string& name);
+
+  shm_region(shm_region&& other) noexcept;
+  shm_region& operator=(shm_region&& other) noexcept;
+  shm_region(const shm_region&) = delete;
+  shm_region& operator=(const shm_region&) = delete;
+  ~shm_region();
+
+  const std::string& name() const { return name_; }
+  shm::region_header& header() const { return *static_cast<shm::region_header*>(address_); }
+  shm::ring request_ring() const;
+  shm::ring response_ring() const;
+
+ private:
+  shm_region(std::string name, void* address, std::size_t size, bool owner)
+      : name_(std::move(name)), address_(address), size_(size), owner_(owner) {}
+
+  std::string name_;
+  void* address_ = nullptr;
+  std::size_t size_ = 0;
+  bool owner_ = false;  // The creator unlinks the name on destruction
+};
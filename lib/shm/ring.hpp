@@ -0,0 +1,175 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Layout and algorithms for the shared-memory ingestion rings. A region holds
+// a request ring (producer -> server) and a response ring (server -> producer).
+// Both are single-producer/single-consumer byte rings of variable-length,
+// 8-byte aligned records; a record never wraps, the producer pads to the end
+// of the buffer instead.
+namespace shm {
+
+inline constexpr std::uint32_t region_magic = 0x4C414752;  // "LAGR"
+inline constexpr std::uint32_t region_version = 1;
+
+enum class record_type : std::uint32_t {
+  padding = 0,  // Filler up to the end of the buffer
+  json = 1,     // One JSON document (array of log objects)
+  xml = 2,      // One XML document
+  text = 3,     // Whole pipe-delimited lines
+  flush = 4,    // Ask for the aggregate of everything pushed since the last flush
+  result = 5,   // Response ring only: the JSON analysis for a flush
+};
+
+struct record_header {
+  std::uint32_t length;  // Payload bytes
+  record_type type;
+};
+
+// Positions are free-running byte counters; head - tail is the bytes in use.
+struct ring_header {
+  alignas(64) std::atomic<std::uint64_t> head;  // Written by the producer
+  alignas(64) std::atomic<std::uint64_t> tail;  // Written by the consumer
+};
+
+struct region_header {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint64_t request_capacity;
+  std::uint64_t response_capacity;
+  ring_header request;
+  ring_header response;
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+    "shared-memory rings need address-free 64-bit atomics");
+
+inline constexpr std::size_t align_record(std::size_t size) { return (size + 7) & ~std::size_t{7}; }
+
+// Byte offsets of the two data areas inside a mapped region.
+inline constexpr std::size_t request_data_offset() { return align_record(sizeof(region_header)); }
+inline std::size_t response_data_offset(const region_header& header) {
+  return request_data_offset() + header.request_capacity;
+}
+inline constexpr std::size_t region_size(std::size_t request_capacity,
+    std::size_t response_capacity) {
+  return request_data_offset() + request_capacity + response_capacity;
+}
+
+// Process-local view of one ring. Each side keeps a cached copy of the other
+// side's position so the shared cache line is only read when the cached
+// value says the ring is full (producer) or empty (consumer).
+class ring {
+ public:
+  ring() = default;
+  ring(ring_header* header, std::byte* data, std::uint64_t capacity)
+      : header_(header),
+        data_(data),
+        capacity_(capacity),
+        cached_head_(header->head.load(std::memory_order_acquire)),
+        cached_tail_(header->tail.load(std::memory_order_acquire)) {}
+
+  std::uint64_t capacity() const { return capacity_; }
+
+  // Largest payload a single record can carry.
+  std::size_t max_payload() const { return capacity_ - sizeof(record_header); }
+
+  // Producer side. Returns false when there is not enough free space yet.
+  bool try_push(record_type type, std::string_view payload) {
+    std::size_t const size = align_record(sizeof(record_header) + payload.size());
+    if (size > capacity_) return false;
+
+    std::uint64_t head = header_->head.load(std::memory_order_relaxed);
+    std::uint64_t const offset = head % capacity_;
+
+    if (offset + size > capacity_) {
+      // Pad to the end of the buffer first; the record goes at offset zero.
+      std::uint64_t const pad = capacity_ - offset;
+      if (!has_room(head, pad)) return false;
+      write_header(offset, {static_cast<std::uint32_t>(pad - sizeof(record_header)),
+                               record_type::padding});
+      head += pad;
+      header_->head.store(head, std::memory_order_release);
+    }
+
+    if (!has_room(head, size)) return false;
+    std::uint64_t const at = head % capacity_;
+    write_header(at, {static_cast<std::uint32_t>(payload.size()), type});
+    if (!payload.empty()) {
+      std::memcpy(data_ + at + sizeof(record_header), payload.data(), payload.size());
+    }
+    header_->head.store(head + size, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Calls handler(type, payload) for the next record, with the
+  // payload still in shared memory, and releases the space once it returns.
+  // The producer is not trusted: a record that does not lie within the bytes
+  // it published marks the ring broken, and nothing is read from it again.
+  template <class Handler>
+  bool try_pop(Handler&& handler) {
+    if (broken_) return false;
+    std::uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+    for (;;) {
+      if (tail == cached_head_) {
+        cached_head_ = header_->head.load(std::memory_order_acquire);
+        if (tail == cached_head_) return false;
+      }
+
+      std::uint64_t const published = cached_head_ - tail;
+      std::uint64_t const at = tail % capacity_;
+      if (published > capacity_ || published < sizeof(record_header) ||
+          at + sizeof(record_header) > capacity_) {
+        broken_ = true;
+        return false;
+      }
+
+      record_header header;
+      std::memcpy(&header, data_ + at, sizeof(header));
+      std::uint64_t const size = align_record(sizeof(record_header) + std::uint64_t{header.length});
+      if (size > published || at + size > capacity_) {
+        broken_ = true;
+        return false;
+      }
+
+      if (header.type == record_type::padding) {
+        tail += size;
+        header_->tail.store(tail, std::memory_order_release);
+        continue;
+      }
+
+      handler(header.type,
+          std::string_view(reinterpret_cast<const char*>(data_ + at + sizeof(record_header)),
+              header.length));
+      header_->tail.store(tail + size, std::memory_order_release);
+      return true;
+    }
+  }
+
+  // True once try_pop met a record outside the published bytes.
+  bool broken() const { return broken_; }
+
+ private:
+  bool has_room(std::uint64_t head, std::uint64_t size) {
+    if (head + size - cached_tail_ <= capacity_) return true;
+    cached_tail_ = header_->tail.load(std::memory_order_acquire);
+    return head + size - cached_tail_ <= capacity_;
+  }
+
+  void write_header(std::uint64_t at, record_header header) {
+    std::memcpy(data_ + at, &header, sizeof(header));
+  }
+
+  ring_header* header_ = nullptr;
+  std::byte* data_ = nullptr;
+  std::uint64_t capacity_ = 0;
+  std::uint64_t cached_head_ = 0;
+  std::uint64_t cached_tail_ = 0;
+  bool broken_ = false;
+};
+
+}  // namespace shm
@@ -1,11 +1,14 @@
 #include "utils.hpp"
 
+#include <boost/asio/ip/host_name.hpp>
 #include <cerrno>
 #include <csignal>
+#include <cstdint>
 #include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <print>
+#include <string>
 #include <thread>
 
 #ifdef _WIN32
@@ -19,7 +22,19 @@
 #include <unistd.h>
 #endif
 
+#include "../cluster/coordinator.hpp"
+#include "../cluster/live.hpp"
+#include "../cluster/shard.hpp"
+#include "../cluster/upstream.hpp"
+#include "../http/content_store.hpp"
+#include "../http/static_files.hpp"
+#include "../log/logger.hpp"
+#include "../metrics/trace.hpp"
+#include "../network/admission.hpp"
 #include "../network/listener.hpp"
+#ifndef _WIN32
+#include "../shm/ingest.hpp"
+#endif
 
 std::string path_cat(std::string base, std::string_view path) {
   if (base.empty()) return std::string(path);
@@ -105,7 +120,7 @@ void print_response(const boost::json::value& j) {
     for (const auto& [key, value] : content.as_object()) {
       if (is_first) {
         std::println("{:<{}}", key, message_len);
-        std::println("{:<{}}", value.as_string(), times_occurred_len);
+        std::println("{:<{}}", value.to_number<std::int64_t>(), times_occurred_len);
         is_first = false;
       } else {
         std::println("{:<{}} {:<{}}",
@@ -113,7 +128,7 @@ void print_response(const boost::json::value& j) {
             log_level_len,
             key,
             message_len,
-            value.as_string(),
+            value.to_number<std::int64_t>(),
             times_occurred_len);
       }
     }
@@ -169,7 +184,7 @@ static BOOL WINAPI console_ctrl_handler(DWORD ctrl_type) {
 };
 #endif
 
-bool init_server(unsigned short port) {
+bool init_server(const ServerConfig& config) {
 #ifdef _WIN32
   SetConsoleCtrlHandler(console_ctrl_handler, TRUE);
 #else
@@ -185,6 +200,15 @@ bool init_server(unsigned short port) {
 
     std::shared_ptr const doc_root = std::make_shared<std::string>(doc_root_path.value().string());
 
+    // Request-path logging goes through the background flusher from here on
+    if (!logging::start(*logging::parse_level(config.logLevel), config.logRateLimit)) return false;
+
+    // Hot files under public/ are served from memory
+    static_files::configure(config.fileCacheMb << 20, config.fileCacheMaxKb << 10);
+
+    // Identical uploads reuse the analysis of the first copy
+    content_store::set_cache_capacity(config.analysisCacheMb << 20);
+
     // Calculate optimal thread count based on hardware
     unsigned int const thread_count =
         std::max<unsigned int>(1, std::thread::hardware_concurrency());
@@ -192,14 +216,84 @@ bool init_server(unsigned short port) {
     // The io_context is required for all I/O
     asio::io_context ioc{static_cast<int>(thread_count)};
 
+    // Parse work is queued fairly between clients, leaving a thread for I/O
+    admission::set_workers(thread_count - 1);
+
+    // Per-client rate limits and queue weights, reloaded when the file changes
+    std::optional<admission::policy_watcher> limits;
+    if (!config.limitsFile.empty()) {
+      limits.emplace(ioc, config.limitsFile);
+      if (!limits->start()) return false;
+    }
+
     // Create a work guard to keep the io_context alive
     auto work_guard = asio::make_work_guard(ioc);
 
     // Create and launch a listening port
     std::shared_ptr<listener> http_listener =
-        std::make_shared<listener>(ioc, tcp::endpoint{address, port}, doc_root);
+        std::make_shared<listener>(ioc, tcp::endpoint{address, config.port}, doc_root);
     http_listener->run();
 
+    // Co-located agents can skip TCP loopback through a UNIX domain socket
+    if (!config.unixSocket.empty()) {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+      std::make_shared<local_listener>(ioc,
+          asio::local::stream_protocol::endpoint{config.unixSocket},
+          doc_root)
+          ->run();
+#else
+      std::println(stderr, "[ERROR] UNIX domain sockets are not supported on this platform");
+      return false;
+#endif
+    }
+
+    // Sampled request traces, for opening slow uploads in a trace viewer
+    if (!config.traceFile.empty() && !trace::open(config.traceFile, config.traceSampleRate)) {
+      return false;
+    }
+
+    // Local producers can bypass sockets through shared-memory rings
+#ifndef _WIN32
+    shm_ingest ingest(config.shmRings, config.shmRingMb << 20, std::size_t{16} << 20);
+    if (!ingest.start()) return false;
+#else
+    if (!config.shmRings.empty()) {
+      std::println(stderr, "[ERROR] Shared-memory ingestion is not supported on this platform");
+      return false;
+    }
+#endif
+
+    std::string const node_id = config.nodeId.empty()
+        ? asio::ip::host_name() + ":" + std::to_string(config.port)
+        : config.nodeId;
+
+    // Aggregation tree: merge pushes from leaf servers, push our own upstream
+    if (config.coordinator) cluster::enable_coordinator();
+    std::optional<cluster::upstream_pusher> pusher;
+    if (!config.upstream.empty()) {
+      pusher.emplace(ioc,
+          config.upstream,
+          node_id,
+          std::chrono::milliseconds(static_cast<long>(config.pushInterval * 1000)));
+      if (!pusher->start()) return false;
+    }
+
+    // Uploads are sharded by Client-Id over the nodes of the ring file
+    std::optional<cluster::ring_watcher> ring;
+    if (!config.ringFile.empty()) {
+      ring.emplace(ioc, config.ringFile, node_id, *cluster::parse_shard_mode(config.shardMode));
+      if (!ring->start()) return false;
+    }
+
+    // Per-level rates and top messages pushed to the dashboard over /live
+    std::optional<cluster::live_feed> live;
+    if (config.liveInterval > 0) {
+      live.emplace(ioc,
+          std::chrono::milliseconds(static_cast<long>(config.liveInterval * 1000)),
+          config.liveTop);
+      live->start();
+    }
+
     // Start the worker threads
     std::vector<std::thread> threads;
     threads.reserve(thread_count - 1);
@@ -267,6 +361,16 @@ bool init_server(unsigned short port) {
       }
     }
 
+    trace::close();
+    logging::stop();
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    if (!config.unixSocket.empty()) {
+      std::error_code remove_ec;
+      std::filesystem::remove(config.unixSocket, remove_ec);
+    }
+#endif
+
     std::println("[INFO] Server stopped successfully");
   } catch (std::exception& error) {
     std::println(stderr, "[ERROR] Error processing request: {}", error.what());
@@ -5,6 +5,8 @@
 #include <map>
 #include <string>
 
+#include "../cli/parse.hpp"
+
 std::string path_cat(std::string base, std::string_view path);
 std::string get_file(const std::filesystem::path& doc_root,
     const std::string& file_name,
@@ -15,5 +17,5 @@ std::map<std::string, std::string> save_file(const std::string& content,
     const std::string& ip,
     const std::string& ext);
 void print_response(const boost::json::value& j);
-bool init_server(unsigned short port);
+bool init_server(const ServerConfig& config);
 std::optional<std::filesystem::path> setup_public_dir();
@@ -2,11 +2,11 @@
 #include "lib/utils/utils.hpp"
 
 int main(int argc, char* argv[]) {
-  unsigned short const port = parse_cli_args_server(argc, argv);
+  auto cfg = parse_cli_args_server(argc, argv);
 
-  if (!port) return 1;
+  if (!cfg) return 1;
 
-  if (!init_server(port)) return 1;
+  if (!init_server(*cfg)) return 1;
 
   return 0;
 }
\ No newline at end of file
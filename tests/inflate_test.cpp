@@ -0,0 +1,109 @@
+// Checks inflater::inflate_all, which POST /stream feeds one body piece at a
+// time, at the boundaries where a piece and the output buffer run out
+// together.
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../lib/codec/gzip.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, char const* what, std::size_t split = 0) {
+  if (ok) return;
+  std::fprintf(stderr, "FAILED: %s (split at %zu)\n", what, split);
+  ++failures;
+}
+
+// Inflates `compressed` as two pieces split at `split`, the way ingest_stream
+// sees a body that arrives in two reads.
+bool inflate_split(std::string_view compressed,
+    std::size_t split,
+    std::size_t out_size,
+    std::string& decoded) {
+  codec::inflater inflater(codec::content_coding::gzip);
+  std::vector<char> out(out_size);
+  auto const emit = [&decoded](std::string_view run) { decoded += run; };
+  for (auto const piece : {compressed.substr(0, split), compressed.substr(split)}) {
+    if (!inflater.inflate_all(piece, out.data(), out.size(), emit)) return false;
+  }
+  return inflater.done();
+}
+
+std::string sample_text(std::size_t size) {
+  std::string text;
+  for (std::size_t i = 0; text.size() < size; ++i) {
+    text += "INFO request " + std::to_string(i * 7919 % 1000) + " served\n";
+  }
+  text.resize(size);
+  return text;
+}
+
+// A stored (level 0) gzip body: its 10-byte header and the 5-byte block
+// header are followed by the text itself, so a first piece that ends
+// `out_size` bytes into the text inflates to exactly one full output buffer
+// and leaves no input behind.
+void piece_ends_with_full_output() {
+  constexpr std::size_t out_size = 64;
+  constexpr std::size_t headers = 10 + 5;
+  auto const text = sample_text(1000);
+  auto const compressed = codec::gzip(text, 0);
+  check(compressed.has_value(), "stored gzip");
+  if (!compressed) return;
+
+  codec::inflater probe(codec::content_coding::gzip);
+  std::vector<char> out(out_size);
+  auto const step = probe.step(compressed->data(), headers + out_size, out.data(), out.size());
+  check(step.consumed == headers + out_size && step.produced == out_size,
+      "first piece fills the output exactly",
+      headers + out_size);
+
+  std::string decoded;
+  check(inflate_split(*compressed, headers + out_size, out_size, decoded),
+      "full output at the end of a piece is not corruption",
+      headers + out_size);
+  check(decoded == text, "decoded text", headers + out_size);
+}
+
+// Every split of compressed bodies, with output buffers small enough that
+// runs end on buffer boundaries often.
+void every_split() {
+  auto const text = sample_text(5000);
+  for (int level : {0, 6}) {
+    auto const compressed = codec::gzip(text, level);
+    check(compressed.has_value(), "gzip");
+    if (!compressed) continue;
+    for (std::size_t out_size : {1, 7, 64, 4096}) {
+      for (std::size_t split = 0; split <= compressed->size(); ++split) {
+        std::string decoded;
+        bool const ok = inflate_split(*compressed, split, out_size, decoded);
+        check(ok && decoded == text, "split body decodes", split);
+      }
+    }
+  }
+}
+
+void corrupt_body() {
+  auto compressed = codec::gzip(sample_text(2000), 6);
+  check(compressed.has_value(), "gzip");
+  if (!compressed) return;
+  (*compressed)[compressed->size() / 2] ^= 0x55;
+  (*compressed)[compressed->size() / 2 + 1] ^= 0x55;
+  std::string decoded;
+  check(!inflate_split(*compressed, compressed->size() / 3, 64, decoded), "corrupt body fails");
+}
+
+}  // namespace
+
+int main() {
+  piece_ends_with_full_output();
+  every_split();
+  corrupt_body();
+  if (failures == 0) std::printf("inflate_test: all checks passed\n");
+  return failures == 0 ? 0 : 1;
+}
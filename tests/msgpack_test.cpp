@@ -0,0 +1,103 @@
+// Checks read_msgpack, which clients use to read MessagePack analyses: what
+// write_msgpack writes reads back to the same value as the JSON form, and
+// truncated, padded or oversized input is refused without reading past the
+// end or allocating what a length claims.
+
+#include <boost/json.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include "../lib/codec/analysis.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, char const* what, std::size_t at = 0) {
+  if (ok) return;
+  std::fprintf(stderr, "FAILED: %s (at %zu)\n", what, at);
+  ++failures;
+}
+
+boost::json::object sample_stats() {
+  boost::json::object stats;
+  auto& info = stats["INFO"].emplace_object();
+  info["request served"] = 1000;
+  info["cache miss"] = 70000;       // uint32
+  info["bytes sent"] = 5000000000;  // uint64
+  auto& error = stats["ERROR"].emplace_object();
+  error[std::string(300, 'x')] = 1;  // str16 key
+  error["negative count"] = -3;
+  return stats;
+}
+
+std::string encode(codec::response_format format, std::string_view cursor = {}) {
+  auto const stats = sample_stats();
+  codec::analysis const result{1234, "127.0.0.1", "50000", "LOG LEVEL", 5, stats, cursor};
+  std::string out;
+  if (format == codec::response_format::msgpack) {
+    codec::write_msgpack(result, out);
+  } else {
+    codec::write_json(result, out);
+  }
+  return out;
+}
+
+void round_trip() {
+  for (std::string_view cursor : {std::string_view{}, std::string_view{"0123456789abcdef.10"}}) {
+    auto const decoded = codec::read_msgpack(encode(codec::response_format::msgpack, cursor));
+    check(decoded.has_value(), "written MessagePack reads back");
+    if (!decoded) continue;
+    auto const expected = boost::json::parse(encode(codec::response_format::json, cursor));
+    check(*decoded == expected, "MessagePack and JSON forms agree");
+  }
+}
+
+// Every proper prefix, and the whole with a byte after it.
+void truncated_and_padded() {
+  auto const encoded = encode(codec::response_format::msgpack);
+  for (std::size_t size = 0; size < encoded.size(); ++size) {
+    check(!codec::read_msgpack(std::string_view(encoded).substr(0, size)),
+        "truncated document is refused",
+        size);
+  }
+  check(!codec::read_msgpack(encoded + '\xc0'), "trailing value is refused");
+}
+
+void oversized() {
+  // Lengths far beyond the data: map32, array32 and str32 claiming 4 Gi.
+  check(!codec::read_msgpack(std::string_view("\xdf\xff\xff\xff\xff", 5)), "map32 length");
+  check(!codec::read_msgpack(std::string_view("\xdd\xff\xff\xff\xff", 5)), "array32 length");
+  check(!codec::read_msgpack(std::string_view("\xdb\xff\xff\xff\xff" "abc", 8)), "str32 length");
+
+  // Nesting deeper than any analysis
+  check(!codec::read_msgpack(std::string(64, '\x91') + '\x01'), "deep nesting");
+  check(codec::read_msgpack(std::string(8, '\x91') + '\x01').has_value(), "shallow nesting");
+
+  // Types the writer never emits
+  check(!codec::read_msgpack(std::string_view("\xc4\x01x", 3)), "bin8");
+  check(!codec::read_msgpack(std::string_view("\xca\x00\x00\x00\x00", 5)), "float32");
+  check(!codec::read_msgpack(std::string_view("\x81\x01\x02", 3)), "non-string key");
+}
+
+void integers() {
+  auto const uint64_max = codec::read_msgpack(std::string("\xcf") + std::string(8, '\xff'));
+  check(uint64_max && uint64_max->is_uint64() && uint64_max->get_uint64() == ~std::uint64_t{0},
+      "uint64 above INT64_MAX");
+  auto const minus_one = codec::read_msgpack(std::string("\xd3") + std::string(8, '\xff'));
+  check(minus_one && minus_one->is_int64() && minus_one->get_int64() == -1, "int64 -1");
+}
+
+}  // namespace
+
+int main() {
+  round_trip();
+  truncated_and_padded();
+  oversized();
+  integers();
+  if (failures == 0) std::printf("msgpack_test: all checks passed\n");
+  return failures == 0 ? 0 : 1;
+}
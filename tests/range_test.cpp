@@ -0,0 +1,87 @@
+// Checks static_files::parse_range at the edges of the file: empty files,
+// ranges that start or end at the last byte, suffixes longer than the file
+// and numbers too large for 64 bits.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string_view>
+
+#include "../lib/http/static_files.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, char const* what, std::string_view header) {
+  if (ok) return;
+  std::fprintf(stderr, "FAILED: %s (%.*s)\n", what, static_cast<int>(header.size()), header.data());
+  ++failures;
+}
+
+using static_files::range_kind;
+
+struct range_case {
+  std::string_view header;
+  std::uint64_t size;
+  range_kind kind;
+  std::uint64_t first = 0;
+  std::uint64_t last = 0;
+};
+
+constexpr std::uint64_t max = std::numeric_limits<std::uint64_t>::max();
+
+constexpr range_case cases[] = {
+    // Ordinary ranges
+    {"bytes=0-0", 10, range_kind::satisfiable, 0, 0},
+    {"bytes=0-9", 10, range_kind::satisfiable, 0, 9},
+    {"bytes=2-5", 10, range_kind::satisfiable, 2, 5},
+    {"bytes= 2 - 5 ", 10, range_kind::satisfiable, 2, 5},
+    // The last byte, and past it
+    {"bytes=9-", 10, range_kind::satisfiable, 9, 9},
+    {"bytes=9-9", 10, range_kind::satisfiable, 9, 9},
+    {"bytes=5-100", 10, range_kind::satisfiable, 5, 9},
+    {"bytes=10-", 10, range_kind::unsatisfiable},
+    {"bytes=10-20", 10, range_kind::unsatisfiable},
+    // Suffixes
+    {"bytes=-1", 10, range_kind::satisfiable, 9, 9},
+    {"bytes=-10", 10, range_kind::satisfiable, 0, 9},
+    {"bytes=-11", 10, range_kind::satisfiable, 0, 9},
+    {"bytes=-0", 10, range_kind::unsatisfiable},
+    // Empty files have no satisfiable range
+    {"bytes=0-", 0, range_kind::unsatisfiable},
+    {"bytes=0-0", 0, range_kind::unsatisfiable},
+    {"bytes=-5", 0, range_kind::unsatisfiable},
+    // 64-bit limits
+    {"bytes=0-18446744073709551615", 10, range_kind::satisfiable, 0, 9},
+    {"bytes=-18446744073709551615", 10, range_kind::satisfiable, 0, 9},
+    {"bytes=18446744073709551614-", max, range_kind::satisfiable, max - 1, max - 1},
+    {"bytes=0-18446744073709551616", 10, range_kind::none},
+    {"bytes=18446744073709551616-", 10, range_kind::none},
+    // Ignored: served whole
+    {"", 10, range_kind::none},
+    {"bytes=5-2", 10, range_kind::none},
+    {"bytes=0-1,4-5", 10, range_kind::none},
+    {"bytes=-", 10, range_kind::none},
+    {"bytes=a-b", 10, range_kind::none},
+    {"bytes=1", 10, range_kind::none},
+    {"bytes=+1-2", 10, range_kind::none},
+    {"items=0-1", 10, range_kind::none},
+};
+
+}  // namespace
+
+int main() {
+  for (auto const& c : cases) {
+    static_files::byte_range range;
+    auto const kind = static_files::parse_range(c.header, c.size, range);
+    check(kind == c.kind, "range kind", c.header);
+    if (kind == range_kind::satisfiable && c.kind == range_kind::satisfiable) {
+      check(range.first == c.first && range.last == c.last, "range bounds", c.header);
+      check(range.last < c.size, "range ends inside the file", c.header);
+    }
+  }
+  if (failures == 0) std::printf("range_test: all checks passed\n");
+  return failures == 0 ? 0 : 1;
+}
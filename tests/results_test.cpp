@@ -0,0 +1,123 @@
+// Checks results::parse_query on well-formed and malformed query strings, and
+// that apply() and fetch() page through every selected message exactly once.
+
+#include <boost/json.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include "../lib/http/results.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, char const* what, std::string_view detail = {}) {
+  if (ok) return;
+  std::fprintf(stderr, "FAILED: %s (%.*s)\n", what, static_cast<int>(detail.size()), detail.data());
+  ++failures;
+}
+
+void queries() {
+  auto const q = results::parse_query("top=10&min_count=2&limit=500&cursor=ab.3&other=x");
+  check(q && q->top == 10 && q->min_count == 2 && q->limit == 500 && q->cursor == "ab.3",
+      "all keys");
+  check(q && q->narrows(), "narrows");
+
+  auto const empty = results::parse_query("");
+  check(empty && !empty->narrows(), "empty query");
+  check(results::parse_query("unknown&=&&").has_value(), "unknown keys are ignored");
+  check(results::parse_query("min_count=0").has_value(), "min_count of zero");
+
+  for (std::string_view bad : {"top=0",
+           "top=",
+           "top",
+           "top=-1",
+           "top=1x",
+           "top=99999999999999999999999",
+           "min_count=-1",
+           "min_count=9223372036854775808",
+           "limit=0",
+           "limit=ten"}) {
+    check(!results::parse_query(bad), "malformed value is refused", bad);
+  }
+}
+
+// 3 levels x 10 messages, counts 1..10 within a level.
+boost::json::object sample_stats() {
+  boost::json::object stats;
+  for (std::string_view level : {"INFO", "WARN", "ERROR"}) {
+    auto& messages = stats[level].emplace_object();
+    for (std::int64_t i = 1; i <= 10; ++i) {
+      messages[std::string(level) + " message " + std::to_string(i)] = i;
+    }
+  }
+  return stats;
+}
+
+std::size_t message_count(boost::json::object const& stats) {
+  std::size_t count = 0;
+  for (auto const& [level, messages] : stats) count += messages.as_object().size();
+  return count;
+}
+
+void paging() {
+  results::summary const header{30, 0, "127.0.0.1", "50000", "LOG LEVEL"};
+  auto stats = sample_stats();
+  auto const q = results::parse_query("top=5&min_count=3&limit=4");
+  check(q.has_value(), "paging query");
+  if (!q) return;
+
+  auto cursor = results::apply(*q, stats, header);
+  check(message_count(stats) == 4, "first page holds `limit` messages");
+  check(!cursor.empty(), "first page has a cursor");
+
+  // top=5 of counts 3..10 per level: 15 messages, 4 on the first page
+  std::size_t seen = message_count(stats);
+  std::size_t pages = 1;
+  while (!cursor.empty() && pages < 100) {
+    auto const page = results::fetch(cursor, 0);
+    check(page.has_value(), "stored page", cursor);
+    if (!page) break;
+    check(page->header.total_entries == 30 && page->header.client_port == "50000", "page header");
+    for (auto const& [level, messages] : page->message_stats) {
+      for (auto const& [message, count] : messages.as_object()) {
+        check(count.as_int64() >= 6, "page keeps top and min_count", message);
+      }
+    }
+    seen += message_count(page->message_stats);
+    cursor = page->next_cursor;
+    ++pages;
+  }
+  check(seen == 15, "every selected message is paged out once");
+  check(pages == 4, "pages of four");
+}
+
+void bad_cursors() {
+  results::summary const header{30, 0, "127.0.0.1", "50000", "LOG LEVEL"};
+  auto stats = sample_stats();
+  auto const cursor = results::apply({0, 0, 5, {}}, stats, header);
+  check(!cursor.empty(), "cursor");
+  auto const id = cursor.substr(0, cursor.find('.'));
+
+  check(results::fetch(cursor, 100).has_value(), "a whole stored result");
+  check(results::fetch(id + ".24", 0).has_value(), "last stored message");
+  check(!results::fetch(id + ".25", 0), "offset past the end");
+  check(!results::fetch(id + ".99999999999999999999999", 0), "offset too large");
+  check(!results::fetch(id, 0), "no offset");
+  check(!results::fetch("zz.0", 0), "malformed id");
+  check(!results::fetch("", 0), "empty cursor");
+  check(!results::fetch("0000000000000001.0", 0), "unknown id");
+}
+
+}  // namespace
+
+int main() {
+  queries();
+  paging();
+  bad_cursors();
+  if (failures == 0) std::printf("results_test: all checks passed\n");
+  return failures == 0 ? 0 : 1;
+}
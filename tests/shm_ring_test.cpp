@@ -0,0 +1,143 @@
+// Checks shm::ring over a process-local buffer: records round-trip across the
+// wrap, and a producer that writes a record header it did not publish the
+// bytes for breaks the ring instead of having them read.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "../lib/shm/ring.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, char const* what, std::size_t round = 0) {
+  if (ok) return;
+  std::fprintf(stderr, "FAILED: %s (round %zu)\n", what, round);
+  ++failures;
+}
+
+constexpr std::uint64_t capacity = 256;
+
+// One ring's shared state, as a region would hold it.
+struct buffer {
+  shm::ring_header header{};
+  alignas(8) std::byte data[capacity]{};
+
+  shm::ring view() { return shm::ring(&header, data, capacity); }
+
+  // Writes a record header at `at` the way a producer would, without the
+  // payload size checks of try_push.
+  void write_header(std::uint64_t at, std::uint32_t length, shm::record_type type) {
+    shm::record_header const h{length, type};
+    std::memcpy(data + at, &h, sizeof(h));
+  }
+};
+
+// Pops one record into `payload` and `type`; false when there is none.
+bool pop(shm::ring& ring, std::string& payload, shm::record_type& type) {
+  return ring.try_pop([&](shm::record_type t, std::string_view p) {
+    type = t;
+    payload.assign(p);
+  });
+}
+
+// Payloads of varying sizes, so records pad at different offsets as the
+// free-running positions wrap around the buffer many times.
+void round_trip() {
+  buffer buf;
+  auto producer = buf.view();
+  auto consumer = buf.view();
+  for (std::size_t round = 0; round < 1000; ++round) {
+    std::string const sent(round % 97, static_cast<char>('a' + round % 26));
+    check(producer.try_push(shm::record_type::text, sent), "push", round);
+    std::string got;
+    shm::record_type type{};
+    check(pop(consumer, got, type), "pop", round);
+    check(type == shm::record_type::text && got == sent, "payload", round);
+    check(!consumer.broken(), "ring stays sound", round);
+  }
+  std::string got;
+  shm::record_type type{};
+  check(!pop(consumer, got, type), "empty ring pops nothing");
+}
+
+void full_ring() {
+  buffer buf;
+  auto producer = buf.view();
+  std::string const payload(producer.max_payload(), 'x');
+  check(producer.try_push(shm::record_type::json, payload), "largest payload fits");
+  check(!producer.try_push(shm::record_type::json, ""), "full ring refuses a push");
+  check(!producer.try_push(shm::record_type::json, payload + "x"), "oversized payload");
+}
+
+// A published record whose header claims more bytes than were published.
+void corrupt_length() {
+  buffer buf;
+  auto producer = buf.view();
+  check(producer.try_push(shm::record_type::text, "hello"), "push");
+  buf.write_header(0, 0xFFFFFFF0u, shm::record_type::text);
+
+  auto consumer = buf.view();
+  bool called = false;
+  bool const popped = consumer.try_pop([&](shm::record_type, std::string_view) { called = true; });
+  check(!popped && !called, "corrupt length is not handed out");
+  check(consumer.broken(), "corrupt length breaks the ring");
+  check(buf.header.tail.load() == 0, "corrupt record is not released");
+
+  // Nothing more is read, even once the producer publishes sound records.
+  check(producer.try_push(shm::record_type::text, "after"), "push after");
+  check(!consumer.try_pop([&](shm::record_type, std::string_view) { called = true; }) && !called,
+      "broken ring stays broken");
+}
+
+// A length within the published bytes that still runs off the buffer end.
+void length_past_buffer_end() {
+  buffer buf;
+  buf.header.head.store(capacity + 128);
+  buf.header.tail.store(capacity - 16);
+  buf.write_header(capacity - 16, 64, shm::record_type::json);
+  auto consumer = buf.view();
+  std::string got;
+  shm::record_type type{};
+  check(!pop(consumer, got, type) && consumer.broken(), "record past the buffer end");
+}
+
+// Padding that claims more than the rest of the buffer.
+void corrupt_padding() {
+  buffer buf;
+  buf.header.head.store(capacity + 16);
+  buf.header.tail.store(capacity - 32);
+  buf.write_header(capacity - 32, 40, shm::record_type::padding);
+  auto consumer = buf.view();
+  std::string got;
+  shm::record_type type{};
+  check(!pop(consumer, got, type) && consumer.broken(), "padding past the buffer end");
+}
+
+// A head more than a buffer ahead of the tail.
+void head_too_far_ahead() {
+  buffer buf;
+  buf.header.head.store(capacity * 3);
+  auto consumer = buf.view();
+  std::string got;
+  shm::record_type type{};
+  check(!pop(consumer, got, type) && consumer.broken(), "head beyond capacity");
+}
+
+}  // namespace
+
+int main() {
+  round_trip();
+  full_ring();
+  corrupt_length();
+  length_past_buffer_end();
+  corrupt_padding();
+  head_too_far_ahead();
+  if (failures == 0) std::printf("shm_ring_test: all checks passed\n");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+// Checks the binary partial aggregate: what encode() writes parses back to the
+// same counts, and view::parse refuses anything truncated, padded or carrying
+// counts that do not fit the aggregate.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../lib/cluster/aggregate.hpp"
+#include "../lib/cluster/wire.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, char const* what, std::size_t at = 0) {
+  if (ok) return;
+  std::fprintf(stderr, "FAILED: %s (at %zu)\n", what, at);
+  ++failures;
+}
+
+constexpr std::int64_t max_count = std::numeric_limits<std::int64_t>::max();
+
+cluster::partial sample() {
+  cluster::partial p;
+  p.total_entries = 1234;
+  p.invalid_data = 5;
+  p.levels["INFO"]["request served"] = 1000;
+  p.levels["INFO"]["cache miss"] = 3;
+  p.levels["ERROR"]["request served"] = 1;  // Same text as an INFO message
+  p.levels["AUDIT"]["login"] = max_count;   // Not a well-known level
+  p.levels["DEBUG"]["dropped"] = 0;         // Left out of the encoding
+  return p;
+}
+
+bool same_counts(cluster::partial const& a, cluster::partial const& b) {
+  auto const covers = [](cluster::partial const& x, cluster::partial const& y) {
+    for (auto const& [level, counts] : x.levels) {
+      for (auto const& [message, count] : counts) {
+        if (count <= 0) continue;
+        auto const level_it = y.levels.find(level);
+        if (level_it == y.levels.end()) return false;
+        auto const it = level_it->second.find(message);
+        if (it == level_it->second.end() || it->second != count) return false;
+      }
+    }
+    return true;
+  };
+  return a.total_entries == b.total_entries && a.invalid_data == b.invalid_data &&
+         covers(a, b) && covers(b, a);
+}
+
+void put_varint(std::uint64_t value, std::string& out) {
+  while (value >= 0x80) {
+    out += static_cast<char>((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  out += static_cast<char>(value);
+}
+
+// One INFO entry for message "m" with `count`, written by hand so the count
+// can be one encode() never produces.
+std::string single_entry(std::uint64_t count) {
+  std::string out = "LAG";
+  out += static_cast<char>(cluster::wire::version);
+  out += '\0';  // No sketches
+  put_varint(1, out);  // total_entries
+  put_varint(0, out);  // invalid_data
+  put_varint(1, out);  // One string
+  put_varint(1, out);
+  out += 'm';
+  put_varint(1, out);  // One level
+  put_varint(3, out);  // INFO
+  put_varint(1, out);  // One entry
+  put_varint(0, out);
+  put_varint(count, out);
+  return out;
+}
+
+void round_trip() {
+  auto const original = sample();
+  std::string const sketch_payload = "\x01\x02\x03";
+  cluster::wire::sketch const sketches[] = {{7, sketch_payload}};
+  auto const encoded = cluster::wire::encode(original, sketches);
+  auto const view = cluster::wire::view::parse(encoded);
+  check(view.has_value(), "encoded partial parses");
+  if (!view) return;
+
+  cluster::partial decoded;
+  decoded.merge(*view);
+  check(same_counts(original, decoded), "decoded counts match");
+  check(!decoded.levels.contains("DEBUG"), "zero counts are left out");
+
+  std::size_t sketches_seen = 0;
+  view->for_each_sketch([&](cluster::wire::sketch const& s) {
+    check(s.kind == 7 && s.payload == sketch_payload, "sketch payload");
+    ++sketches_seen;
+  });
+  check(sketches_seen == 1, "one sketch");
+}
+
+// Every proper prefix, and the whole with a byte after it.
+void truncated_and_padded() {
+  auto const encoded = cluster::wire::encode(sample());
+  for (std::size_t size = 0; size < encoded.size(); ++size) {
+    check(!cluster::wire::view::parse(std::string_view(encoded).substr(0, size)),
+        "truncated partial is refused",
+        size);
+  }
+  check(!cluster::wire::view::parse(encoded + '\0'), "trailing byte is refused");
+}
+
+void oversized() {
+  check(cluster::wire::view::parse(single_entry(max_count)).has_value(), "INT64_MAX count");
+  check(!cluster::wire::view::parse(single_entry(std::uint64_t{1} << 63)), "count past INT64_MAX");
+  check(!cluster::wire::view::parse(single_entry(~std::uint64_t{0})), "largest varint count");
+
+  // An 11-byte varint
+  std::string long_varint = single_entry(0);
+  long_varint.pop_back();
+  long_varint += std::string(10, '\x80') + '\x01';
+  check(!cluster::wire::view::parse(long_varint), "varint longer than ten bytes");
+
+  // A string table that claims far more strings than there are bytes
+  std::string many_strings = "LAG";
+  many_strings += static_cast<char>(cluster::wire::version);
+  many_strings += '\0';
+  put_varint(0, many_strings);
+  put_varint(0, many_strings);
+  put_varint(std::uint64_t{1} << 40, many_strings);
+  check(!cluster::wire::view::parse(many_strings), "implausible string count");
+
+  check(!cluster::wire::view::parse(std::string_view("LAG\x02\x00", 5)), "later version");
+}
+
+// Sums stop at INT64_MAX rather than wrapping negative.
+void saturating_merge() {
+  auto const encoded = cluster::wire::encode(sample());
+  auto const view = cluster::wire::view::parse(encoded);
+  check(view.has_value(), "encoded partial parses");
+  if (!view) return;
+
+  cluster::partial merged;
+  merged.merge(*view);
+  merged.merge(*view);
+  check(merged.levels["AUDIT"]["login"] == max_count, "view merge saturates");
+  check(merged.levels["INFO"]["request served"] == 2000, "view merge adds");
+
+  cluster::partial twice = merged;
+  twice.merge(merged);
+  check(twice.levels["AUDIT"]["login"] == max_count, "partial merge saturates");
+
+  std::vector<cluster::wire::view> const parts{*view, *view};
+  auto const combined = cluster::wire::merge(parts);
+  auto const combined_view = cluster::wire::view::parse(combined);
+  check(combined_view.has_value(), "wire merge result parses");
+  if (!combined_view) return;
+  cluster::partial decoded;
+  decoded.merge(*combined_view);
+  check(decoded.levels["AUDIT"]["login"] == max_count, "wire merge saturates");
+  check(decoded.total_entries == 2 * sample().total_entries, "wire merge totals");
+}
+
+}  // namespace
+
+int main() {
+  round_trip();
+  truncated_and_padded();
+  oversized();
+  saturating_merge();
+  if (failures == 0) std::printf("wire_test: all checks passed\n");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+// Writes deterministic synthetic log corpora for the client, the parser
+// benchmarks and the server benchmarks. The default run fills ./logs with
+// the three files the client uploads.
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <print>
+#include <string>
+#include <vector>
+
+#include "../lib/corpus/generator.hpp"
+#include "CLI/CLI.hpp"
+
+int main(int argc, char* argv[]) {
+  corpus_options options;
+  std::string out_dir = "./logs";
+  std::string prefix = "log_file";
+  std::vector<corpus_format> formats{corpus_format::json, corpus_format::xml, corpus_format::text};
+  std::vector<double> level_mix(options.level_weights.begin(), options.level_weights.end());
+
+  std::map<std::string, corpus_format> const format_names{{"json", corpus_format::json},
+      {"xml", corpus_format::xml},
+      {"txt", corpus_format::text},
+      {"ndjson", corpus_format::ndjson}};
+  std::map<std::string, length_distribution> const length_names{
+      {"uniform", length_distribution::uniform}, {"lognormal", length_distribution::lognormal}};
+
+  CLI::App app{"Synthetic log corpus generator"};
+  app.add_option("-o,--out", out_dir, "output directory");
+  app.add_option("--prefix", prefix, "file name without extension");
+  app.add_option("--formats", formats, "formats to write: json, xml, txt, ndjson")
+      ->delimiter(',')
+      ->transform(CLI::CheckedTransformer(format_names, CLI::ignore_case));
+  app.add_option("--seed", options.seed, "random seed; equal seeds give identical corpora");
+  auto* records = app.add_option("-n,--records", options.records, "records per file")
+                      ->check(CLI::PositiveNumber);
+  app.add_option("--size",
+         options.target_bytes,
+         "approximate size per file instead of a record count, e.g. 10GB")
+      ->transform(CLI::AsSizeValue(false))
+      ->excludes(records);
+  app.add_option("--distinct", options.distinct_messages, "distinct messages")
+      ->check(CLI::PositiveNumber);
+  app.add_option("--zipf", options.zipf_skew, "Zipf skew of message frequencies; 0 is uniform")
+      ->check(CLI::Range(0.0, 10.0));
+  app.add_option("--level-mix", level_mix, "relative weights of INFO,DEBUG,WARN,ERROR,CRITICAL")
+      ->delimiter(',')
+      ->expected(5)
+      ->check(CLI::NonNegativeNumber);
+  app.add_option("--min-length", options.min_message_length, "shortest message in bytes");
+  app.add_option("--max-length", options.max_message_length, "longest message in bytes");
+  app.add_option("--length-dist",
+         options.message_lengths,
+         "message length distribution: uniform, lognormal")
+      ->transform(CLI::CheckedTransformer(length_names, CLI::ignore_case));
+  app.add_option("--invalid-rate", options.invalid_rate, "fraction of records the parsers reject")
+      ->check(CLI::Range(0.0, 1.0));
+  CLI11_PARSE(app, argc, argv);
+
+  std::copy(level_mix.begin(), level_mix.end(), options.level_weights.begin());
+
+  std::error_code ec;
+  std::filesystem::create_directories(out_dir, ec);
+  if (ec) {
+    std::println(stderr, "[ERROR] Cannot create {}: {}", out_dir, ec.message());
+    return 1;
+  }
+
+  corpus_generator const generator(options);
+  for (auto const format : formats) {
+    auto const extension = std::string(corpus_generator::extension(format));
+    auto const path = std::filesystem::path(out_dir) / (prefix + "." + extension);
+    std::ofstream out(path, std::ios::binary);
+    auto const stats = generator.write(out, format);
+    out.close();
+    if (!out) {
+      std::println(stderr, "[ERROR] Writing {} failed", path.string());
+      return 1;
+    }
+    std::println("[INFO] {}: {} records ({} invalid), {:.2f} MB",
+        path.string(),
+        stats.records,
+        stats.invalid,
+        static_cast<double>(stats.bytes) / (1024 * 1024));
+  }
+  return 0;
+}
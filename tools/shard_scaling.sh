@@ -0,0 +1,49 @@
+#!/usr/bin/env bash
+# Starts 1, 2, 4, ... local servers sharing one ring file and runs the load
+# generator against the first of them, to show throughput as nodes are added.
+# Run from the repository root after building:
+#
+#   tools/shard_scaling.sh [max-nodes] [connections] [requests-per-connection]
+#
+# Servers run in redirect mode, so each bench connection moves to the node
+# owning its Client-Id once and stays there. On one machine the nodes share
+# the CPU cores; the numbers flatten out once the cores are used up.
+set -euo pipefail
+
+max_nodes=${1:-4}
+connections=${2:-32}
+requests=${3:-100}
+build=${BUILD_DIR:-./build}
+base_port=9100
+workdir=$(mktemp -d)
+pids=()
+
+cleanup() {
+  for pid in "${pids[@]}"; do kill "$pid" 2>/dev/null || true; done
+  wait 2>/dev/null || true
+  rm -rf "$workdir"
+}
+trap cleanup EXIT
+
+for ((nodes = 1; nodes <= max_nodes; nodes *= 2)); do
+  ring="$workdir/ring.txt"
+  : >"$ring"
+  for ((i = 0; i < nodes; ++i)); do
+    echo "node$i 127.0.0.1:$((base_port + i))" >>"$ring"
+  done
+
+  for ((i = 0; i < nodes; ++i)); do
+    "$build/server" -p $((base_port + i)) --node-id "node$i" --ring "$ring" \
+      --shard-mode redirect --log-level warn >"$workdir/node$i.log" 2>&1 &
+    pids+=($!)
+  done
+  sleep 1
+
+  echo "== $nodes node(s)"
+  "$build/client" -p $base_port --bench --spread-clients \
+    --connections "$connections" -n "$requests" | grep -E ' ok, |throughput' || true
+
+  for pid in "${pids[@]}"; do kill "$pid" 2>/dev/null || true; done
+  wait 2>/dev/null || true
+  pids=()
+done